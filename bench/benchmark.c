@@ -0,0 +1,529 @@
+#include <avltree.h>
+#include <btree.h>
+#include <hashset.h>
+#include <rbtree.h>
+#include <rbtree_i64.h>
+#include <skiplist.h>
+
+#include <math.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/resource.h>
+#include <sys/wait.h>
+#include <time.h>
+#include <unistd.h>
+
+/*
+  Benchmark das coleções.
+
+  Para cada combinação (árvore, ordem das chaves, tamanho) um processo filho
+  executa as cargas abaixo e imprime uma linha CSV por carga:
+
+    insert       insere as n chaves na ordem escolhida, em uma árvore vazia
+    search_hit   busca chaves existentes
+    search_miss  busca chaves inexistentes
+    search_batch busca chaves existentes em lotes de 256 (*_search_many),
+                 apenas nas árvores que possuem busca em lote
+    mixed        50% busca, 25% inserção e 25% remoção
+    remove       remove as n chaves na ordem escolhida
+
+  As chaves são inteiros de 64 bits pares (2 * i); as chaves ímpares são
+  usadas para as buscas sem sucesso. Cada processo filho é medido isolado,
+  então `peak_rss_kb` é o pico de memória daquela combinação.
+*/
+
+// ======================================== //
+//         Chaves e funções de callback.    //
+// ======================================== //
+
+static unsigned long long bench_compares = 0; // Chamadas de comparação.
+
+static int bench_compare(void *a, void *b) {
+  bench_compares++;
+  uint64_t x = *(uint64_t *)a;
+  uint64_t y = *(uint64_t *)b;
+  return (x > y) - (x < y);
+}
+
+static void *bench_copy(void *value) {
+  uint64_t *copy = (uint64_t *)malloc(sizeof(uint64_t));
+  *copy = *(uint64_t *)value;
+  return copy;
+}
+
+static void bench_destroy(void *value) { free(value); }
+
+// Hash das chaves para o conjunto de hash (o conjunto mistura os bits).
+static size_t bench_hash(void *value) { return (size_t)*(uint64_t *)value; }
+
+// ======================================== //
+//         Adaptadores das árvores.         //
+// ======================================== //
+
+// Opções de cada variante de árvore.
+#define BENCH_POOL 0x1
+#define BENCH_INLINE 0x2
+
+typedef struct {
+  const char *name;
+  void *(*create)(unsigned int flags);
+  int (*insert)(void *tree, void *value);
+  int (*remove)(void *tree, void *value);
+  void *(*search)(void *tree, void *value);
+  void (*destroy)(void *tree);
+  // Busca em lote (NULL se a árvore não tiver).
+  void (*search_many)(void *tree, void **keys, void **results, size_t count);
+} bench_tree;
+
+static void *bench_avl_create(unsigned int flags) {
+  unsigned int options = (flags & BENCH_POOL) ? AVL_OPT_POOL : 0;
+  if (flags & BENCH_INLINE)
+    return avl_create_tree_inline(bench_compare, sizeof(uint64_t), options);
+  return avl_create_tree_ex(bench_compare, bench_copy, bench_destroy, options);
+}
+static int bench_avl_insert(void *t, void *v) { return avl_insert(t, v); }
+static int bench_avl_remove(void *t, void *v) { return avl_remove(t, v); }
+static void *bench_avl_search(void *t, void *v) { return avl_search(t, v); }
+static void bench_avl_destroy(void *t) { avl_destroy_tree(t); }
+static void bench_avl_search_many(void *t, void **k, void **r, size_t n) {
+  avl_search_many(t, k, r, n, 0);
+}
+
+static void *bench_rb_create(unsigned int flags) {
+  unsigned int options = (flags & BENCH_POOL) ? RB_OPT_POOL : 0;
+  if (flags & BENCH_INLINE)
+    return rb_create_tree_inline(bench_compare, sizeof(uint64_t), options);
+  return rb_create_tree_ex(bench_compare, bench_copy, bench_destroy, options);
+}
+static int bench_rb_insert(void *t, void *v) { return rb_insert(t, v); }
+static int bench_rb_remove(void *t, void *v) { return rb_remove(t, v); }
+static void *bench_rb_search(void *t, void *v) { return rb_search(t, v); }
+static void bench_rb_destroy(void *t) { rb_destroy_tree(t); }
+static void bench_rb_search_many(void *t, void **k, void **r, size_t n) {
+  rb_search_many(t, k, r, n, 0);
+}
+
+static void *bench_bt_create(unsigned int flags) {
+  if (flags & BENCH_INLINE)
+    return bt_create_tree_inline(bench_compare, sizeof(uint64_t));
+  return bt_create_tree(bench_compare, bench_copy, bench_destroy);
+}
+static int bench_bt_insert(void *t, void *v) { return bt_insert(t, v); }
+static int bench_bt_remove(void *t, void *v) { return bt_remove(t, v); }
+static void *bench_bt_search(void *t, void *v) { return bt_search(t, v); }
+static void bench_bt_destroy(void *t) { bt_destroy_tree(t); }
+
+// Conjunto de hash: sem ordem, mesma interface de inserção/busca/remoção.
+static void *bench_hs_create(unsigned int flags) {
+  if (flags & BENCH_INLINE)
+    return hs_create_set_inline(bench_hash, bench_compare, sizeof(uint64_t));
+  return hs_create_set(bench_hash, bench_compare, bench_copy, bench_destroy);
+}
+static int bench_hs_insert(void *t, void *v) { return hs_insert(t, v); }
+static int bench_hs_remove(void *t, void *v) { return hs_remove(t, v); }
+static void *bench_hs_search(void *t, void *v) { return hs_search(t, v); }
+static void bench_hs_destroy(void *t) { hs_destroy_set(t); }
+
+// Lista de saltos concorrente, medida aqui com uma única thread (o custo fixo
+// das operações atômicas e da recuperação por épocas).
+static void *bench_sl_create(unsigned int flags) {
+  (void)flags;
+  return sl_create_list(bench_compare, bench_copy, bench_destroy);
+}
+static int bench_sl_insert(void *t, void *v) { return sl_insert(t, v); }
+static int bench_sl_remove(void *t, void *v) { return sl_remove(t, v); }
+static void *bench_sl_search(void *t, void *v) { return sl_search(t, v); }
+static void bench_sl_destroy(void *t) { sl_destroy_list(t); }
+
+// Árvore especializada: comparação inline, não passa por `bench_compare`
+// (compares_per_op fica 0).
+static void *bench_i64_create(unsigned int flags) {
+  (void)flags;
+  return rb_i64_create();
+}
+static int bench_i64_insert(void *t, void *v) { return rb_i64_insert(t, v); }
+static int bench_i64_remove(void *t, void *v) { return rb_i64_remove(t, v); }
+static void *bench_i64_search(void *t, void *v) { return rb_i64_search(t, v); }
+static void bench_i64_destroy(void *t) { rb_i64_destroy(t); }
+
+static const bench_tree bench_trees[] = {
+    {"avl", bench_avl_create, bench_avl_insert, bench_avl_remove,
+     bench_avl_search, bench_avl_destroy, bench_avl_search_many},
+    {"rb", bench_rb_create, bench_rb_insert, bench_rb_remove, bench_rb_search,
+     bench_rb_destroy, bench_rb_search_many},
+    {"btree", bench_bt_create, bench_bt_insert, bench_bt_remove,
+     bench_bt_search, bench_bt_destroy, NULL},
+    {"rb_i64", bench_i64_create, bench_i64_insert, bench_i64_remove,
+     bench_i64_search, bench_i64_destroy, NULL},
+    {"hash", bench_hs_create, bench_hs_insert, bench_hs_remove,
+     bench_hs_search, bench_hs_destroy, NULL},
+    {"skiplist", bench_sl_create, bench_sl_insert, bench_sl_remove,
+     bench_sl_search, bench_sl_destroy, NULL},
+};
+
+// ======================================== //
+//         Ordens de acesso às chaves.      //
+// ======================================== //
+
+static uint64_t bench_rng_state = 88172645463325252ull;
+
+// Gerador xorshift64*, rápido e reprodutível.
+static uint64_t bench_random(void) {
+  bench_rng_state ^= bench_rng_state >> 12;
+  bench_rng_state ^= bench_rng_state << 25;
+  bench_rng_state ^= bench_rng_state >> 27;
+  return bench_rng_state * 2685821657736338717ull;
+}
+
+// Preenche `perm` com uma permutação aleatória de [0, n).
+static void bench_shuffle(uint32_t *perm, size_t n) {
+  for (size_t i = 0; i < n; i++)
+    perm[i] = (uint32_t)i;
+  for (size_t i = n; i > 1; i--) {
+    size_t j = bench_random() % i;
+    uint32_t tmp = perm[i - 1];
+    perm[i - 1] = perm[j];
+    perm[j] = tmp;
+  }
+}
+
+// Sorteia n índices com distribuição Zipf (theta = 0.99, como no YCSB). O
+// rank sorteado passa por uma permutação para espalhar as chaves populares.
+static void bench_zipfian(uint32_t *seq, size_t n) {
+  const double theta = 0.99;
+  double zetan = 0.0;
+  for (size_t i = 1; i <= n; i++)
+    zetan += 1.0 / pow((double)i, theta);
+  double zeta2 = 1.0 + 1.0 / pow(2.0, theta);
+  double alpha = 1.0 / (1.0 - theta);
+  double eta = (1.0 - pow(2.0 / (double)n, 1.0 - theta)) / (1.0 - zeta2 / zetan);
+
+  uint32_t *perm = (uint32_t *)malloc(n * sizeof(uint32_t));
+  bench_shuffle(perm, n);
+
+  for (size_t i = 0; i < n; i++) {
+    double u = (double)(bench_random() >> 11) / 9007199254740992.0;
+    double uz = u * zetan;
+    size_t rank;
+    if (uz < 1.0)
+      rank = 0;
+    else if (uz < zeta2)
+      rank = 1;
+    else
+      rank = (size_t)((double)n * pow(eta * u - eta + 1.0, alpha));
+    if (rank >= n)
+      rank = n - 1;
+    seq[i] = perm[rank];
+  }
+  free(perm);
+}
+
+static const char *bench_orders[] = {"sequential", "random", "zipfian",
+                                     "reverse"};
+#define BENCH_ORDER_COUNT 4
+
+// Gera a sequência de índices acessados pelas cargas.
+static void bench_make_order(uint32_t *seq, size_t n, int order) {
+  switch (order) {
+  case 0:
+    for (size_t i = 0; i < n; i++)
+      seq[i] = (uint32_t)i;
+    break;
+  case 1:
+    bench_shuffle(seq, n);
+    break;
+  case 2:
+    bench_zipfian(seq, n);
+    break;
+  default:
+    for (size_t i = 0; i < n; i++)
+      seq[i] = (uint32_t)(n - 1 - i);
+    break;
+  }
+}
+
+// ======================================== //
+//         Medição e relatório.             //
+// ======================================== //
+
+static double bench_now(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (double)ts.tv_sec * 1e9 + (double)ts.tv_nsec;
+}
+
+static long bench_peak_rss_kb(void) {
+  struct rusage usage;
+  getrusage(RUSAGE_SELF, &usage);
+  return usage.ru_maxrss;
+}
+
+static int bench_json = 0;
+
+static void bench_report(const char *tree, const char *order, size_t n,
+                         const char *workload, size_t ops, double ns,
+                         unsigned long long compares) {
+  double ns_per_op = ns / (double)ops;
+  double compares_per_op = (double)compares / (double)ops;
+  double ops_per_sec = (double)ops / (ns / 1e9);
+
+  if (bench_json)
+    printf("{\"tree\":\"%s\",\"order\":\"%s\",\"size\":%zu,"
+           "\"workload\":\"%s\",\"ops\":%zu,\"ns_per_op\":%.2f,"
+           "\"compares_per_op\":%.2f,\"ops_per_sec\":%.0f,"
+           "\"peak_rss_kb\":%ld}\n",
+           tree, order, n, workload, ops, ns_per_op, compares_per_op,
+           ops_per_sec, bench_peak_rss_kb());
+  else
+    printf("%s,%s,%zu,%s,%zu,%.2f,%.2f,%.0f,%ld\n", tree, order, n, workload,
+           ops, ns_per_op, compares_per_op, ops_per_sec, bench_peak_rss_kb());
+  fflush(stdout);
+}
+
+// Evita que o compilador descarte os resultados das buscas.
+static volatile uintptr_t bench_sink;
+
+// Executa todas as cargas para uma combinação (árvore, ordem, tamanho).
+static void bench_run(const bench_tree *bt, unsigned int flags,
+                      const char *label, int order, size_t n) {
+  uint32_t *seq = (uint32_t *)malloc(n * sizeof(uint32_t));
+  bench_make_order(seq, n, order);
+
+  void *tree = bt->create(flags);
+  uint64_t key;
+  double start;
+  unsigned long long compares;
+
+  // insert
+  compares = bench_compares;
+  start = bench_now();
+  for (size_t i = 0; i < n; i++) {
+    key = 2 * (uint64_t)seq[i];
+    bt->insert(tree, &key);
+  }
+  bench_report(label, bench_orders[order], n, "insert", n,
+               bench_now() - start, bench_compares - compares);
+
+  // Completa a árvore (ordens com repetição não inserem todas as chaves).
+  for (size_t i = 0; i < n; i++) {
+    key = 2 * (uint64_t)i;
+    bt->insert(tree, &key);
+  }
+
+  // search_hit
+  uintptr_t acc = 0;
+  compares = bench_compares;
+  start = bench_now();
+  for (size_t i = 0; i < n; i++) {
+    key = 2 * (uint64_t)seq[i];
+    acc += (uintptr_t)bt->search(tree, &key);
+  }
+  bench_report(label, bench_orders[order], n, "search_hit", n,
+               bench_now() - start, bench_compares - compares);
+
+  // search_miss
+  compares = bench_compares;
+  start = bench_now();
+  for (size_t i = 0; i < n; i++) {
+    key = 2 * (uint64_t)seq[i] + 1;
+    acc += (uintptr_t)bt->search(tree, &key);
+  }
+  bench_report(label, bench_orders[order], n, "search_miss", n,
+               bench_now() - start, bench_compares - compares);
+
+  // search_batch
+  if (bt->search_many != NULL) {
+    enum { BATCH = 256 };
+    uint64_t batch_keys[BATCH];
+    void *batch_ptrs[BATCH];
+    void *batch_results[BATCH];
+    for (size_t j = 0; j < BATCH; j++)
+      batch_ptrs[j] = &batch_keys[j];
+
+    compares = bench_compares;
+    start = bench_now();
+    for (size_t i = 0; i < n; i += BATCH) {
+      size_t count = (n - i < BATCH) ? n - i : BATCH;
+      for (size_t j = 0; j < count; j++)
+        batch_keys[j] = 2 * (uint64_t)seq[i + j];
+      bt->search_many(tree, batch_ptrs, batch_results, count);
+      acc += (uintptr_t)batch_results[0];
+    }
+    bench_report(label, bench_orders[order], n, "search_batch", n,
+                 bench_now() - start, bench_compares - compares);
+  }
+
+  // mixed: as inserções e remoções usam chaves ímpares, então a árvore
+  // continua com as n chaves pares ao final.
+  compares = bench_compares;
+  start = bench_now();
+  for (size_t i = 0; i < n; i++) {
+    switch (i & 3) {
+    case 0:
+    case 1:
+      key = 2 * (uint64_t)seq[i];
+      acc += (uintptr_t)bt->search(tree, &key);
+      break;
+    case 2:
+      key = 2 * (uint64_t)seq[i] + 1;
+      bt->insert(tree, &key);
+      break;
+    default:
+      key = 2 * (uint64_t)seq[i - 1] + 1;
+      bt->remove(tree, &key);
+      break;
+    }
+  }
+  bench_report(label, bench_orders[order], n, "mixed", n, bench_now() - start,
+               bench_compares - compares);
+
+  // remove
+  compares = bench_compares;
+  start = bench_now();
+  for (size_t i = 0; i < n; i++) {
+    key = 2 * (uint64_t)seq[i];
+    bt->remove(tree, &key);
+  }
+  bench_report(label, bench_orders[order], n, "remove", n,
+               bench_now() - start, bench_compares - compares);
+
+  bench_sink = acc;
+  bt->destroy(tree);
+  free(seq);
+}
+
+// ======================================== //
+//         Linha de comando.                //
+// ======================================== //
+
+static void bench_usage(const char *program) {
+  fprintf(stderr,
+          "uso: %s [opções]\n"
+          "  --trees=LISTA   árvores, separadas por vírgula (padrão: avl,rb)\n"
+          "                  base avl|rb|btree|rb_i64|hash|skiplist com\n"
+          "                  modificadores +pool +inline, ex.: rb+pool+inline\n"
+          "  --orders=LISTA  sequential,random,zipfian,reverse (padrão: todas)\n"
+          "  --sizes=LISTA   quantidade de elementos (padrão: "
+          "1000,10000,100000,1000000)\n"
+          "  --seed=N        semente do gerador aleatório\n"
+          "  --json          imprime JSON (uma linha por medição) em vez de "
+          "CSV\n",
+          program);
+}
+
+// Encontra a árvore e os modificadores de uma variante como "rb+pool".
+static const bench_tree *bench_parse_tree(const char *spec,
+                                          unsigned int *flags) {
+  char name[64];
+  size_t len = strcspn(spec, "+");
+  if (len >= sizeof(name))
+    return NULL;
+  memcpy(name, spec, len);
+  name[len] = '\0';
+
+  *flags = 0;
+  if (strstr(spec, "+pool") != NULL)
+    *flags |= BENCH_POOL;
+  if (strstr(spec, "+inline") != NULL)
+    *flags |= BENCH_INLINE;
+
+  for (size_t i = 0; i < sizeof(bench_trees) / sizeof(bench_trees[0]); i++) {
+    if (strcmp(bench_trees[i].name, name) == 0)
+      return &bench_trees[i];
+  }
+  return NULL;
+}
+
+// Lê o próximo tamanho de uma lista como "1000,10000" e avança `p` até o
+// seguinte. Retorna 0 se o texto em `p` não for um número seguido de vírgula
+// ou do fim da lista.
+static int bench_next_size(const char **p, size_t *n) {
+  char *end;
+  *n = (size_t)strtoull(*p, &end, 10);
+  if (end == *p || (*end != ',' && *end != '\0'))
+    return 0;
+  *p = (*end == ',') ? end + 1 : end;
+  return 1;
+}
+
+int main(int argc, char **argv) {
+  const char *trees = "avl,rb";
+  const char *orders = "sequential,random,zipfian,reverse";
+  const char *sizes = "1000,10000,100000,1000000";
+
+  for (int i = 1; i < argc; i++) {
+    if (strncmp(argv[i], "--trees=", 8) == 0)
+      trees = argv[i] + 8;
+    else if (strncmp(argv[i], "--orders=", 9) == 0)
+      orders = argv[i] + 9;
+    else if (strncmp(argv[i], "--sizes=", 8) == 0)
+      sizes = argv[i] + 8;
+    else if (strncmp(argv[i], "--seed=", 7) == 0)
+      bench_rng_state = strtoull(argv[i] + 7, NULL, 10) | 1;
+    else if (strcmp(argv[i], "--json") == 0)
+      bench_json = 1;
+    else {
+      bench_usage(argv[0]);
+      return 1;
+    }
+  }
+
+  // Confere os tamanhos antes de imprimir qualquer medição.
+  for (const char *p = sizes; *p != '\0';) {
+    size_t n;
+    if (!bench_next_size(&p, &n)) {
+      fprintf(stderr, "tamanho inválido em --sizes: %s\n", p);
+      bench_usage(argv[0]);
+      return 1;
+    }
+  }
+
+  if (!bench_json)
+    printf("tree,order,size,workload,ops,ns_per_op,compares_per_op,"
+           "ops_per_sec,peak_rss_kb\n");
+  fflush(stdout);
+
+  char tree_list[256];
+  snprintf(tree_list, sizeof(tree_list), "%s", trees);
+  for (char *tree_spec = strtok(tree_list, ","); tree_spec != NULL;
+       tree_spec = strtok(NULL, ",")) {
+    unsigned int flags;
+    const bench_tree *bt = bench_parse_tree(tree_spec, &flags);
+    if (bt == NULL) {
+      fprintf(stderr, "árvore desconhecida: %s\n", tree_spec);
+      return 1;
+    }
+
+    for (int order = 0; order < BENCH_ORDER_COUNT; order++) {
+      if (strstr(orders, bench_orders[order]) == NULL)
+        continue;
+
+      for (const char *p = sizes; *p != '\0';) {
+        size_t n;
+        bench_next_size(&p, &n);
+        if (n == 0)
+          continue;
+
+        // Cada combinação roda em um processo próprio, para medir o pico
+        // de memória isolado.
+        pid_t pid = fork();
+        if (pid == 0) {
+          bench_run(bt, flags, tree_spec, order, n);
+          _exit(0);
+        }
+        int status;
+        waitpid(pid, &status, 0);
+        if (!WIFEXITED(status) || WEXITSTATUS(status) != 0) {
+          fprintf(stderr, "falha em %s/%s/%zu\n", tree_spec,
+                  bench_orders[order], n);
+          return 1;
+        }
+        bench_random(); // Sementes diferentes para cada combinação.
+      }
+    }
+  }
+
+  return 0;
+}
@@ -1,6 +1,15 @@
 #ifndef AVLTREE_H
 #define AVLTREE_H
 
+#include <stddef.h>
+
+#include <nodepool.h>
+
+// Opções de criação da árvore (combináveis com `|`).
+#define AVL_OPT_POOL 0x1 // Aloca os nós de um pool próprio da árvore.
+// Mantém o tamanho das sub-árvores (avl_select, avl_rank e avl_count_range).
+#define AVL_OPT_ORDER_STAT 0x2
+
 // Função de comparação para os tipos que a árvore vai processar.
 /*
   Essa função vai retornar:
@@ -14,48 +23,251 @@ typedef void *(*avl_function_copy)(void *);
 // Função de destruir da memória alocada do tipo (Necessário por conta da
 // cópia).
 typedef void (*avl_function_destroy)(void *);
+// Função chamada para cada elemento visitado em uma busca por intervalo.
+// Recebe o valor e o contexto, e retorna 0 para interromper a visita.
+typedef int (*avl_function_visit)(void *, void *);
+
+// Faixas do histograma de profundidade das buscas (a última acumula as
+// buscas mais profundas).
+#define AVL_STATS_DEPTHS 64
+
+// Contadores de instrumentação da árvore. Só são mantidos quando a biblioteca
+// é compilada com COLLECTIONS_STATS (opção do CMake); sem ela a árvore nem
+// guarda os contadores e nada é contado. Os contadores não são atômicos:
+// buscas concorrentes na mesma árvore podem perder contagens.
+typedef struct avl_tree_stats {
+  unsigned long long compares;        // Chamadas de `function_compare`.
+  unsigned long long rotations_left;  // Rotações à esquerda.
+  unsigned long long rotations_right; // Rotações à direita.
+  // Casos de rebalanceamento: Esquerda, Esquerda-Direita, Direita e
+  // Direita-Esquerda.
+  unsigned long long rebalance[4];
+  unsigned long long node_allocs; // Nós alocados.
+  unsigned long long node_frees;  // Nós liberados.
+  // Buscas por valor (avl_search e avl_remove) e quantas visitaram `d` nós em
+  // `search_depth[d]`.
+  unsigned long long searches;
+  unsigned long long search_depth[AVL_STATS_DEPTHS];
+} avl_tree_stats;
 
 // Estruutra do nó da árvore binária balanceada (AVL).
 typedef struct avl_node {
   void *value; // Valor (Tipo definido e retornado pelo programador através de
                // casts)
   int height;
+  unsigned int count; // Quantidade de nós da sub-árvore (AVL_OPT_ORDER_STAT).
 
-  struct avl_node *right; // Nó à direita (maior)
-  struct avl_node *left;  // Nó à esquerda (menor)
+  struct avl_node *right;  // Nó à direita (maior)
+  struct avl_node *left;   // Nó à esquerda (menor)
+  struct avl_node *parent; // Nó pai (NULL na raiz)
 } avl_node;
 
 // Estrutura da árvore binária balanceada (AVL).
 typedef struct {
   avl_node *root;    // Raiz da árvore
+  avl_node *leftmost;  // Menor nó (NULL se vazia), mantido em O(1).
+  avl_node *rightmost; // Maior nó (NULL se vazia), mantido em O(1).
+  int append_probe;    // 1 se a última inserção criou um novo maior nó.
   unsigned int size;
+  unsigned int options; // Opções de criação (AVL_OPT_*).
 
   avl_function_compare function_compare; // Função de comparação.
   avl_function_copy function_copy;       // Função de copia de memória.
   avl_function_destroy function_destroy; // Função de destruir cópia da memória.
 
+  node_pool *pool; // Pool de nós (NULL quando usa malloc por nó).
+
+  size_t value_size; // Tamanho do valor dentro do nó (0: usa function_copy).
+  size_t node_size;  // Tamanho total de cada nó alocado.
+
+  // Modo mapa (avl_create_map*): o valor associado à chave fica em
+  // `map_value_offset` dentro do nó (0 se a árvore não é um mapa), com
+  // `map_value_size` bytes (0: um ponteiro, copiado com `function_copy_map`).
+  size_t map_value_offset;
+  size_t map_value_size;
+  avl_function_copy function_copy_map;
+  avl_function_destroy function_destroy_map;
+
+#ifdef COLLECTIONS_STATS
+  avl_tree_stats stats; // Contadores de instrumentação.
+#endif
 } avl_tree;
 
 // Cria um ponteiro para a nova árvore criada.
 avl_tree *avl_create_tree(avl_function_compare, avl_function_copy,
                           avl_function_destroy);
 
+// Cria a árvore com opções (AVL_OPT_*).
+avl_tree *avl_create_tree_ex(avl_function_compare, avl_function_copy,
+                             avl_function_destroy, unsigned int options);
+
+// Cria a árvore guardando os valores (de `value_size` bytes) dentro dos nós,
+// sem funções de cópia e destruição.
+avl_tree *avl_create_tree_inline(avl_function_compare, size_t value_size,
+                                 unsigned int options);
+
+// Cria um mapa ordenado pelas chaves (`compare`, `copy` e `destroy` valem
+// para as chaves), com um valor associado a cada chave. `copy_value` NULL
+// guarda o ponteiro do valor sem copiar; `destroy_value` é opcional.
+avl_tree *avl_create_map(avl_function_compare, avl_function_copy,
+                         avl_function_destroy, avl_function_copy copy_value,
+                         avl_function_destroy destroy_value,
+                         unsigned int options);
+
+// Cria um mapa que guarda as chaves (de `key_size` bytes) e os valores (de
+// `value_size` bytes) dentro dos nós.
+avl_tree *avl_create_map_inline(avl_function_compare, size_t key_size,
+                                size_t value_size, unsigned int options);
+
 // Limpa todos os dados armazenados na árvore.
 void avl_clear(avl_tree *);
 
 // Destruí a árvore desalocando todos os nós.
 void avl_destroy_tree(avl_tree *);
 
+// Move todos os elementos para uma nova árvore (com as mesmas funções e
+// opções), em O(1), e retorna a nova árvore. `tree` fica vazia e pronta para
+// uso; a outra pode ser destruída aos poucos com `avl_clear_step` ou em outra
+// thread com `avl_clear_async` (parallel.h).
+avl_tree *avl_detach(avl_tree *);
+
+// Destroi até `budget` nós da árvore e retorna quantos ainda restam. Depois
+// do primeiro passo a árvore só pode receber novos passos, `avl_clear` ou
+// `avl_destroy_tree` até ficar vazia (0).
+unsigned int avl_clear_step(avl_tree *, unsigned int budget);
+
 // Insere um elemento na árvore, aplicando balanceamento se necessário.
 int avl_insert(avl_tree *tree, void *value);
 
+// Retorna o elemento igual a `value` se existir; senão insere uma cópia e a
+// retorna. `inserted` (opcional) recebe 1 se inseriu. Faz uma única descida e
+// só copia o valor quando o nó é criado.
+void *avl_find_or_insert(avl_tree *tree, void *value, int *inserted);
+
+// Insere usando `hint` (um nó da árvore, ou NULL) como ponto de partida, em
+// O(log d) comparações para um valor a d posições da dica, como em
+// `rb_insert_hint`. Retorna o nó com o valor (novo ou existente), a dica da
+// próxima inserção.
+avl_node *avl_insert_hint(avl_tree *tree, avl_node *hint, void *value,
+                          int *inserted);
+
+// Insere o elemento ou, se já existir um igual, substitui seu valor por uma
+// cópia de `value`. Retorna 1 se inseriu e 0 se substituiu.
+int avl_upsert(avl_tree *tree, void *value);
+
 // Remove um elemento na árvore, aplicando balanceamento se necessário.
 int avl_remove(avl_tree *tree, void *value);
 
+// Funções do modo mapa (as demais funções trabalham com as chaves). Os
+// valores novos começam zerados (NULL), e as operações de conjunto exigem
+// dois mapas do mesmo tipo, como em `rb_map_put` e afins.
+
+// Associa uma cópia de `value` à chave com uma única descida, inserindo a
+// chave ou substituindo o valor no lugar. Retorna 1 se inseriu e 0 se
+// substituiu.
+int avl_map_put(avl_tree *tree, void *key, void *value);
+
+// Retorna o valor associado à chave (NULL se não existir).
+void *avl_map_get(avl_tree *tree, void *key);
+
+// Retorna o endereço onde o valor da chave está guardado (um `void**` no modo
+// de ponteiros), para alterá-lo no lugar, ou NULL se a chave não existir.
+void *avl_map_get_ptr(avl_tree *tree, void *key);
+
+// Mesmo que `avl_map_get_ptr` para um nó já encontrado.
+void *avl_map_value_ptr(avl_tree *tree, avl_node *node);
+
+// Constroi a árvore (vazia) a partir de um vetor ordenado e sem duplicatas em
+// O(n), sem chamar `function_compare`. O elemento i fica em
+// `values + i * stride` (como no qsort). Retorna 0 se a árvore não for vazia.
+int avl_build_sorted(avl_tree *tree, const void *values, size_t count,
+                     size_t stride);
+
+// Acrescenta um vetor ordenado e sem duplicatas, cujos elementos são todos
+// maiores que os da árvore, em O(count + log n) (com `avl_build_sorted` e um
+// `join`). Permite carregar a árvore em lotes. Retorna 0 se o primeiro
+// elemento não for maior que o maior da árvore.
+int avl_append_sorted(avl_tree *tree, const void *values, size_t count,
+                      size_t stride);
+
+// Operações de conjunto feitas com `split` e `join`, em O(m log(n/m + 1))
+// (m sendo a menor das duas árvores), mais a cópia dos elementos novos. O
+// resultado fica em `dst` e `src` não é alterada: os nós de `dst` são
+// reaproveitados e só os elementos vindos de `src` são copiados. As duas
+// árvores devem guardar o mesmo tipo de elemento, com a mesma ordem.
+
+// Adiciona a `dst` os elementos de `src`. Retorna quantos foram inseridos.
+unsigned int avl_union(avl_tree *dst, avl_tree *src);
+
+// Mantém em `dst` apenas os elementos que também estão em `src`.
+// Retorna quantos foram removidos.
+unsigned int avl_intersection(avl_tree *dst, avl_tree *src);
+
+// Remove de `dst` os elementos que estão em `src`. Retorna quantos foram
+// removidos.
+unsigned int avl_difference(avl_tree *dst, avl_tree *src);
+
+// Remove os elementos no intervalo [lo, hi) em O(log n + k). `lo` ou `hi`
+// NULL deixam o intervalo aberto. Retorna quantos foram removidos.
+unsigned int avl_erase_range(avl_tree *tree, void *lo, void *hi);
+
 // Busca por um elemento dentro da árvore.
 void *avl_search(avl_tree *tree, void *value);
 
+// Busca `count` elementos de uma vez: `results[i]` recebe o elemento igual a
+// `keys[i]` ou NULL. As buscas são intercaladas com prefetch para sobrepor as
+// faltas de cache. Se `sorted` for verdadeiro, `keys` deve estar em ordem
+// crescente e cada busca parte do ponto onde a anterior terminou.
+void avl_search_many(avl_tree *tree, void **keys, void **results, size_t count,
+                     int sorted);
+
+// Retorna o menor/maior elemento (NULL se vazia) em O(1).
+void *avl_min(avl_tree *tree);
+void *avl_max(avl_tree *tree);
+
+// Remove o menor/maior elemento; `out` (opcional) recebe o elemento como em
+// `rb_pop_min`. Retorna 0 se a árvore estiver vazia.
+int avl_pop_min(avl_tree *tree, void *out);
+int avl_pop_max(avl_tree *tree, void *out);
+
+// Cursores: nós em ordem crescente (NULL indica o fim da árvore).
+// O valor do elemento fica em `node->value`. `avl_first` e `avl_last` são
+// O(1).
+avl_node *avl_first(avl_tree *tree);
+avl_node *avl_last(avl_tree *tree);
+avl_node *avl_next(avl_node *node);
+avl_node *avl_prev(avl_node *node);
+
+// Retorna o primeiro nó com valor >= `value` (NULL se não existir).
+avl_node *avl_lower_bound(avl_tree *tree, void *value);
+
+// Retorna o primeiro nó com valor > `value` (NULL se não existir).
+avl_node *avl_upper_bound(avl_tree *tree, void *value);
+
+// Visita em ordem os elementos no intervalo [lo, hi) em O(log n + k).
+// `lo` ou `hi` NULL deixam o intervalo aberto. Retorna quantos foram visitados.
+unsigned int avl_range(avl_tree *tree, void *lo, void *hi,
+                       avl_function_visit visit, void *ctx);
+
+// Estatísticas de ordem, em O(log n). Requerem AVL_OPT_ORDER_STAT.
+// Retorna o nó na posição `index` (a partir de 0) na ordem crescente.
+avl_node *avl_select(avl_tree *tree, unsigned int index);
+
+// Retorna a quantidade de elementos menores que `value` (sua posição).
+unsigned int avl_rank(avl_tree *tree, void *value);
+
+// Retorna a quantidade de elementos no intervalo [lo, hi) (NULL = aberto).
+unsigned int avl_count_range(avl_tree *tree, void *lo, void *hi);
+
 // Retorna a quantidade de nós totais que a árvore possuí.
 unsigned int avl_size(avl_tree *);
 
+// Copia os contadores de instrumentação para `stats`. Retorna 0 (e zera
+// `stats`) se a biblioteca foi compilada sem COLLECTIONS_STATS, e 0 se `stats`
+// for NULL.
+int avl_stats(avl_tree *tree, avl_tree_stats *stats);
+
+// Zera os contadores de instrumentação.
+void avl_stats_reset(avl_tree *tree);
+
 #endif
\ No newline at end of file
@@ -0,0 +1,69 @@
+#ifndef BTREE_H
+#define BTREE_H
+
+#include <stddef.h>
+
+// Grau mínimo da árvore B: todo nó (exceto a raiz) possui entre
+// BT_MIN_DEGREE - 1 e 2 * BT_MIN_DEGREE - 1 elementos.
+#define BT_MIN_DEGREE 8
+#define BT_MAX_KEYS (2 * BT_MIN_DEGREE - 1)
+
+// Mesmas funções usadas pelas árvores AVL e Rubro-Negra.
+typedef int (*bt_function_compare)(void *, void *);
+typedef void *(*bt_function_copy)(void *);
+typedef void (*bt_function_destroy)(void *);
+
+// Estrutura do nó da árvore B.
+/*
+  Os elementos ficam em sequência logo após o cabeçalho: ponteiros para as
+  cópias (modo padrão) ou os próprios bytes dos valores (modo inline). Nós
+  internos guardam ainda o vetor de filhos depois dos elementos; as folhas
+  são alocadas sem esse vetor.
+*/
+typedef struct bt_node {
+  unsigned int count;                // Quantidade de elementos do nó.
+  unsigned int leaf;                 // 1 se o nó é uma folha.
+  _Alignas(max_align_t) char keys[]; // Elementos (e filhos, nos internos).
+} bt_node;
+
+// Estrutura da árvore B.
+typedef struct {
+  bt_node *root;
+  unsigned int size;
+
+  size_t value_size;      // Tamanho do valor inline (0 usa function_copy).
+  size_t slot_size;       // Bytes ocupados por elemento dentro do nó.
+  size_t children_offset; // Posição do vetor de filhos dentro do nó.
+
+  bt_function_compare function_compare; // Função de comparação.
+  bt_function_copy function_copy;       // Função de copia de memória.
+  bt_function_destroy function_destroy; // Função de destruir a cópia.
+} bt_tree;
+
+// Cria uma árvore B vazia.
+bt_tree *bt_create_tree(bt_function_compare, bt_function_copy,
+                        bt_function_destroy);
+
+// Cria uma árvore B que guarda os valores (de `value_size` bytes) dentro dos
+// nós, sem funções de cópia e destruição.
+bt_tree *bt_create_tree_inline(bt_function_compare, size_t value_size);
+
+// Limpa todos os dados armazenados na árvore.
+void bt_clear(bt_tree *);
+
+// Destroi a árvore desalocando todos os nós.
+void bt_destroy_tree(bt_tree *);
+
+// Insere um elemento na árvore. (não aceita duplicatas)
+int bt_insert(bt_tree *tree, void *value);
+
+// Remove um elemento, se existir, da árvore.
+int bt_remove(bt_tree *tree, void *value);
+
+// Busca por um elemento dentro da árvore.
+void *bt_search(bt_tree *tree, void *value);
+
+// Retorna a quantidade de elementos da árvore.
+unsigned int bt_size(bt_tree *);
+
+#endif
@@ -0,0 +1,77 @@
+#ifndef FROZEN_H
+#define FROZEN_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <avltree.h>
+#include <rbtree.h>
+
+// Mesma função de comparação das árvores (chave, elemento).
+typedef int (*frozen_function_compare)(void *, void *);
+
+// Índice somente leitura, congelado a partir de uma árvore ou vetor ordenado.
+/*
+  Os elementos ficam em um único vetor na ordem de Eytzinger (a ordem de uma
+  busca em largura): a raiz na posição 1 e os filhos de k em 2k e 2k + 1. A
+  busca desce sem desvios condicionais (k = 2k + (chave > elemento)) e pede
+  com antecedência a linha de cache dos descendentes alguns níveis abaixo,
+  que ficam lado a lado no vetor. Não há ponteiros: só os bytes dos
+  elementos ocupam memória.
+
+  Índices de int64_t (`*_i64`) comparam as chaves direto, sem chamar a
+  função de comparação, e têm uma busca em lote vetorizada com AVX2.
+*/
+typedef struct frozen_index {
+  char *keys;          // Elementos em ordem de Eytzinger (posição 0 sem uso).
+  size_t count;        // Quantidade de elementos.
+  size_t element_size; // Bytes de cada elemento.
+  size_t prefetch;     // Descendentes que cabem em uma linha de cache.
+  int is_i64;          // 1 se os elementos são int64_t.
+
+  frozen_function_compare function_compare;
+} frozen_index;
+
+// Congela um vetor ordenado e sem duplicatas (o elemento i fica em
+// `values + i * element_size`). Os bytes dos elementos são copiados.
+frozen_index *frozen_create(const void *values, size_t count,
+                            size_t element_size,
+                            frozen_function_compare compare);
+
+// Congela um vetor ordenado e sem duplicatas de int64_t.
+frozen_index *frozen_create_i64(const int64_t *values, size_t count);
+
+// Congela os elementos da árvore, em O(n). São copiados `element_size` bytes
+// de cada valor (0 usa o `value_size` das árvores inline); em árvores com
+// `function_copy` a cópia é rasa. A árvore continua intacta. Retorna NULL
+// para mapas (`*_create_map*`), cujos valores não caberiam no índice.
+frozen_index *rb_freeze(rb_tree *, size_t element_size);
+frozen_index *avl_freeze(avl_tree *, size_t element_size);
+
+// Congela uma árvore cujos elementos são int64_t (NULL para mapas).
+frozen_index *rb_freeze_i64(rb_tree *);
+frozen_index *avl_freeze_i64(avl_tree *);
+
+// Destroi o índice.
+void frozen_destroy(frozen_index *);
+
+// Retorna a quantidade de elementos do índice.
+size_t frozen_size(frozen_index *);
+
+// Busca o elemento igual a `key` (NULL se não existir).
+const void *frozen_search(frozen_index *, void *key);
+
+// Retorna o primeiro elemento >= `key` (NULL se não existir).
+const void *frozen_lower_bound(frozen_index *, void *key);
+
+// Versões para índices de int64_t (NULL também se o índice não for _i64).
+const int64_t *frozen_search_i64(frozen_index *, int64_t key);
+const int64_t *frozen_lower_bound_i64(frozen_index *, int64_t key);
+
+// Busca `count` chaves de uma vez: `results[i]` recebe o elemento igual a
+// `keys[i]` ou NULL. Com AVX2 as buscas descem de 4 em 4 por vetor (gather);
+// sem AVX2 as buscas são intercaladas para sobrepor as faltas de cache.
+void frozen_search_many_i64(frozen_index *, const int64_t *keys,
+                            const int64_t **results, size_t count);
+
+#endif
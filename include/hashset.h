@@ -0,0 +1,75 @@
+#ifndef HASHSET_H
+#define HASHSET_H
+
+#include <stddef.h>
+
+// Quantidade de bytes de controle examinados de uma vez (um registrador SSE2).
+#define HS_GROUP_WIDTH 16
+
+// Mesmas funções usadas pelas árvores; `function_compare` só é usada para
+// testar igualdade (retorno 0).
+typedef int (*hs_function_compare)(void *, void *);
+typedef void *(*hs_function_copy)(void *);
+typedef void (*hs_function_destroy)(void *);
+
+// Retorna o hash do elemento. Elementos iguais precisam ter o mesmo hash; o
+// valor é misturado pelo conjunto, então até a identidade serve.
+typedef size_t (*hs_function_hash)(void *);
+
+// Conjunto de hash com endereçamento aberto (no estilo "Swiss table").
+/*
+  Cada posição da tabela tem um byte de controle: vazio, removido ou, se
+  ocupada, 7 bits do hash do elemento. A busca lê os bytes de controle em
+  grupos de HS_GROUP_WIDTH (com SSE2, uma comparação por grupo) e só chama
+  `function_compare` nas posições cujo byte coincide, o que quase sempre é
+  apenas a posição do elemento procurado.
+
+  Os elementos ficam em um vetor ao lado dos controles: ponteiros para as
+  cópias (modo padrão) ou os próprios bytes dos valores (modo inline). Não há
+  nós, então cada elemento custa `slot_size` + 1 bytes por posição da tabela,
+  que fica entre 7/16 e 7/8 ocupada.
+*/
+typedef struct hs_set {
+  signed char *ctrl;  // Bytes de controle (`capacity` + HS_GROUP_WIDTH).
+  char *slots;        // Elementos, `slot_size` bytes cada.
+  size_t capacity;    // Posições da tabela (potência de 2, 0 se vazia).
+  size_t growth_left; // Posições vazias que ainda podem ser ocupadas.
+  unsigned int size;
+
+  size_t value_size; // Tamanho do valor inline (0 usa function_copy).
+  size_t slot_size;  // Bytes ocupados por elemento na tabela.
+
+  hs_function_hash function_hash;       // Função de hash.
+  hs_function_compare function_compare; // Função de igualdade.
+  hs_function_copy function_copy;       // Função de copia de memória.
+  hs_function_destroy function_destroy; // Função de destruir a cópia.
+} hs_set;
+
+// Cria um conjunto vazio.
+hs_set *hs_create_set(hs_function_hash, hs_function_compare, hs_function_copy,
+                      hs_function_destroy);
+
+// Cria um conjunto que guarda os valores (de `value_size` bytes) dentro da
+// tabela, sem funções de cópia e destruição.
+hs_set *hs_create_set_inline(hs_function_hash, hs_function_compare,
+                             size_t value_size);
+
+// Remove todos os elementos (a tabela mantém a capacidade).
+void hs_clear(hs_set *);
+
+// Destroi o conjunto e todos os elementos.
+void hs_destroy_set(hs_set *);
+
+// Insere um elemento no conjunto. (não aceita duplicatas)
+int hs_insert(hs_set *set, void *value);
+
+// Remove um elemento, se existir, do conjunto.
+int hs_remove(hs_set *set, void *value);
+
+// Busca um elemento igual a `value` (NULL se não existir), em O(1) esperado.
+void *hs_search(hs_set *set, void *value);
+
+// Retorna a quantidade de elementos do conjunto.
+unsigned int hs_size(hs_set *);
+
+#endif
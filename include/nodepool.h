@@ -0,0 +1,39 @@
+#ifndef NODEPOOL_H
+#define NODEPOOL_H
+
+#include <stddef.h>
+
+// Pool de blocos de tamanho fixo, usado pelas arvores para alocar nós.
+/*
+  Os blocos são recortados de blocos maiores de memória (chunks), cujo tamanho
+  dobra a cada nova alocação até um limite. Blocos liberados voltam para uma
+  lista livre e são reaproveitados pela próxima alocação.
+*/
+typedef struct node_pool {
+  size_t block_size;   // Tamanho de cada bloco (múltiplo de sizeof(void *)).
+  size_t chunk_blocks; // Quantidade de blocos do próximo chunk.
+
+  void *chunks;    // Lista encadeada dos chunks alocados.
+  void *free_list; // Lista encadeada dos blocos liberados.
+  char *cursor;    // Próximo bloco ainda não usado do chunk atual.
+  char *limit;     // Fim do chunk atual.
+
+  size_t chunk_count; // Total de chunks alocados (malloc) desde a criação.
+} node_pool;
+
+// Cria um pool para blocos de `block_size` bytes.
+node_pool *pool_create(size_t block_size);
+
+// Retorna um bloco livre do pool (NULL se faltar memória).
+void *pool_alloc(node_pool *);
+
+// Devolve um bloco para a lista livre do pool.
+void pool_free(node_pool *, void *block);
+
+// Libera todos os chunks de uma só vez (invalida todos os blocos).
+void pool_clear(node_pool *);
+
+// Destroi o pool e toda a memória que ele possui.
+void pool_destroy(node_pool *);
+
+#endif
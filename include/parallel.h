@@ -0,0 +1,66 @@
+#ifndef PARALLEL_H
+#define PARALLEL_H
+
+#include <stddef.h>
+
+#include <avltree.h>
+#include <rbtree.h>
+#include <threadpool.h>
+
+// Acumula o elemento `value` no parcial `acc` (parcial, valor, contexto).
+typedef void (*par_function_reduce)(void *acc, void *value, void *ctx);
+
+// Junta o parcial `other` ao parcial `acc` (parcial, outro, contexto).
+typedef void (*par_function_combine)(void *acc, void *other, void *ctx);
+
+// Operações paralelas sobre as árvores.
+/*
+  A árvore é cortada em sub-árvores de mesma profundidade (cerca de 8 por
+  thread do pool) e cada pedaço em ordem vira uma tarefa, que percorre seus
+  nós pelo sucessor sem recursão. Como as tarefas são distribuídas pela fila
+  do pool, as threads que terminam antes pegam os pedaços restantes e a carga
+  fica equilibrada. A árvore não pode ser modificada durante a operação.
+  Com `pool` NULL (ou árvores pequenas) tudo é feito na thread atual.
+*/
+
+// Visita todos os elementos em paralelo. `visit` é chamada por várias threads
+// ao mesmo tempo e sem ordem definida; retornar 0 interrompe a visita (as
+// outras tarefas param no próximo elemento). Retorna quantos foram visitados.
+unsigned int rb_parallel_for_each(rb_tree *, thread_pool *pool,
+                                  rb_function_visit visit, void *ctx);
+unsigned int avl_parallel_for_each(avl_tree *, thread_pool *pool,
+                                   avl_function_visit visit, void *ctx);
+
+// Reduz todos os elementos em paralelo. `result` (de `result_size` bytes)
+// entra com o elemento neutro e sai com o resultado. Cada pedaço acumula, com
+// `reduce`, em um parcial próprio que começa com o elemento neutro; os
+// parciais são juntados em ordem crescente com `combine`, então basta que a
+// operação seja associativa.
+void rb_parallel_reduce(rb_tree *, thread_pool *pool, void *result,
+                        size_t result_size, par_function_reduce reduce,
+                        par_function_combine combine, void *ctx);
+void avl_parallel_reduce(avl_tree *, thread_pool *pool, void *result,
+                         size_t result_size, par_function_reduce reduce,
+                         par_function_combine combine, void *ctx);
+
+// Constroi a árvore (vazia) a partir de um vetor não ordenado, como em
+// `*_build_sorted`: ordena em paralelo (merge sort estável), descarta as
+// duplicatas (fica a primeira ocorrência, como em inserções sucessivas) e
+// monta a árvore balanceada em O(n). Retorna 0 se a árvore não for vazia ou
+// faltar memória.
+int rb_parallel_build(rb_tree *, thread_pool *pool, const void *values,
+                      size_t count, size_t stride);
+int avl_parallel_build(avl_tree *, thread_pool *pool, const void *values,
+                       size_t count, size_t stride);
+
+// Limpa a árvore em O(1) na thread atual: os elementos são movidos para uma
+// árvore separada (`*_detach`), destruída por uma tarefa do pool. A árvore
+// fica vazia e pronta para uso assim que a função retorna. As funções de
+// destruição dos elementos são chamadas na thread do pool. As operações
+// paralelas esperam apenas pelas suas próprias tarefas, então não ficam
+// presas atrás da destruição; só `tp_wait` e `tp_destroy` esperam por ela.
+// Com `pool` NULL a árvore é limpa na hora.
+void rb_clear_async(rb_tree *, thread_pool *pool);
+void avl_clear_async(avl_tree *, thread_pool *pool);
+
+#endif
@@ -0,0 +1,112 @@
+#ifndef PAVLTREE_H
+#define PAVLTREE_H
+
+#include <stdatomic.h>
+#include <stddef.h>
+#include <stdint.h>
+
+// Mesmas funções usadas pelas árvores.
+typedef int (*pavl_function_compare)(void *, void *);
+typedef void *(*pavl_function_copy)(void *);
+typedef void (*pavl_function_destroy)(void *);
+
+// Função de visita (elemento, contexto). Retornar 0 interrompe a visita.
+typedef int (*pavl_function_visit)(void *, void *);
+
+// Cópia de um elemento compartilhada pelas cópias de um nó (modo padrão).
+typedef struct pavl_value {
+  void *value;
+  atomic_uint refs;
+} pavl_value;
+
+// Nó imutável depois de publicado, compartilhado entre versões. Não tem
+// ponteiro para o pai, pois o mesmo nó pode estar em várias árvores.
+typedef struct pavl_node {
+  void *value;
+  struct pavl_node *left;
+  struct pavl_node *right;
+  pavl_value *box;  // Dono da cópia do elemento (NULL no modo inline).
+  uint64_t stamp;   // Operação que criou o nó (só ela pode alterá-lo).
+  int height;
+  atomic_uint refs; // Pais e versões que apontam para o nó.
+} pavl_node;
+
+// Uma versão da árvore (imutável). Os leitores usam versões como snapshots.
+typedef struct pavl_version {
+  pavl_node *root;
+  unsigned int size;
+  atomic_uint refs;         // Árvore (se for a atual) e snapshots.
+  struct pavl_tree *tree;   // Funções e modo dos elementos.
+} pavl_version;
+
+typedef pavl_version pavl_snapshot;
+
+// Árvore AVL persistente (cópia no caminho).
+/*
+  Cada inserção ou remoção copia apenas os O(log n) nós do caminho alterado
+  (e os das rotações) e compartilha o resto com a versão anterior, publicando
+  uma nova versão. Tirar um snapshot é O(1): conta uma referência na versão
+  atual, que continua válida e inalterada enquanto o escritor segue
+  alterando a árvore. Os nós têm contagem de referências e são liberados
+  quando nenhuma versão os alcança mais.
+
+  Há um único escritor por vez (as funções sem `snapshot` no nome). Os
+  leitores, em qualquer thread, só usam `pavl_snapshot_*`: pegar um snapshot
+  não trava e não espera pelo escritor, e o escritor nunca espera pelos
+  leitores. A contagem de referências da versão atual é dividida: os 16 bits
+  altos de `current` contam os snapshots em andamento, transferidos para a
+  versão quando o escritor publica a próxima (os ponteiros precisam caber em
+  48 bits).
+*/
+typedef struct pavl_tree {
+  _Atomic(uint64_t) current; // Versão atual | (snapshots em andamento << 48).
+  uint64_t stamp;            // Última operação do escritor.
+  size_t value_size;         // Tamanho do valor inline (0 usa function_copy).
+
+  pavl_function_compare function_compare; // Função de comparação.
+  pavl_function_copy function_copy;       // Função de copia de memória.
+  pavl_function_destroy function_destroy; // Função de destruir a cópia.
+} pavl_tree;
+
+// Cria uma árvore vazia.
+pavl_tree *pavl_create_tree(pavl_function_compare, pavl_function_copy,
+                            pavl_function_destroy);
+
+// Cria a árvore guardando os valores (de `value_size` bytes) dentro dos nós.
+pavl_tree *pavl_create_tree_inline(pavl_function_compare, size_t value_size);
+
+// Destroi a árvore. Todos os snapshots precisam ter sido liberados.
+void pavl_destroy_tree(pavl_tree *);
+
+// Insere um elemento e publica a nova versão. (não aceita duplicatas)
+int pavl_insert(pavl_tree *tree, void *value);
+
+// Remove um elemento, se existir, e publica a nova versão. A cópia só é
+// destruída quando nenhum snapshot alcança mais o elemento.
+int pavl_remove(pavl_tree *tree, void *value);
+
+// Busca na versão atual (apenas na thread do escritor).
+void *pavl_search(pavl_tree *tree, void *value);
+
+// Retorna a quantidade de elementos da versão atual.
+unsigned int pavl_size(pavl_tree *);
+
+// Retorna um snapshot da versão atual, em O(1). Pode ser chamada de qualquer
+// thread junto com o escritor.
+pavl_snapshot *pavl_snapshot_take(pavl_tree *);
+
+// Libera o snapshot (os nós que só ele alcançava são liberados).
+void pavl_snapshot_release(pavl_snapshot *);
+
+// Busca por um elemento no snapshot.
+void *pavl_snapshot_search(pavl_snapshot *, void *value);
+
+// Retorna a quantidade de elementos do snapshot.
+unsigned int pavl_snapshot_size(pavl_snapshot *);
+
+// Visita em ordem os elementos do snapshot no intervalo [lo, hi) (`lo` ou
+// `hi` NULL deixam o intervalo aberto). Retorna quantos foram visitados.
+unsigned int pavl_snapshot_range(pavl_snapshot *, void *lo, void *hi,
+                                 pavl_function_visit visit, void *ctx);
+
+#endif
@@ -1,19 +1,72 @@
 #ifndef RBTREE_H
 #define RBTREE_H
 
+#include <stddef.h>
+#include <stdint.h>
+
+#include <nodepool.h>
+
 #define RB_RED 1
 #define RB_BLACK 0
 
+// Opções de criação da arvore (combináveis com `|`).
+#define RB_OPT_POOL 0x1 // Aloca os nós de um pool próprio da arvore.
+// Mantém o tamanho das sub-árvores (rb_select, rb_rank e rb_count_range).
+#define RB_OPT_ORDER_STAT 0x2
+
 typedef int (*rb_function_compare)(void *, void *);
 typedef void *(*rb_function_copy)(void *);
 typedef void (*rb_function_destroy)(void*);
+// Chamada para cada elemento visitado em um intervalo (valor, contexto).
+// Retorna 0 para interromper a visita.
+typedef int (*rb_function_visit)(void*, void*);
+// Extrai do elemento o intervalo [início, fim) que ele representa (arvores
+// de intervalos).
+typedef void (*rb_function_interval)(void*, int64_t* start, int64_t* end);
+
+// Faixas do histograma de profundidade das buscas (a última acumula as
+// buscas mais profundas).
+#define RB_STATS_DEPTHS 64
+
+// Contadores de instrumentação da arvore. Só são mantidos quando a biblioteca
+// é compilada com COLLECTIONS_STATS (opção do CMake); sem ela a arvore nem
+// guarda os contadores e nada é contado. Os contadores não são atômicos:
+// buscas concorrentes na mesma arvore podem perder contagens.
+typedef struct rb_tree_stats {
+    unsigned long long compares;        // Chamadas de `function_compare`.
+    unsigned long long rotations_left;  // Rotações à esquerda.
+    unsigned long long rotations_right; // Rotações à direita.
+    // Casos de `rb_insert_fixup` (1 a 3) e de `rb_remove_fixup` (1 a 4).
+    unsigned long long insert_fixup[3];
+    unsigned long long remove_fixup[4];
+    unsigned long long node_allocs; // Nós alocados.
+    unsigned long long node_frees;  // Nós liberados.
+    // Buscas por valor (rb_search e rb_remove) e quantas visitaram `d` nós em
+    // `search_depth[d]`.
+    unsigned long long searches;
+    unsigned long long search_depth[RB_STATS_DEPTHS];
+} rb_tree_stats;
 
 // Estrutura de no da arvore rubro-negra
+/*
+  Com COLLECTIONS_COMPACT_NODES (opção do CMake) o nó ocupa 32 bytes em vez
+  de 40: a cor fica no bit menos significativo do ponteiro do pai (os nós são
+  alinhados em 8 bytes) e o tamanho da sub-árvore fica logo após o nó, só nas
+  arvores criadas com RB_OPT_ORDER_STAT. Os campos `parent_color` e o tamanho
+  são internos da arvore. Nas arvores de intervalos (nos dois layouts) o
+  maior fim de intervalo da sub-árvore também fica após o nó, antes do valor
+  inline.
+*/
 typedef struct rb_node {
     void* value;
+#ifdef COLLECTIONS_COMPACT_NODES
+    uintptr_t parent_color; // Pai | cor (RB_RED (1) e RB_BLACK (0)).
+#else
     int color; // RB_RED (1) e RB_BLACK (0)
+    unsigned int count; // Quantidade de nós da sub-árvore (RB_OPT_ORDER_STAT).
 
     struct rb_node* parent;
+#endif
     struct rb_node* right;
     struct rb_node* left;
 } rb_node;
@@ -22,38 +75,274 @@ typedef struct rb_node {
 typedef struct rb_tree {
     rb_node* root;
     unsigned int size;
+    unsigned int options; // Opções de criação (RB_OPT_*).
 
     // Substituto para as verificaçoes (node == NULL).
     // Simplifica demais a implementaçao da árvore rubro-negra.
     rb_node* NIL;
 
+    // Menor e maior nós (NIL se vazia), mantidos pelas inserções e remoções
+    // para que `rb_min`, `rb_max` e os cursores não precisem descer a arvore.
+    rb_node* leftmost;
+    rb_node* rightmost;
+    // 1 enquanto a última inserção criou um novo maior nó: só então a
+    // próxima inserção compara primeiro com `rightmost`.
+    int append_probe;
+
     // Função de cópia, para copiar o conteudo dos elementos.
     rb_function_copy function_copy;
     // O programador define como comparar os elementos dentro da arvore.
     rb_function_compare function_compare;
     // E necessario destruir a copia dos elementos copiados.
     rb_function_destroy function_destroy;
+
+    // Pool de nós (NULL quando a arvore usa malloc por nó).
+    node_pool* pool;
+
+    // Tamanho do valor guardado dentro do nó (0 quando usa `function_copy`).
+    size_t value_size;
+    // Tamanho total de cada nó alocado.
+    size_t node_size;
+
+    // Modo mapa (rb_create_map*): o elemento do nó é a chave, e o valor
+    // associado a ela fica em `map_value_offset` dentro do nó (0 se a arvore
+    // não é um mapa). `map_value_size` é o tamanho do valor guardado dentro
+    // do nó (0 quando guarda um ponteiro, copiado com `function_copy_map`).
+    size_t map_value_offset;
+    size_t map_value_size;
+    rb_function_copy function_copy_map;
+    rb_function_destroy function_destroy_map;
+
+    // Arvore de intervalos (rb_create_interval*): extrai o intervalo de cada
+    // elemento (NULL nas demais arvores).
+    rb_function_interval function_interval;
+
+#ifdef COLLECTIONS_STATS
+    rb_tree_stats stats; // Contadores de instrumentação.
+#endif
 } rb_tree;
 
 // Cria uma arvore para a Rubro-Negra.
 rb_tree* rb_create_tree(rb_function_compare, rb_function_copy, rb_function_destroy);
 
+// Cria uma arvore para a Rubro-Negra com opções (RB_OPT_*).
+rb_tree* rb_create_tree_ex(rb_function_compare, rb_function_copy,
+                           rb_function_destroy, unsigned int options);
+
+// Cria uma arvore Rubro-Negra que guarda os valores (de `value_size` bytes)
+// dentro dos nós, sem funções de cópia e destruição.
+rb_tree* rb_create_tree_inline(rb_function_compare, size_t value_size,
+                               unsigned int options);
+
+// Cria um mapa: uma arvore ordenada pelas chaves (`compare`, `copy` e
+// `destroy` valem para as chaves) em que cada chave tem um valor associado.
+// `copy_value` NULL guarda o ponteiro do valor sem copiar; `destroy_value`
+// (opcional) destroi o valor quando ele é substituído ou removido.
+rb_tree* rb_create_map(rb_function_compare, rb_function_copy,
+                       rb_function_destroy, rb_function_copy copy_value,
+                       rb_function_destroy destroy_value,
+                       unsigned int options);
+
+// Cria um mapa que guarda as chaves (de `key_size` bytes) e os valores (de
+// `value_size` bytes) dentro dos nós.
+rb_tree* rb_create_map_inline(rb_function_compare, size_t key_size,
+                              size_t value_size, unsigned int options);
+
+// Cria uma arvore de intervalos: cada elemento representa o intervalo
+// [início, fim) extraído por `interval`, e `compare` precisa ordenar os
+// elementos pelo início (com qualquer desempate). Cada nó guarda também o
+// maior fim da sua sub-árvore, usado pelas buscas `rb_overlap_*`. As demais
+// funções da arvore continuam valendo.
+rb_tree* rb_create_interval(rb_function_compare, rb_function_copy,
+                            rb_function_destroy, rb_function_interval,
+                            unsigned int options);
+
+// Cria uma arvore de intervalos que guarda os valores (de `value_size` bytes)
+// dentro dos nós.
+rb_tree* rb_create_interval_inline(rb_function_compare, rb_function_interval,
+                                   size_t value_size, unsigned int options);
+
 // Limpa toda a arvore rubro-negra.
 void rb_clear(rb_tree*);
 
 // Destroi a arvore rubro-negra.
 void rb_destroy_tree(rb_tree*);
 
+// Destruição sem travar quem limpa a arvore.
+/*
+  `rb_clear` e `rb_destroy_tree` visitam todos os nós (sem recursão), o que
+  leva segundos em arvores enormes. `rb_detach` move os elementos para outra
+  arvore em O(1), e ela pode ser destruída aos poucos com `rb_clear_step` ou
+  em outra thread (`rb_clear_async`, em parallel.h).
+*/
+
+// Move todos os elementos para uma nova arvore (com as mesmas funções e
+// opções), em O(1), e retorna a nova arvore. `tree` fica vazia e pronta para
+// uso.
+rb_tree* rb_detach(rb_tree*);
+
+// Destroi até `budget` nós da arvore e retorna quantos ainda restam. Depois
+// do primeiro passo a arvore só pode receber novos passos, `rb_clear` ou
+// `rb_destroy_tree` até ficar vazia (0).
+unsigned int rb_clear_step(rb_tree*, unsigned int budget);
+
 // Insere um elemento na arvore rubro-negra. (nao aceita duplicatas)
 int rb_insert(rb_tree*, void* value);
 
+// Retorna o elemento igual a `value` se existir; senão insere uma cópia e a
+// retorna. `inserted` (opcional) recebe 1 se inseriu. Faz uma única descida e
+// só copia o valor quando o nó é criado.
+void* rb_find_or_insert(rb_tree*, void* value, int* inserted);
+
+// Insere usando `hint` (um nó da arvore, ou NULL) como ponto de partida: em
+// vez de descer da raiz, sobe da dica só até o ancestral que limita o valor e
+// desce dali, com O(log d) comparações para um valor a d posições da dica (1
+// ou 2 quando é vizinho dela). Retorna o nó com o valor (o novo ou o já
+// existente), que serve de dica para a próxima chave de um fluxo quase
+// ordenado. `inserted` (opcional) recebe 1 se inseriu. Valores maiores que o
+// maior elemento já são inseridos em O(1) comparações por todas as funções de
+// inserção.
+rb_node* rb_insert_hint(rb_tree*, rb_node* hint, void* value, int* inserted);
+
+// Insere o elemento ou, se já existir um igual, substitui seu valor por uma
+// cópia de `value`. Retorna 1 se inseriu e 0 se substituiu.
+int rb_upsert(rb_tree*, void* value);
+
 // Remove um elemento, se existir, da arvore rubro-negra.
 int rb_remove(rb_tree*, void* value);
 
+// Funções do modo mapa. As demais funções da arvore continuam valendo e
+// trabalham com as chaves (`rb_remove` remove a chave e seu valor).
+/*
+  Os valores novos começam zerados (NULL no modo de ponteiros), inclusive
+  nas chaves criadas por `rb_build_sorted`. Nas operações de conjunto os dois
+  mapas precisam ser do mesmo tipo; a união mantém os valores de `dst` e copia
+  os de `src` para as chaves novas.
+*/
+
+// Associa uma cópia de `value` à chave, com uma única descida: insere a
+// chave se não existir ou substitui o valor no lugar. Retorna 1 se inseriu e
+// 0 se substituiu.
+int rb_map_put(rb_tree*, void* key, void* value);
+
+// Retorna o valor associado à chave (o ponteiro guardado, ou o endereço dos
+// bytes no modo inline), ou NULL se a chave não existir.
+void* rb_map_get(rb_tree*, void* key);
+
+// Retorna o endereço onde o valor da chave está guardado (um `void**` no modo
+// de ponteiros), para alterá-lo no lugar sem outra descida, ou NULL se a
+// chave não existir. Ex.: `(*(long*)rb_map_get_ptr(map, &key))++`.
+void* rb_map_get_ptr(rb_tree*, void* key);
+
+// Mesmo que `rb_map_get_ptr` para um nó já encontrado (ex.: ao percorrer o
+// mapa com `rb_first`/`rb_next`).
+void* rb_map_value_ptr(rb_tree*, rb_node* node);
+
+// Constroi a arvore (vazia) a partir de um vetor ordenado e sem duplicatas em
+// O(n), sem chamar `function_compare`. O elemento i fica em
+// `values + i * stride` (como no qsort). Retorna 0 se a arvore nao for vazia.
+int rb_build_sorted(rb_tree*, const void* values, size_t count, size_t stride);
+
+// Acrescenta um vetor ordenado e sem duplicatas, cujos elementos são todos
+// maiores que os da arvore, em O(count + log n) (com `rb_build_sorted` e um
+// `join`). Permite carregar a arvore em lotes. Retorna 0 se o primeiro
+// elemento nao for maior que o maior da arvore.
+int rb_append_sorted(rb_tree*, const void* values, size_t count,
+                     size_t stride);
+
+// Operações de conjunto feitas com `split` e `join`, em O(m log(n/m + 1))
+// (m sendo a menor das duas arvores), mais a cópia dos elementos novos. O
+// resultado fica em `dst` e `src` nao é alterada: os nós de `dst` são
+// reaproveitados e só os elementos vindos de `src` são copiados. As duas
+// arvores devem guardar o mesmo tipo de elemento, com a mesma ordem.
+
+// Adiciona a `dst` os elementos de `src`. Retorna quantos foram inseridos.
+unsigned int rb_union(rb_tree* dst, rb_tree* src);
+
+// Mantém em `dst` apenas os elementos que também estão em `src`.
+// Retorna quantos foram removidos.
+unsigned int rb_intersection(rb_tree* dst, rb_tree* src);
+
+// Remove de `dst` os elementos que estão em `src`. Retorna quantos foram
+// removidos.
+unsigned int rb_difference(rb_tree* dst, rb_tree* src);
+
+// Remove os elementos no intervalo [lo, hi) em O(log n + k). `lo` ou `hi`
+// NULL deixam o intervalo aberto. Retorna quantos foram removidos.
+unsigned int rb_erase_range(rb_tree*, void* lo, void* hi);
+
 // Busca por um elemento, se existir, da arvore rubro-negra.
 void* rb_search(rb_tree*, void* value);
 
+// Busca `count` elementos de uma vez: `results[i]` recebe o elemento igual a
+// `keys[i]` ou NULL. As buscas são intercaladas com prefetch para sobrepor as
+// faltas de cache. Se `sorted` for verdadeiro, `keys` deve estar em ordem
+// crescente e cada busca parte do ponto onde a anterior terminou.
+void rb_search_many(rb_tree*, void** keys, void** results, size_t count,
+                    int sorted);
+
+// Retorna o menor/maior elemento (NULL se vazia) em O(1).
+void* rb_min(rb_tree*);
+void* rb_max(rb_tree*);
+
+// Remove o menor/maior elemento. Se `out` não for NULL ele recebe o elemento
+// (os bytes, no modo inline, ou o ponteiro da cópia, que passa a pertencer a
+// quem chamou e não é destruída). Retorna 0 se a arvore estiver vazia. O novo
+// extremo é o sucessor/antecessor do nó removido, sem descer da raiz.
+int rb_pop_min(rb_tree*, void* out);
+int rb_pop_max(rb_tree*, void* out);
+
+// Cursores: nós em ordem crescente (NULL indica o fim da arvore).
+// O valor do elemento fica em `node->value`. `rb_first` e `rb_last` são O(1).
+rb_node* rb_first(rb_tree*);
+rb_node* rb_last(rb_tree*);
+rb_node* rb_next(rb_tree*, rb_node* node);
+rb_node* rb_prev(rb_tree*, rb_node* node);
+
+// Retorna o primeiro nó com valor >= `value` (NULL se nao existir).
+rb_node* rb_lower_bound(rb_tree*, void* value);
+
+// Retorna o primeiro nó com valor > `value` (NULL se nao existir).
+rb_node* rb_upper_bound(rb_tree*, void* value);
+
+// Visita em ordem os elementos no intervalo [lo, hi) em O(log n + k).
+// `lo` ou `hi` NULL deixam o intervalo aberto. Retorna quantos foram visitados.
+unsigned int rb_range(rb_tree*, void* lo, void* hi, rb_function_visit visit,
+                      void* ctx);
+
+// Buscas por sobreposição, só nas arvores de intervalos. Dois intervalos
+// [a, b) e [lo, hi) se sobrepõem se a < hi e lo < b; um ponto p é o
+// intervalo [p, p + 1).
+
+// Retorna um nó cujo intervalo se sobrepõe a [lo, hi), ou NULL, em O(log n).
+rb_node* rb_overlap_any(rb_tree*, int64_t lo, int64_t hi);
+
+// Visita em ordem os elementos cujos intervalos se sobrepõem a [lo, hi). Só
+// desce nas sub-árvores cujo maior fim passa de `lo` e para no primeiro
+// início a partir de `hi`: O(log n + k) para resultados agrupados, O(k log n)
+// no pior caso. Retorna quantos foram visitados.
+unsigned int rb_overlap_all(rb_tree*, int64_t lo, int64_t hi,
+                            rb_function_visit visit, void* ctx);
+
+// Estatísticas de ordem, em O(log n). Requerem RB_OPT_ORDER_STAT.
+// Retorna o nó na posição `index` (a partir de 0) na ordem crescente.
+rb_node* rb_select(rb_tree*, unsigned int index);
+
+// Retorna a quantidade de elementos menores que `value` (sua posição).
+unsigned int rb_rank(rb_tree*, void* value);
+
+// Retorna a quantidade de elementos no intervalo [lo, hi) (NULL = aberto).
+unsigned int rb_count_range(rb_tree*, void* lo, void* hi);
+
 // Retorna a quantidade de elementos da arvore rubro-negra.
 unsigned int rb_size(rb_tree*);
 
+// Copia os contadores de instrumentação para `stats`. Retorna 0 (e zera
+// `stats`) se a biblioteca foi compilada sem COLLECTIONS_STATS, e 0 se `stats`
+// for NULL.
+int rb_stats(rb_tree*, rb_tree_stats* stats);
+
+// Zera os contadores de instrumentação.
+void rb_stats_reset(rb_tree*);
+
 #endif
\ No newline at end of file
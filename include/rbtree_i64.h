@@ -0,0 +1,12 @@
+#ifndef RBTREE_I64_H
+#define RBTREE_I64_H
+
+#include <stdint.h>
+
+#include <rbtree_typed.h>
+
+// Árvore Rubro-Negra especializada para chaves `int64_t` (ver rbtree_typed.h).
+// Gera o tipo `rb_i64` e as funções `rb_i64_insert`, `rb_i64_search`, etc.
+RB_TYPED_PROTOTYPE(rb_i64, int64_t)
+
+#endif
@@ -0,0 +1,391 @@
+#ifndef RBTREE_TYPED_H
+#define RBTREE_TYPED_H
+
+#include <stdlib.h>
+
+#include <rbtree.h>
+
+/*
+  Gerador de árvores Rubro-Negras especializadas para um tipo de chave.
+
+  As árvores genéricas (rbtree.h) guardam `void *` e chamam a comparação por
+  ponteiro de função em cada nível. Aqui a chave fica dentro do nó e a
+  comparação é uma macro (ou função inline) conhecida em tempo de compilação,
+  então o compilador pode inlinear a descida inteira.
+
+  Uso:
+
+    // Comparação: recebe dois `const tipo *` e retorna <0, 0 ou >0.
+    #define PAR_CMP(a, b) ((a)->id != (b)->id ? ((a)->id > (b)->id) - \
+                                                ((a)->id < (b)->id)   \
+                                              : ((a)->seq > (b)->seq) - \
+                                                ((a)->seq < (b)->seq))
+    typedef struct { uint64_t id; uint32_t seq; } par;
+
+    RB_TYPED_PROTOTYPE(par_tree, par)          // No header.
+    RB_TYPED_GENERATE(par_tree, par, PAR_CMP)  // Em um único .c.
+
+  ou, para uso dentro de um único arquivo:
+
+    RB_TYPED_PROTOTYPE_STATIC(par_tree, par)
+    RB_TYPED_GENERATE_STATIC(par_tree, par, PAR_CMP)
+
+  Funções geradas (prefixo `name`):
+
+    name *name_create(void);                      // Árvore vazia.
+    void name_init(name *);                       // Inicializa uma árvore.
+    void name_clear(name *);                      // Remove todos os nós.
+    void name_destroy(name *);                    // Limpa e libera.
+    int name_insert(name *, const tipo *key);     // 1 se inseriu, 0 se
+                                                  // duplicata e -1 se
+                                                  // faltar memória.
+    int name_remove(name *, const tipo *key);     // 0 se não existir.
+    tipo *name_search(name *, const tipo *key);   // NULL se não existir.
+    unsigned int name_size(name *);
+    name_node *name_first(name *);                // Cursores em ordem
+    name_node *name_next(name *, name_node *);    // crescente (NULL = fim).
+*/
+
+#define RB_TYPED_PROTOTYPE_INTERNAL(name, type, attr)                          \
+  typedef struct name##_node {                                                 \
+    type key;                                                                  \
+    int color;                                                                 \
+    struct name##_node *parent;                                                \
+    struct name##_node *right;                                                 \
+    struct name##_node *left;                                                  \
+  } name##_node;                                                               \
+                                                                               \
+  typedef struct name {                                                        \
+    name##_node *root;                                                         \
+    unsigned int size;                                                         \
+    name##_node nil; /* Sentinela, como o NIL da árvore genérica. */           \
+  } name;                                                                      \
+                                                                               \
+  attr name *name##_create(void);                                              \
+  attr void name##_init(name *tree);                                           \
+  attr void name##_clear(name *tree);                                          \
+  attr void name##_destroy(name *tree);                                        \
+  attr int name##_insert(name *tree, const type *key);                         \
+  attr int name##_remove(name *tree, const type *key);                         \
+  attr type *name##_search(name *tree, const type *key);                       \
+  attr unsigned int name##_size(name *tree);                                   \
+  attr name##_node *name##_first(name *tree);                                  \
+  attr name##_node *name##_next(name *tree, name##_node *node);
+
+#define RB_TYPED_PROTOTYPE(name, type) RB_TYPED_PROTOTYPE_INTERNAL(name, type, )
+#define RB_TYPED_PROTOTYPE_STATIC(name, type)                                  \
+  RB_TYPED_PROTOTYPE_INTERNAL(name, type, static inline)
+
+#define RB_TYPED_GENERATE(name, type, cmp)                                     \
+  RB_TYPED_GENERATE_INTERNAL(name, type, cmp, )
+#define RB_TYPED_GENERATE_STATIC(name, type, cmp)                              \
+  RB_TYPED_GENERATE_INTERNAL(name, type, cmp, static inline)
+
+#define RB_TYPED_GENERATE_INTERNAL(name, type, cmp, attr)                      \
+  static void name##_rotate_left(name *tree, name##_node *x) {                 \
+    name##_node *y = x->right;                                                 \
+    x->right = y->left;                                                        \
+    if (y->left != &tree->nil)                                                 \
+      y->left->parent = x;                                                     \
+    y->parent = x->parent;                                                     \
+    if (x->parent == &tree->nil)                                               \
+      tree->root = y;                                                          \
+    else if (x == x->parent->left)                                             \
+      x->parent->left = y;                                                     \
+    else                                                                       \
+      x->parent->right = y;                                                    \
+    y->left = x;                                                               \
+    x->parent = y;                                                             \
+  }                                                                            \
+                                                                               \
+  static void name##_rotate_right(name *tree, name##_node *y) {                \
+    name##_node *x = y->left;                                                  \
+    y->left = x->right;                                                        \
+    if (x->right != &tree->nil)                                                \
+      x->right->parent = y;                                                    \
+    x->parent = y->parent;                                                     \
+    if (y->parent == &tree->nil)                                               \
+      tree->root = x;                                                          \
+    else if (y == y->parent->right)                                            \
+      y->parent->right = x;                                                    \
+    else                                                                       \
+      y->parent->left = x;                                                     \
+    x->right = y;                                                              \
+    y->parent = x;                                                             \
+  }                                                                            \
+                                                                               \
+  static void name##_transplant(name *tree, name##_node *u, name##_node *v) {  \
+    if (u->parent == &tree->nil)                                               \
+      tree->root = v;                                                          \
+    else if (u == u->parent->left)                                             \
+      u->parent->left = v;                                                     \
+    else                                                                       \
+      u->parent->right = v;                                                    \
+    v->parent = u->parent;                                                     \
+  }                                                                            \
+                                                                               \
+  static void name##_insert_fixup(name *tree, name##_node *z) {                \
+    while (z->parent->color == RB_RED) {                                       \
+      name##_node *g = z->parent->parent;                                      \
+      if (z->parent == g->left) {                                              \
+        name##_node *y = g->right;                                             \
+        if (y->color == RB_RED) {                                              \
+          z->parent->color = RB_BLACK;                                         \
+          y->color = RB_BLACK;                                                 \
+          g->color = RB_RED;                                                   \
+          z = g;                                                               \
+        } else {                                                               \
+          if (z == z->parent->right) {                                         \
+            z = z->parent;                                                     \
+            name##_rotate_left(tree, z);                                       \
+          }                                                                    \
+          z->parent->color = RB_BLACK;                                         \
+          z->parent->parent->color = RB_RED;                                   \
+          name##_rotate_right(tree, z->parent->parent);                        \
+        }                                                                      \
+      } else {                                                                 \
+        name##_node *y = g->left;                                              \
+        if (y->color == RB_RED) {                                              \
+          z->parent->color = RB_BLACK;                                         \
+          y->color = RB_BLACK;                                                 \
+          g->color = RB_RED;                                                   \
+          z = g;                                                               \
+        } else {                                                               \
+          if (z == z->parent->left) {                                          \
+            z = z->parent;                                                     \
+            name##_rotate_right(tree, z);                                      \
+          }                                                                    \
+          z->parent->color = RB_BLACK;                                         \
+          z->parent->parent->color = RB_RED;                                   \
+          name##_rotate_left(tree, z->parent->parent);                         \
+        }                                                                      \
+      }                                                                        \
+    }                                                                          \
+    tree->root->color = RB_BLACK;                                              \
+  }                                                                            \
+                                                                               \
+  static void name##_remove_fixup(name *tree, name##_node *x) {                \
+    while (x != tree->root && x->color == RB_BLACK) {                          \
+      if (x == x->parent->left) {                                              \
+        name##_node *w = x->parent->right;                                     \
+        if (w->color == RB_RED) {                                              \
+          w->color = RB_BLACK;                                                 \
+          x->parent->color = RB_RED;                                           \
+          name##_rotate_left(tree, x->parent);                                 \
+          w = x->parent->right;                                                \
+        }                                                                      \
+        if (w->left->color == RB_BLACK && w->right->color == RB_BLACK) {       \
+          w->color = RB_RED;                                                   \
+          x = x->parent;                                                       \
+        } else {                                                               \
+          if (w->right->color == RB_BLACK) {                                   \
+            w->left->color = RB_BLACK;                                         \
+            w->color = RB_RED;                                                 \
+            name##_rotate_right(tree, w);                                      \
+            w = x->parent->right;                                              \
+          }                                                                    \
+          w->color = x->parent->color;                                         \
+          x->parent->color = RB_BLACK;                                         \
+          w->right->color = RB_BLACK;                                          \
+          name##_rotate_left(tree, x->parent);                                 \
+          x = tree->root;                                                      \
+        }                                                                      \
+      } else {                                                                 \
+        name##_node *w = x->parent->left;                                      \
+        if (w->color == RB_RED) {                                              \
+          w->color = RB_BLACK;                                                 \
+          x->parent->color = RB_RED;                                           \
+          name##_rotate_right(tree, x->parent);                                \
+          w = x->parent->left;                                                 \
+        }                                                                      \
+        if (w->right->color == RB_BLACK && w->left->color == RB_BLACK) {       \
+          w->color = RB_RED;                                                   \
+          x = x->parent;                                                       \
+        } else {                                                               \
+          if (w->left->color == RB_BLACK) {                                    \
+            w->right->color = RB_BLACK;                                        \
+            w->color = RB_RED;                                                 \
+            name##_rotate_left(tree, w);                                       \
+            w = x->parent->left;                                               \
+          }                                                                    \
+          w->color = x->parent->color;                                         \
+          x->parent->color = RB_BLACK;                                         \
+          w->left->color = RB_BLACK;                                           \
+          name##_rotate_right(tree, x->parent);                                \
+          x = tree->root;                                                      \
+        }                                                                      \
+      }                                                                        \
+    }                                                                          \
+    x->color = RB_BLACK;                                                       \
+  }                                                                            \
+                                                                               \
+  static name##_node *name##_find(name *tree, const type *key) {               \
+    name##_node *node = tree->root;                                            \
+    while (node != &tree->nil) {                                               \
+      int c = cmp(key, &node->key);                                            \
+      if (c < 0)                                                               \
+        node = node->left;                                                     \
+      else if (c > 0)                                                          \
+        node = node->right;                                                    \
+      else                                                                     \
+        return node;                                                           \
+    }                                                                          \
+    return NULL;                                                               \
+  }                                                                            \
+                                                                               \
+  attr void name##_init(name *tree) {                                          \
+    tree->size = 0;                                                            \
+    tree->nil.color = RB_BLACK;                                                \
+    tree->nil.parent = &tree->nil;                                             \
+    tree->nil.left = &tree->nil;                                               \
+    tree->nil.right = &tree->nil;                                              \
+    tree->root = &tree->nil;                                                   \
+  }                                                                            \
+                                                                               \
+  attr name *name##_create(void) {                                             \
+    name *tree = (name *)malloc(sizeof(name));                                 \
+    if (tree != NULL)                                                          \
+      name##_init(tree);                                                       \
+    return tree;                                                               \
+  }                                                                            \
+                                                                               \
+  /* Libera os nós sem recursão: sempre remove uma folha e volta ao pai. */    \
+  attr void name##_clear(name *tree) {                                         \
+    name##_node *node = tree->root;                                            \
+    while (node != &tree->nil) {                                               \
+      if (node->left != &tree->nil) {                                          \
+        node = node->left;                                                     \
+      } else if (node->right != &tree->nil) {                                  \
+        node = node->right;                                                    \
+      } else {                                                                 \
+        name##_node *parent = node->parent;                                    \
+        if (parent != &tree->nil) {                                            \
+          if (parent->left == node)                                            \
+            parent->left = &tree->nil;                                         \
+          else                                                                 \
+            parent->right = &tree->nil;                                        \
+        }                                                                      \
+        free(node);                                                            \
+        node = parent;                                                         \
+      }                                                                        \
+    }                                                                          \
+    tree->root = &tree->nil;                                                   \
+    tree->size = 0;                                                            \
+  }                                                                            \
+                                                                               \
+  attr void name##_destroy(name *tree) {                                       \
+    if (tree == NULL)                                                          \
+      return;                                                                  \
+    name##_clear(tree);                                                        \
+    free(tree);                                                                \
+  }                                                                            \
+                                                                               \
+  attr int name##_insert(name *tree, const type *key) {                        \
+    name##_node *y = &tree->nil;                                               \
+    name##_node *x = tree->root;                                               \
+    int c = 0;                                                                 \
+    while (x != &tree->nil) {                                                  \
+      y = x;                                                                   \
+      c = cmp(key, &x->key);                                                   \
+      if (c < 0)                                                               \
+        x = x->left;                                                           \
+      else if (c > 0)                                                          \
+        x = x->right;                                                          \
+      else                                                                     \
+        return 0;                                                              \
+    }                                                                          \
+                                                                               \
+    name##_node *z = (name##_node *)malloc(sizeof(name##_node));               \
+    if (z == NULL)                                                             \
+      return -1; /* Sem memória (diferente de uma duplicata). */               \
+    z->key = *key;                                                             \
+    z->left = &tree->nil;                                                      \
+    z->right = &tree->nil;                                                     \
+    z->color = RB_RED;                                                         \
+    z->parent = y;                                                             \
+                                                                               \
+    /* O lado vem da última comparação da descida. */                          \
+    if (y == &tree->nil)                                                       \
+      tree->root = z;                                                          \
+    else if (c < 0)                                                            \
+      y->left = z;                                                             \
+    else                                                                       \
+      y->right = z;                                                            \
+                                                                               \
+    tree->size++;                                                              \
+    name##_insert_fixup(tree, z);                                              \
+    return 1;                                                                  \
+  }                                                                            \
+                                                                               \
+  attr int name##_remove(name *tree, const type *key) {                        \
+    name##_node *z = name##_find(tree, key);                                   \
+    if (z == NULL)                                                             \
+      return 0;                                                                \
+                                                                               \
+    name##_node *y = z;                                                        \
+    name##_node *x;                                                            \
+    int y_original_color = y->color;                                           \
+    if (z->left == &tree->nil) {                                               \
+      x = z->right;                                                            \
+      name##_transplant(tree, z, z->right);                                    \
+    } else if (z->right == &tree->nil) {                                       \
+      x = z->left;                                                             \
+      name##_transplant(tree, z, z->left);                                     \
+    } else {                                                                   \
+      y = z->right;                                                            \
+      while (y->left != &tree->nil)                                            \
+        y = y->left;                                                           \
+      y_original_color = y->color;                                             \
+      x = y->right;                                                            \
+      if (y->parent == z) {                                                    \
+        x->parent = y;                                                         \
+      } else {                                                                 \
+        name##_transplant(tree, y, y->right);                                  \
+        y->right = z->right;                                                   \
+        y->right->parent = y;                                                  \
+      }                                                                        \
+      name##_transplant(tree, z, y);                                           \
+      y->left = z->left;                                                       \
+      y->left->parent = y;                                                     \
+      y->color = z->color;                                                     \
+    }                                                                          \
+                                                                               \
+    free(z);                                                                   \
+    tree->size--;                                                              \
+    if (y_original_color == RB_BLACK)                                          \
+      name##_remove_fixup(tree, x);                                            \
+    return 1;                                                                  \
+  }                                                                            \
+                                                                               \
+  attr type *name##_search(name *tree, const type *key) {                      \
+    name##_node *node = name##_find(tree, key);                                \
+    return (node != NULL) ? &node->key : NULL;                                 \
+  }                                                                            \
+                                                                               \
+  attr unsigned int name##_size(name *tree) { return tree->size; }             \
+                                                                               \
+  attr name##_node *name##_first(name *tree) {                                 \
+    name##_node *node = tree->root;                                            \
+    if (node == &tree->nil)                                                    \
+      return NULL;                                                             \
+    while (node->left != &tree->nil)                                           \
+      node = node->left;                                                       \
+    return node;                                                               \
+  }                                                                            \
+                                                                               \
+  attr name##_node *name##_next(name *tree, name##_node *node) {               \
+    if (node->right != &tree->nil) {                                           \
+      node = node->right;                                                      \
+      while (node->left != &tree->nil)                                         \
+        node = node->left;                                                     \
+      return node;                                                             \
+    }                                                                          \
+    name##_node *parent = node->parent;                                        \
+    while (parent != &tree->nil && node == parent->right) {                    \
+      node = parent;                                                           \
+      parent = parent->parent;                                                 \
+    }                                                                          \
+    return (parent != &tree->nil) ? parent : NULL;                             \
+  }
+
+#endif
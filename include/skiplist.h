@@ -0,0 +1,116 @@
+#ifndef SKIPLIST_H
+#define SKIPLIST_H
+
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stddef.h>
+#include <stdint.h>
+
+// Quantidade máxima de níveis de um nó.
+#define SL_MAX_LEVEL 24
+
+// Mesmas funções usadas pelas árvores.
+typedef int (*sl_function_compare)(void *, void *);
+typedef void *(*sl_function_copy)(void *);
+typedef void (*sl_function_destroy)(void *);
+
+// Função de visita (elemento, contexto). Retornar 0 interrompe a visita.
+typedef int (*sl_function_visit)(void *, void *);
+
+// Nó da lista. Cada ponteiro `next` guarda no bit mais baixo a marca de
+// remoção lógica do nó naquele nível.
+typedef struct sl_node {
+  void *value;
+  int height;                    // Níveis em que o nó está (1 a SL_MAX_LEVEL).
+  atomic_int refs;               // Donos que ainda podem religar o nó.
+  struct sl_node *retired_next;  // Próximo nó na lista de aposentados.
+  _Atomic(uintptr_t) next[];     // Próximo nó em cada nível (+ marca).
+} sl_node;
+
+// Estado de uma thread na recuperação de memória por épocas.
+typedef struct sl_thread {
+  pthread_t owner;
+  atomic_uint_fast64_t state; // (época << 1) | 1 enquanto ativa.
+  unsigned int nesting;       // Seções `sl_pin` abertas.
+  unsigned int seed;          // Estado do gerador de níveis.
+  atomic_long size;           // Inserções menos remoções feitas pela thread.
+
+  // Nós removidos esperando todas as threads saírem da época em que foram
+  // desconectados (três épocas em rodízio).
+  sl_node *retired[3];
+  uint64_t retired_epoch[3];
+  unsigned int retired_count;
+
+  struct sl_thread *next;
+} sl_thread;
+
+// Lista de saltos (skip list) ordenada e sem travas, para várias threads.
+/*
+  Inserções e remoções trocam os ponteiros com compare-and-swap (CAS): um nó
+  é removido logicamente marcando seus ponteiros e depois desconectado por
+  quem passar por ele. Buscas e percursos só leem, sem nunca esperar por
+  outra thread, e as operações em partes diferentes da lista não disputam as
+  mesmas linhas de cache, ao contrário de uma árvore protegida por um mutex.
+
+  A memória dos nós removidos é liberada por épocas: cada operação anuncia a
+  época global em que entrou, e um nó desconectado na época e só é destruído
+  quando a época global chega a e + 2, quando nenhuma thread pode mais estar
+  lendo-o. Cada thread que usa a lista ganha um registro (reaproveitado por
+  outra thread com o mesmo `pthread_t` depois que ela termina).
+*/
+typedef struct sl_list {
+  sl_node *head;        // Sentinela com SL_MAX_LEVEL níveis.
+  uint64_t id;          // Identifica a lista no cache das threads.
+
+  atomic_uint_fast64_t epoch;   // Época global.
+  _Atomic(sl_thread *) threads; // Registros das threads.
+
+  sl_function_compare function_compare; // Função de comparação.
+  sl_function_copy function_copy;       // Função de copia de memória.
+  sl_function_destroy function_destroy; // Função de destruir a cópia.
+} sl_list;
+
+// Cria uma lista vazia.
+sl_list *sl_create_list(sl_function_compare, sl_function_copy,
+                        sl_function_destroy);
+
+// Destroi a lista, todos os elementos e os nós ainda não liberados. Nenhuma
+// outra thread pode estar usando a lista.
+void sl_destroy_list(sl_list *);
+
+// Insere uma cópia do elemento (não aceita duplicatas). Retorna 1 se inseriu.
+int sl_insert(sl_list *list, void *value);
+
+// Remove o elemento igual a `value`, se existir. A cópia é destruída quando
+// nenhuma thread puder mais lê-la.
+int sl_remove(sl_list *list, void *value);
+
+// Retorna 1 se existir um elemento igual a `value`.
+int sl_contains(sl_list *list, void *value);
+
+// Busca o elemento igual a `value` (NULL se não existir). Se outra thread
+// puder removê-lo, o elemento só pode ser lido dentro de `sl_pin`/`sl_unpin`.
+void *sl_search(sl_list *list, void *value);
+
+// Abre/fecha uma seção em que os nós e elementos lidos não são liberados,
+// mesmo se removidos por outra thread. As seções podem ser aninhadas; não
+// devem durar muito, pois seguram a memória de todas as remoções.
+void sl_pin(sl_list *);
+void sl_unpin(sl_list *);
+
+// Cursores: nós em ordem crescente, ignorando os removidos (NULL indica o
+// fim). Com outras threads alterando a lista, use-os dentro de `sl_pin`.
+sl_node *sl_first(sl_list *);
+sl_node *sl_next(sl_list *, sl_node *node);
+
+// Visita em ordem os elementos no intervalo [lo, hi) (`lo` ou `hi` NULL
+// deixam o intervalo aberto), dentro de uma seção `sl_pin`. Retorna quantos
+// foram visitados.
+unsigned int sl_range(sl_list *, void *lo, void *hi, sl_function_visit visit,
+                      void *ctx);
+
+// Retorna a quantidade de elementos (aproximada durante alterações). Cada
+// thread conta as suas alterações e a função soma as contagens, em O(threads).
+unsigned int sl_size(sl_list *);
+
+#endif
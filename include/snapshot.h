@@ -0,0 +1,118 @@
+#ifndef SNAPSHOT_H
+#define SNAPSHOT_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <avltree.h>
+#include <rbtree.h>
+
+// Versão atual do formato do arquivo.
+#define SNAP_VERSION 1
+
+// Formato do arquivo (na ordem de bytes de quem gravou).
+/*
+  [cabeçalho de 64 bytes][registros em ordem crescente][tabela de offsets]
+
+  Com registros de tamanho fixo (`record_size` > 0) o registro i fica em
+  `data + i * record_size` e não existe tabela. Com tamanho variável a tabela
+  guarda `count + 1` offsets (a partir de `data`), alinhada em 8 bytes, e o
+  registro i ocupa [offsets[i], offsets[i + 1]).
+*/
+typedef struct snap_header {
+  char magic[8];         // "CCSNAP" seguido de dois zeros.
+  uint32_t version;      // SNAP_VERSION.
+  uint32_t byte_order;   // 0x01020304 gravado na ordem de bytes nativa.
+  uint64_t count;        // Quantidade de registros.
+  uint64_t record_size;  // Tamanho fixo dos registros (0 se variável).
+  uint64_t data_offset;  // Início dos registros.
+  uint64_t data_size;    // Bytes ocupados pelos registros.
+  uint64_t index_offset; // Início da tabela de offsets (0 se não existe).
+  uint64_t reserved;
+} snap_header;
+
+// Grava o elemento `value` em `buffer` (com `capacity` bytes) e retorna o
+// tamanho do registro. Se o retorno for maior que `capacity` a função é
+// chamada de novo com um buffer grande o suficiente.
+typedef size_t (*snap_function_serialize)(void *value, void *buffer,
+                                          size_t capacity, void *ctx);
+
+// Converte o registro (de `size` bytes) no elemento em `element`, que depois
+// é copiado para a árvore como em `*_build_sorted`.
+typedef void (*snap_function_deserialize)(const void *record, size_t size,
+                                          void *element, void *ctx);
+
+// Compara a chave buscada com um registro (chave, registro), como as funções
+// de comparação das árvores.
+typedef int (*snap_function_compare)(void *, void *);
+
+// Visita um registro (registro, tamanho, contexto). Retorna 0 para parar.
+typedef int (*snap_function_visit)(const void *, size_t, void *);
+
+// Snapshot aberto somente para leitura, mapeado na memória (mmap).
+/*
+  As buscas são feitas direto no mapeamento, sem alocar nada por elemento:
+  as páginas do arquivo são carregadas sob demanda pelo sistema.
+*/
+typedef struct snapshot {
+  void *map;
+  size_t map_size;
+
+  const char *data;         // Primeiro registro.
+  const uint64_t *offsets;  // Tabela de offsets (NULL se tamanho fixo).
+  size_t count;             // Quantidade de registros.
+  size_t record_size;       // Tamanho fixo dos registros (0 se variável).
+
+  snap_function_compare function_compare;
+} snapshot;
+
+// Grava os elementos da árvore, em ordem, no arquivo `path`. `serialize`
+// NULL grava os bytes dos valores inline (`value_size`) como registros de
+// tamanho fixo. O arquivo é escrito em `path` + ".tmp" e renomeado no fim,
+// então um snapshot anterior nunca fica pela metade. Mapas (`*_create_map*`)
+// não são aceitos, pois os registros não guardam os valores associados às
+// chaves. Retorna 0 em erro.
+int rb_snapshot_save(rb_tree *, const char *path,
+                     snap_function_serialize serialize, void *ctx);
+int avl_snapshot_save(avl_tree *, const char *path,
+                      snap_function_serialize serialize, void *ctx);
+
+// Carrega o snapshot na árvore (vazia). Com `deserialize` NULL os registros
+// (de tamanho fixo) são os próprios elementos e a árvore é montada direto do
+// mapeamento; senão os registros são convertidos em lotes em elementos de
+// `element_size` bytes e acrescentados com `*_append_sorted`. Custa O(n), sem
+// comparações. Retorna 0 se a árvore não for vazia, for um mapa ou faltar
+// memória.
+int rb_snapshot_load(rb_tree *, snapshot *snap,
+                     snap_function_deserialize deserialize,
+                     size_t element_size, void *ctx);
+int avl_snapshot_load(avl_tree *, snapshot *snap,
+                      snap_function_deserialize deserialize,
+                      size_t element_size, void *ctx);
+
+// Abre o snapshot com mmap, validando o cabeçalho. Retorna NULL em erro.
+snapshot *snap_open(const char *path, snap_function_compare compare);
+
+// Desfaz o mapeamento e libera o snapshot.
+void snap_close(snapshot *);
+
+// Retorna a quantidade de registros.
+size_t snap_count(snapshot *);
+
+// Retorna o registro na posição `index` e seu tamanho em `size` (opcional).
+const void *snap_record(snapshot *, size_t index, size_t *size);
+
+// Retorna a posição do primeiro registro >= `key` (`count` se não existir),
+// com uma busca binária em O(log n).
+size_t snap_lower_bound(snapshot *, void *key);
+
+// Retorna o registro igual a `key` (NULL se não existir) e seu tamanho em
+// `size` (opcional).
+const void *snap_search(snapshot *, void *key, size_t *size);
+
+// Visita em ordem os registros no intervalo [lo, hi) em O(log n + k). `lo` ou
+// `hi` NULL deixam o intervalo aberto. Retorna quantos foram visitados.
+size_t snap_range(snapshot *, void *lo, void *hi, snap_function_visit visit,
+                  void *ctx);
+
+#endif
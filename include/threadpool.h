@@ -0,0 +1,75 @@
+#ifndef THREADPOOL_H
+#define THREADPOOL_H
+
+#include <pthread.h>
+
+// Tarefa executada por uma das threads do pool (recebe o seu argumento).
+typedef void (*tp_function_task)(void *);
+
+// Grupo de tarefas, para esperar só pelas tarefas de uma operação (e não
+// pelas de todo o pool). Fica na pilha de quem envia as tarefas.
+typedef struct tp_group {
+  unsigned int pending; // Tarefas do grupo na fila ou em execução.
+} tp_group;
+
+// Tarefa na fila do pool.
+typedef struct tp_task {
+  tp_function_task function;
+  void *arg;
+  tp_group *group; // Grupo da tarefa (NULL se não tiver).
+  struct tp_task *next;
+} tp_task;
+
+// Pool de threads com uma fila de tarefas (FIFO).
+/*
+  As threads são criadas uma única vez e ficam esperando por tarefas na fila.
+  `tp_wait` bloqueia até que todas as tarefas enviadas tenham terminado.
+  Operações que dividem o pool com outras esperam apenas pelas suas, com
+  `tp_wait_group`: enquanto espera, a thread executa ela mesma as tarefas do
+  grupo que ainda estão na fila, então a espera não depende de threads
+  livres e pode ser feita de dentro de uma tarefa do pool.
+*/
+typedef struct thread_pool {
+  pthread_t *threads;
+  unsigned int thread_count;
+
+  tp_task *head; // Próxima tarefa a executar.
+  tp_task *tail; // Última tarefa enviada.
+  unsigned int pending; // Tarefas na fila ou em execução.
+  int stop;             // 1 quando o pool está sendo destruído.
+
+  pthread_mutex_t lock;
+  pthread_cond_t has_task;   // Sinalizada quando uma tarefa entra na fila.
+  pthread_cond_t idle;       // Sinalizada quando `pending` chega a zero.
+  pthread_cond_t group_done; // Sinalizada quando um grupo termina.
+} thread_pool;
+
+// Cria um pool com `threads` threads (0 usa a quantidade de processadores).
+thread_pool *tp_create(unsigned int threads);
+
+// Envia uma tarefa para o pool. Retorna 0 se faltar memória.
+int tp_submit(thread_pool *, tp_function_task function, void *arg);
+
+// Envia uma tarefa do grupo `group` para o pool. Retorna 0 se faltar
+// memória (a tarefa não conta no grupo).
+int tp_submit_group(thread_pool *, tp_group *group, tp_function_task function,
+                    void *arg);
+
+// Espera todas as tarefas enviadas terminarem, inclusive as de outras
+// operações. Não pode ser chamada de dentro de uma tarefa do pool.
+void tp_wait(thread_pool *);
+
+// Inicializa um grupo vazio.
+void tp_group_init(tp_group *);
+
+// Espera apenas as tarefas do grupo terminarem, executando na thread atual
+// as que ainda não começaram.
+void tp_wait_group(thread_pool *, tp_group *group);
+
+// Retorna a quantidade de threads do pool.
+unsigned int tp_threads(thread_pool *);
+
+// Espera as tarefas pendentes e destroi o pool.
+void tp_destroy(thread_pool *);
+
+#endif
@@ -1,26 +1,57 @@
 #include <avltree.h>
 
+#include <limits.h>
 #include <stdlib.h>
 #include <stddef.h>
+#include <string.h>
+
+// Busca antecipada (prefetch) de uma linha de cache, quando disponível.
+#if defined(__GNUC__) || defined(__clang__)
+#define AVL_PREFETCH(addr) __builtin_prefetch(addr)
+#else
+#define AVL_PREFETCH(addr) ((void)(addr))
+#endif
+
+// Quantidade de buscas intercaladas por grupo em `avl_search_many`.
+#define AVL_BATCH_GROUP 16
+
+// Contadores de instrumentação (somente com COLLECTIONS_STATS).
+#ifdef COLLECTIONS_STATS
+#define AVL_STAT(tree, field) ((tree)->stats.field++)
+#define AVL_STAT_ADD(tree, field, n) ((tree)->stats.field += (n))
+#define AVL_STAT_SEARCH(tree, depth)                                           \
+  ((tree)->stats.searches++,                                                   \
+   (tree)->stats.search_depth[(depth) < AVL_STATS_DEPTHS                       \
+                                  ? (depth)                                    \
+                                  : AVL_STATS_DEPTHS - 1]++)
+#else
+#define AVL_STAT(tree, field) ((void)(tree))
+#define AVL_STAT_ADD(tree, field, n) ((void)(tree))
+#define AVL_STAT_SEARCH(tree, depth) ((void)(depth))
+#endif
+
+// Chama a função de comparação da árvore, contando a chamada.
+#define AVL_COMPARE(tree, a, b)                                                \
+  (AVL_STAT(tree, compares), (tree)->function_compare(a, b))
 
 // ======================================== //
 //         Implementações privadas.         //
 // ======================================== //
 
-static avl_node *avl_biggest_node(avl_node *node) {
-  if (node->right != NULL)
-    return avl_biggest_node(node->right);
+static inline avl_node *avl_biggest_node(avl_node *node) {
+  while (node->right != NULL)
+    node = node->right;
   return node;
 }
 
-static avl_node *avl_smallest_node(avl_node *node) {
-  if (node->left != NULL)
-    return avl_smallest_node(node->left);
+static inline avl_node *avl_smallest_node(avl_node *node) {
+  while (node->left != NULL)
+    node = node->left;
   return node;
 }
 
 // Compara dois valores, e retorna o maior
-static int avl_max(int a, int b) { return (a > b) ? a : b; }
+static int avl_max_height(int a, int b) { return (a > b) ? a : b; }
 
 // Retorna a altura do nó.
 int avl_get_height(avl_node *a) {
@@ -30,6 +61,19 @@ int avl_get_height(avl_node *a) {
   return a->height;
 }
 
+// Retorna a quantidade de nós da sub-árvore.
+static unsigned int avl_get_count(avl_node *a) {
+  if (a == NULL)
+    return 0;
+  return a->count;
+}
+
+// Recalcula a altura e o tamanho do nó a partir dos filhos.
+static void avl_update(avl_node *a) {
+  a->height = 1 + avl_max_height(avl_get_height(a->left), avl_get_height(a->right));
+  a->count = 1 + avl_get_count(a->left) + avl_get_count(a->right);
+}
+
 // Retorna o fator de balanço do nó.
 static int avl_get_balance(avl_node *a) {
   if (a == NULL)
@@ -45,181 +89,651 @@ static int avl_get_balance(avl_node *a) {
       c  z                      y   c
 */
 // Faz uma rotação a esquerda (--)
-static avl_node *avl_rotate_left(avl_node *a) {
+static avl_node *avl_rotate_left(avl_tree *tree, avl_node *a) {
+  AVL_STAT(tree, rotations_left);
   avl_node *b = a->right;
   avl_node *c = b->left;
 
   b->left = a;
   a->right = c;
 
-  b->height = 1 + avl_max(avl_get_height(b->left), avl_get_height(b->right));
-  a->height = 1 + avl_max(avl_get_height(a->left), avl_get_height(a->right));
+  if (c != NULL)
+    c->parent = a;
+  b->parent = a->parent;
+  a->parent = b;
+
+  // `a` agora é filho de `b`, então sua altura precisa ser atualizada antes.
+  avl_update(a);
+  avl_update(b);
 
   return b;
 }
 
 // Faz uma rotação a direita (++)
-static avl_node *avl_rotate_right(avl_node *a) {
+static avl_node *avl_rotate_right(avl_tree *tree, avl_node *a) {
+  AVL_STAT(tree, rotations_right);
   avl_node *b = a->left;
   avl_node *c = b->right;
 
   b->right = a;
   a->left = c;
 
-  a->height = 1 + avl_max(avl_get_height(a->left), avl_get_height(a->right));
-  b->height = 1 + avl_max(avl_get_height(b->left), avl_get_height(b->right));
+  if (c != NULL)
+    c->parent = a;
+  b->parent = a->parent;
+  a->parent = b;
+
+  avl_update(a);
+  avl_update(b);
 
   return b;
 }
 
 // Cria um nó para a árvore avl.
 static avl_node *avl_create_node(avl_tree *tree, void *value) {
-  avl_node *node = (avl_node *)malloc(sizeof(avl_node));
-
-  node->value = tree->function_copy(value);
+  avl_node *node;
+  AVL_STAT(tree, node_allocs);
+  if (tree->pool != NULL)
+    node = (avl_node *)pool_alloc(tree->pool);
+  else
+    node = (avl_node *)malloc(tree->node_size);
+
+  if (tree->value_size > 0) {
+    // Os bytes do valor ficam logo após o nó.
+    node->value = (void *)(node + 1);
+    memcpy(node->value, value, tree->value_size);
+  } else {
+    node->value = tree->function_copy(value);
+  }
   node->height = 1;
+  node->count = 1;
   node->left = NULL;
   node->right = NULL;
+  node->parent = NULL;
+  // No modo mapa o valor associado começa zerado (NULL).
+  if (tree->map_value_offset > 0)
+    memset((char *)node + tree->map_value_offset, 0,
+           tree->node_size - tree->map_value_offset);
 
   tree->size++;
 
   return node;
 }
 
-// Destroi o nó criado anteriormente para a árvore.
-static void avl_destroy_node(avl_tree *tree, avl_node *node) {
-  tree->function_destroy(node->value);
-  free(node);
+// Retorna o endereço do valor associado ao nó (modo mapa).
+static void *avl_map_slot(avl_tree *tree, avl_node *node) {
+  return (char *)node + tree->map_value_offset;
 }
 
-// Faz uma inserção recursiva na árvore.
-static avl_node *avl_impl_insert(avl_tree *tree, avl_node *node, void *value) {
-  if (node == NULL)
-    return avl_create_node(
-        tree,
-        value); // Retornamos o nó se achamos uma posição para adicionar o nó.
+// Retorna o valor associado ao nó: o ponteiro guardado ou o endereço dos
+// bytes inline (modo mapa).
+static void *avl_map_value(avl_tree *tree, avl_node *node) {
+  void *slot = avl_map_slot(tree, node);
+  return (tree->map_value_size > 0) ? slot : *(void **)slot;
+}
 
-  int r = tree->function_compare(value, node->value);
+// Substitui o valor associado ao nó por uma cópia de `value`, copiando antes
+// de destruir o valor antigo (que pode ser o próprio `value`).
+static void avl_map_assign(avl_tree *tree, avl_node *node, void *value) {
+  void *slot = avl_map_slot(tree, node);
+  if (tree->map_value_size > 0) {
+    memmove(slot, value, tree->map_value_size);
+    return;
+  }
+
+  void *copy = value;
+  if (tree->function_copy_map != NULL && value != NULL)
+    copy = tree->function_copy_map(value);
+  void *old = *(void **)slot;
+  if (tree->function_destroy_map != NULL && old != NULL)
+    tree->function_destroy_map(old);
+  *(void **)slot = copy;
+}
 
-  if (r > 0)
-    node->right = avl_impl_insert(tree, node->right, value);
-  else if (r < 0)
-    node->left = avl_impl_insert(tree, node->left, value);
+// Destroi o valor do nó (e o valor associado, no modo mapa).
+static void avl_destroy_value(avl_tree *tree, avl_node *node) {
+  if (tree->function_destroy != NULL)
+    tree->function_destroy(node->value);
+  if (tree->function_destroy_map != NULL) {
+    void *value = *(void **)avl_map_slot(tree, node);
+    if (value != NULL)
+      tree->function_destroy_map(value);
+  }
+}
+
+// Destroi o nó criado anteriormente para a árvore.
+static void avl_destroy_node(avl_tree *tree, avl_node *node) {
+  avl_destroy_value(tree, node);
+  AVL_STAT(tree, node_frees);
+  if (tree->pool != NULL)
+    pool_free(tree->pool, node);
   else
-    return NULL;
+    free(node);
+}
+
+// Faz uma pesquisa iterativa na árvore.
+static avl_node *avl_impl_search(avl_tree *tree, void *value) {
+  avl_node *node = tree->root;
+  unsigned int depth = 0; // Nós visitados (histograma das estatísticas).
+  while (node != NULL) {
+    depth++;
+    int r = AVL_COMPARE(tree, value, node->value);
+    if (r > 0)
+      node = node->right;
+    else if (r < 0)
+      node = node->left;
+    else
+      break;
+  }
+  AVL_STAT_SEARCH(tree, depth);
+  return node; // NULL se não encontrado.
+}
 
-  node->height =
-      1 + avl_max(avl_get_height(node->left), avl_get_height(node->right));
+// Destroi até `budget` nós da sub-árvore `root` sem recursão: desce até uma
+// folha, a desconecta do pai e volta para o pai, deixando `root` por último
+// (os nós que restarem continuam ligados a ela). Com `release` 0 só os
+// valores são destruídos (os nós são liberados junto com os chunks do pool).
+// Retorna quantos nós foram destruídos.
+static unsigned int avl_destroy_nodes(avl_tree *tree, avl_node *root,
+                                      unsigned int budget, int release) {
+  unsigned int count = 0;
+  avl_node *node = root;
+  while (node != NULL && count < budget) {
+    if (node->left != NULL) {
+      node = node->left;
+    } else if (node->right != NULL) {
+      node = node->right;
+    } else {
+      avl_node *parent = NULL;
+      if (node != root) {
+        parent = node->parent;
+        if (parent->left == node)
+          parent->left = NULL;
+        else
+          parent->right = NULL;
+      }
+
+      if (release)
+        avl_destroy_node(tree, node);
+      else
+        avl_destroy_value(tree, node);
+      count++;
+      node = parent;
+    }
+  }
+  return count;
+}
+
+// Atualiza a altura do nó e aplica as rotações necessárias.
+static avl_node *avl_rebalance(avl_tree *tree, avl_node *node) {
+  avl_update(node);
   int balance = avl_get_balance(node);
 
-  if (balance > 1 && tree->function_compare(value, node->left->value) < 0)
-    return avl_rotate_right(node);
+  // Caso Esquerda (Simples).
+  if (balance > 1 && avl_get_balance(node->left) >= 0) {
+    AVL_STAT(tree, rebalance[0]);
+    return avl_rotate_right(tree, node);
+  }
+
+  // Caso Esquerda-Direita (Dupla)
+  if (balance > 1 && avl_get_balance(node->left) < 0) {
+    AVL_STAT(tree, rebalance[1]);
+    node->left = avl_rotate_left(tree, node->left);
+    return avl_rotate_right(tree, node);
+  }
+
+  // Caso Direita (Simples).
+  if (balance < -1 && avl_get_balance(node->right) <= 0) {
+    AVL_STAT(tree, rebalance[2]);
+    return avl_rotate_left(tree, node);
+  }
+
+  // Caso Direita-Esquerda (Dupla)
+  if (balance < -1 && avl_get_balance(node->right) > 0) {
+    AVL_STAT(tree, rebalance[3]);
+    node->right = avl_rotate_right(tree, node->right);
+    return avl_rotate_left(tree, node);
+  }
 
-  if (balance < -1 && tree->function_compare(value, node->right->value) > 0)
-    return avl_rotate_left(node);
+  return node;
+}
+
+// Troca o filho `old` de `parent` (ou a raiz, se `parent` for NULL) por `new`.
+static void avl_replace_child(avl_tree *tree, avl_node *parent, avl_node *old,
+                              avl_node *new) {
+  if (parent == NULL)
+    tree->root = new;
+  else if (parent->left == old)
+    parent->left = new;
+  else
+    parent->right = new;
+}
 
-  if (balance > 1 && tree->function_compare(value, node->left->value) > 0) {
-    node->left = avl_rotate_left(node->left);
-    return avl_rotate_right(node);
+// Sobe de `node` até a raiz rebalanceando, após a sub-árvore de `node` ganhar
+// (delta = 1) ou perder (delta = -1) um nó. Para assim que a altura de uma
+// sub-árvore não muda, pois daí para cima nada mais precisa de rotação; com
+// AVL_OPT_ORDER_STAT apenas o tamanho dos ancestrais restantes é ajustado.
+static void avl_retrace(avl_tree *tree, avl_node *node, int delta) {
+  while (node != NULL) {
+    int old_height = node->height;
+    avl_node *parent = node->parent;
+
+    // As rotações não mudam os ponteiros do pai, então `node` ainda identifica
+    // qual filho substituir.
+    avl_node *root = avl_rebalance(tree, node);
+    avl_replace_child(tree, parent, node, root);
+
+    node = parent;
+    if (root->height == old_height)
+      break;
   }
 
-  if (balance < -1 && tree->function_compare(value, node->right->value) < 0) {
-    node->right = avl_rotate_right(node->right);
-    return avl_rotate_left(node);
+  if (tree->options & AVL_OPT_ORDER_STAT) {
+    for (; node != NULL; node = node->parent)
+      node->count += delta;
   }
+}
 
+// Cria o nó de `value` como filho de `parent` (à direita se `r` > 0, senão à
+// esquerda; `parent` é NULL se a árvore estiver vazia) e rebalanceia.
+static avl_node *avl_link_node(avl_tree *tree, avl_node *parent, int r,
+                               void *value) {
+  avl_node *node = avl_create_node(tree, value);
+  node->parent = parent;
+  if (parent == NULL)
+    tree->root = node;
+  else if (r > 0)
+    parent->right = node;
+  else
+    parent->left = node;
+
+  // Um novo extremo só pode ser filho do extremo anterior.
+  tree->append_probe = 0;
+  if (parent == NULL) {
+    tree->leftmost = node;
+    tree->rightmost = node;
+    tree->append_probe = 1;
+  } else if (parent == tree->leftmost && r < 0) {
+    tree->leftmost = node;
+  } else if (parent == tree->rightmost && r > 0) {
+    tree->rightmost = node;
+    tree->append_probe = 1;
+  }
+
+  avl_retrace(tree, parent, 1);
   return node;
 }
 
-// Faz uma remoção recursiva na árvore.
-static avl_node *avl_impl_remove(avl_tree *tree, avl_node *node, void *value) {
-  if (node == NULL)
-    return NULL;
+// Desce a partir de `node` (filho de `parent` do lado `r`) até a posição de
+// `value`, com uma comparação por nível, e o insere ali se ainda não existir.
+// `bound` é um nó já comparado e maior que `value` (ou NULL), que não é
+// comparado de novo. `inserted` recebe 1 se o nó foi criado.
+static avl_node *avl_insert_from(avl_tree *tree, avl_node *parent, int r,
+                                 avl_node *node, avl_node *bound, void *value,
+                                 int *inserted) {
+  while (node != NULL) {
+    parent = node;
+    r = (node == bound) ? -1 : AVL_COMPARE(tree, value, node->value);
+    if (r > 0)
+      node = node->right;
+    else if (r < 0)
+      node = node->left;
+    else {
+      *inserted = 0; // Duplicata, a árvore não muda.
+      return node;
+    }
+  }
 
-  int r = tree->function_compare(value, node->value);
-  if (r > 0)
-    node->right = avl_impl_remove(tree, node->right, value);
-  else if (r < 0)
-    node->left = avl_impl_remove(tree, node->left, value);
-  else {
-    if (node->left != NULL &&
-        node->right != NULL) { // Se o nosso nó tiver os dois filhos.
+  // O lado vem da última comparação da descida.
+  *inserted = 1;
+  return avl_link_node(tree, parent, r, value);
+}
 
-      avl_node *sucessor = avl_smallest_node(node->right); // Sucessor
+// Faz uma inserção iterativa na árvore, com uma comparação por nível. Se o
+// valor já existir retorna o nó existente; senão cria o nó (só então copiando
+// o valor). `inserted` recebe 1 se o nó foi criado.
+static avl_node *avl_impl_insert(avl_tree *tree, void *value, int *inserted) {
+  // Caminho rápido para chaves crescentes: um valor maior que o maior nó vira
+  // seu filho direito, sem descer da raiz. Só é tentado logo depois de uma
+  // inserção que criou um novo maior nó.
+  avl_node *bound = NULL;
+  if (tree->root != NULL && tree->append_probe) {
+    int r = AVL_COMPARE(tree, value, tree->rightmost->value);
+    if (r > 0) {
+      *inserted = 1;
+      return avl_link_node(tree, tree->rightmost, r, value);
+    }
+    if (r == 0) {
+      *inserted = 0;
+      return tree->rightmost;
+    }
+    // `value` < `rightmost`: a descida pela borda direita para nele sem
+    // compará-lo de novo.
+    bound = tree->rightmost;
+    tree->append_probe = 0;
+  }
 
-      void *value_temp = node->value;
+  return avl_insert_from(tree, NULL, 0, tree->root, bound, value, inserted);
+}
 
-      node->value = sucessor->value;
-      sucessor->value = value_temp;
+// Substitui o valor do nó por uma cópia de `value` (que compara igual).
+static void avl_replace_value(avl_tree *tree, avl_node *node, void *value) {
+  if (tree->value_size > 0) {
+    memcpy(node->value, value, tree->value_size);
+  } else {
+    void *copy = tree->function_copy(value);
+    tree->function_destroy(node->value);
+    node->value = copy;
+  }
+}
 
-      node->right = avl_impl_remove(tree, node->right, value_temp);
+// Desconecta o nó da árvore (sem destruí-lo) e a rebalanceia.
+static void avl_detach_node(avl_tree *tree, avl_node *node) {
+  avl_node *start; // Nó mais baixo cuja sub-árvore perdeu um elemento.
+
+  if (node->left != NULL && node->right != NULL) {
+    // O sucessor é movido (o nó inteiro) para o lugar do nó removido, pois
+    // o valor pode estar guardado dentro do próprio nó.
+    avl_node *sucessor = avl_smallest_node(node->right);
+
+    if (sucessor->parent == node) {
+      start = sucessor;
+    } else {
+      start = sucessor->parent;
+      start->left = sucessor->right;
+      if (sucessor->right != NULL)
+        sucessor->right->parent = start;
+      sucessor->right = node->right;
+      sucessor->right->parent = sucessor;
+    }
 
-    } else { // Se o nosso nó tiver um ou nenhum filho.
-      avl_node *tmp = node;
-      avl_node *filho = (node->left != NULL) ? node->left : node->right;
+    sucessor->left = node->left;
+    sucessor->left->parent = sucessor;
+    sucessor->parent = node->parent;
+    avl_replace_child(tree, node->parent, node, sucessor);
+
+    // O sucessor herda a altura e o tamanho, para que a subida possa parar
+    // abaixo dele.
+    sucessor->height = node->height;
+    sucessor->count = node->count;
+  } else { // Se o nosso nó tiver um ou nenhum filho.
+    avl_node *filho = (node->left != NULL) ? node->left : node->right;
+    start = node->parent;
+    if (filho != NULL)
+      filho->parent = node->parent;
+    avl_replace_child(tree, node->parent, node, filho);
+  }
 
-      tree->function_destroy(tmp->value);
-      free(tmp);
-      --tree->size;
+  avl_retrace(tree, start, -1);
+}
 
-      return filho;
+// Remove o nó da árvore e o destroi, atualizando os extremos: o menor nó não
+// tem filho à esquerda, então seu sucessor é o menor da sub-árvore direita ou
+// o pai (e simetricamente para o maior). Se `out` não for NULL, ele recebe o
+// valor do nó, que não é destruído.
+static void avl_remove_node(avl_tree *tree, avl_node *node, void *out) {
+  if (node == tree->leftmost)
+    tree->leftmost = (node->right != NULL) ? avl_smallest_node(node->right)
+                                           : node->parent;
+  if (node == tree->rightmost)
+    tree->rightmost = (node->left != NULL) ? avl_biggest_node(node->left)
+                                           : node->parent;
+
+  avl_detach_node(tree, node);
+  if (out == NULL) {
+    avl_destroy_node(tree, node);
+  } else {
+    if (tree->value_size > 0)
+      memcpy(out, node->value, tree->value_size);
+    else
+      *(void **)out = node->value;
+    if (tree->function_destroy_map != NULL) {
+      void *value = *(void **)avl_map_slot(tree, node);
+      if (value != NULL)
+        tree->function_destroy_map(value);
     }
+    AVL_STAT(tree, node_frees);
+    if (tree->pool != NULL)
+      pool_free(tree->pool, node);
+    else
+      free(node);
   }
+  --tree->size;
+}
 
+// Faz uma remoção iterativa na árvore.
+static int avl_impl_remove(avl_tree *tree, void *value) {
+  avl_node *node = avl_impl_search(tree, value);
   if (node == NULL)
-    return node;
+    return 0;
 
-  node->height =
-      1 + avl_max(avl_get_height(node->left), avl_get_height(node->right));
-  int balance = avl_get_balance(node);
+  avl_remove_node(tree, node, NULL);
+  return 1;
+}
 
-  // Caso Esquerda (Simples).
-  if (balance > 1 && avl_get_balance(node->left) >= 0)
-    return avl_rotate_right(node);
+// Constroi uma sub-árvore balanceada com os elementos [lo, hi) do vetor.
+static avl_node *avl_build_range(avl_tree *tree, const char *base,
+                                 size_t stride, size_t lo, size_t hi) {
+  if (lo >= hi)
+    return NULL;
 
-  // Caso Esquerda-Direita (Dupla)
-  if (balance > 1 && avl_get_balance(node->left) < 0) {
-    node->left = avl_rotate_left(node->left);
-    return avl_rotate_right(node);
+  size_t mid = lo + (hi - lo) / 2;
+  avl_node *node = avl_create_node(tree, (void *)(base + mid * stride));
+  node->left = avl_build_range(tree, base, stride, lo, mid);
+  node->right = avl_build_range(tree, base, stride, mid + 1, hi);
+  if (node->left != NULL)
+    node->left->parent = node;
+  if (node->right != NULL)
+    node->right->parent = node;
+  avl_update(node);
+  return node;
+}
+
+// ---------------------------------------- //
+//   Split e join (operações de conjunto).   //
+// ---------------------------------------- //
+/*
+  As sub-árvores manipuladas aqui ficam soltas (com pai NULL) e são tratadas
+  temporariamente como a raiz da árvore, para que `avl_retrace` possa ser
+  reaproveitada. O `join` custa apenas a diferença entre as alturas.
+*/
+
+// Junta as sub-árvores `l` e `r` usando o nó `k` como elemento do meio: todos
+// de `l` < k < todos de `r`. Desce pela borda da mais alta até um nó com no
+// máximo a altura da outra mais um, pendura `k` ali e rebalanceia subindo,
+// como numa inserção. Retorna a nova raiz.
+static avl_node *avl_join(avl_tree *tree, avl_node *l, avl_node *k,
+                          avl_node *r) {
+  int hl = avl_get_height(l);
+  int hr = avl_get_height(r);
+  avl_node *parent = NULL;
+  avl_node *top = k;
+
+  if (hl > hr + 1) {
+    avl_node *c = l;
+    while (avl_get_height(c) > hr + 1) {
+      parent = c;
+      c = c->right;
+    }
+    parent->right = k;
+    k->left = c;
+    k->right = r;
+    top = l;
+  } else if (hr > hl + 1) { // Código espelhado, pela borda esquerda de `r`.
+    avl_node *c = r;
+    while (avl_get_height(c) > hl + 1) {
+      parent = c;
+      c = c->left;
+    }
+    parent->left = k;
+    k->left = l;
+    k->right = c;
+    top = r;
+  } else {
+    k->left = l;
+    k->right = r;
   }
 
-  // Caso Direita (Simples).
-  if (balance < -1 && avl_get_balance(node->right) <= 0)
-    return avl_rotate_left(node);
+  k->parent = parent;
+  if (k->left != NULL)
+    k->left->parent = k;
+  if (k->right != NULL)
+    k->right->parent = k;
+  avl_update(k);
+
+  top->parent = NULL;
+  tree->root = top;
+  if (parent != NULL) // Os ancestrais de `k` ganharam `k` e a outra árvore.
+    avl_retrace(tree, parent, (int)avl_get_count(top == l ? r : l) + 1);
+  return tree->root;
+}
 
-  if (balance < -1 && avl_get_balance(node->right) > 0) {
-    node->right = avl_rotate_right(node->right);
-    return avl_rotate_left(node);
+// Junta `l` e `r` (todos de `l` < todos de `r`) sem elemento do meio: o maior
+// de `l` é desconectado e usado como tal.
+static avl_node *avl_join2(avl_tree *tree, avl_node *l, avl_node *r) {
+  if (l == NULL)
+    return r;
+  if (r == NULL)
+    return l;
+
+  tree->root = l;
+  avl_node *k = avl_biggest_node(l);
+  avl_detach_node(tree, k);
+  return avl_join(tree, tree->root, k, r);
+}
+
+// Divide a sub-árvore `t` por `value`: `l` recebe os menores e `r` os maiores.
+// Retorna o nó igual a `value`, já solto, ou NULL. Custa O(log n), pois as
+// alturas dos `join` feitos na volta da recursão se cancelam.
+static avl_node *avl_split(avl_tree *tree, avl_node *t, void *value,
+                           avl_node **l, avl_node **r) {
+  if (t == NULL) {
+    *l = *r = NULL;
+    return NULL;
   }
 
-  return node;
+  avl_node *left = t->left;
+  avl_node *right = t->right;
+  if (left != NULL)
+    left->parent = NULL;
+  if (right != NULL)
+    right->parent = NULL;
+
+  int cmp = AVL_COMPARE(tree, value, t->value);
+  if (cmp == 0) {
+    *l = left;
+    *r = right;
+    return t;
+  }
+
+  avl_node *mid;
+  avl_node *found;
+  if (cmp < 0) {
+    found = avl_split(tree, left, value, l, &mid);
+    *r = avl_join(tree, mid, t, right);
+  } else {
+    found = avl_split(tree, right, value, &mid, r);
+    *l = avl_join(tree, left, t, mid);
+  }
+  return found;
 }
 
-// Faz uma pesquisa recursiva na árvore.
-static avl_node *avl_impl_search(avl_tree *tree, avl_node *node, void *value) {
+// Copia para `tree` a sub-árvore `node` de outra árvore, mantendo o formato.
+static avl_node *avl_copy_subtree(avl_tree *tree, avl_node *node,
+                                  avl_node *parent) {
   if (node == NULL)
-    return NULL; // Não encontrado.
+    return NULL;
 
-  int r = tree->function_compare(value, node->value);
+  avl_node *copy = avl_create_node(tree, node->value);
+  if (tree->map_value_offset > 0)
+    avl_map_assign(tree, copy, avl_map_value(tree, node));
+  copy->parent = parent;
+  copy->left = avl_copy_subtree(tree, node->left, copy);
+  copy->right = avl_copy_subtree(tree, node->right, copy);
+  avl_update(copy);
+  return copy;
+}
 
-  if (r > 0)
-    return avl_impl_search(tree, node->right, value);
-  else if (r < 0)
-    return avl_impl_search(tree, node->left, value);
-  else
-    return node;
+// Destroi os nós da sub-árvore (um a um, devolvendo-os ao pool se existir).
+// Retorna quantos nós foram destruídos.
+static unsigned int avl_destroy_subtree(avl_tree *tree, avl_node *node) {
+  return avl_destroy_nodes(tree, node, UINT_MAX, 1);
 }
 
-// Função recursiva para a deleção dos nós.
-static void avl_impl_clear(avl_tree *tree, avl_node *node) {
-  if (node == NULL)
-    return;
+// União da sub-árvore `t` com a sub-árvore `s` de outra árvore.
+static avl_node *avl_union_rec(avl_tree *tree, avl_node *t, avl_node *s) {
+  if (s == NULL)
+    return t;
+  if (t == NULL)
+    return avl_copy_subtree(tree, s, NULL);
+
+  avl_node *l, *r;
+  avl_node *k = avl_split(tree, t, s->value, &l, &r);
+  l = avl_union_rec(tree, l, s->left);
+  r = avl_union_rec(tree, r, s->right);
+
+  // O nó de `tree` é reaproveitado; senão o elemento de `s` é copiado.
+  if (k == NULL) {
+    k = avl_create_node(tree, s->value);
+    if (tree->map_value_offset > 0)
+      avl_map_assign(tree, k, avl_map_value(tree, s));
+  }
+  return avl_join(tree, l, k, r);
+}
+
+// Interseção da sub-árvore `t` com a sub-árvore `s` de outra árvore.
+static avl_node *avl_intersection_rec(avl_tree *tree, avl_node *t,
+                                      avl_node *s) {
+  if (t == NULL || s == NULL) {
+    tree->size -= avl_destroy_subtree(tree, t);
+    return NULL;
+  }
+
+  avl_node *l, *r;
+  avl_node *k = avl_split(tree, t, s->value, &l, &r);
+  l = avl_intersection_rec(tree, l, s->left);
+  r = avl_intersection_rec(tree, r, s->right);
+
+  if (k != NULL)
+    return avl_join(tree, l, k, r);
+  return avl_join2(tree, l, r);
+}
+
+// Diferença da sub-árvore `t` com a sub-árvore `s` de outra árvore.
+static avl_node *avl_difference_rec(avl_tree *tree, avl_node *t,
+                                    avl_node *s) {
+  if (t == NULL || s == NULL)
+    return t;
+
+  avl_node *l, *r;
+  avl_node *k = avl_split(tree, t, s->value, &l, &r);
+  l = avl_difference_rec(tree, l, s->left);
+  r = avl_difference_rec(tree, r, s->right);
 
-  avl_impl_clear(tree, node->left);
-  avl_impl_clear(tree, node->right);
+  if (k != NULL) {
+    avl_destroy_node(tree, k);
+    --tree->size;
+  }
+  return avl_join2(tree, l, r);
+}
+
+// Recalcula os extremos após uma mudança na raiz (construção e operações de
+// conjunto), em O(log n).
+static void avl_update_extremes(avl_tree *tree) {
+  tree->leftmost = NULL;
+  tree->rightmost = NULL;
+  if (tree->root != NULL) {
+    tree->leftmost = avl_smallest_node(tree->root);
+    tree->rightmost = avl_biggest_node(tree->root);
+  }
+}
 
-  avl_destroy_node(tree, node);
-  
+// Define a raiz após uma operação de conjunto.
+static void avl_set_root(avl_tree *tree, avl_node *root) {
+  if (root != NULL)
+    root->parent = NULL;
+  tree->root = root;
+  avl_update_extremes(tree);
 }
 
 // ======================================== //
@@ -229,30 +743,169 @@ static void avl_impl_clear(avl_tree *tree, avl_node *node) {
 avl_tree *avl_create_tree(avl_function_compare fcompare,
                           avl_function_copy fcopy,
                           avl_function_destroy fdestroy) {
+  return avl_create_tree_ex(fcompare, fcopy, fdestroy, 0);
+}
+
+avl_tree *avl_create_tree_ex(avl_function_compare fcompare,
+                             avl_function_copy fcopy,
+                             avl_function_destroy fdestroy,
+                             unsigned int options) {
   avl_tree *tree = (avl_tree *)malloc(sizeof(avl_tree));
 
   tree->function_compare = fcompare;
   tree->function_copy = fcopy;
   tree->function_destroy = fdestroy;
   tree->root = NULL;
+  tree->leftmost = NULL;
+  tree->rightmost = NULL;
+  tree->append_probe = 1;
   tree->size = 0;
+  tree->options = options;
+  tree->value_size = 0;
+  tree->node_size = sizeof(avl_node);
+
+  tree->map_value_offset = 0;
+  tree->map_value_size = 0;
+  tree->function_copy_map = NULL;
+  tree->function_destroy_map = NULL;
+
+  tree->pool = NULL;
+  if (options & AVL_OPT_POOL)
+    tree->pool = pool_create(tree->node_size);
+
+#ifdef COLLECTIONS_STATS
+  memset(&tree->stats, 0, sizeof(tree->stats));
+#endif
 
   return tree;
 }
 
+avl_tree *avl_create_tree_inline(avl_function_compare fcompare,
+                                 size_t value_size, unsigned int options) {
+  avl_tree *tree = avl_create_tree_ex(fcompare, NULL, NULL,
+                                      options & ~AVL_OPT_POOL);
+  tree->options = options;
+  tree->value_size = value_size;
+  tree->node_size = sizeof(avl_node) + value_size;
+
+  if (options & AVL_OPT_POOL)
+    tree->pool = pool_create(tree->node_size);
+
+  return tree;
+}
+
+// Inicializa um mapa: o valor associado fica após a chave, alinhado a 8
+// bytes (`map_value_size` bytes, ou um ponteiro).
+static avl_tree *avl_init_map(avl_function_compare fcompare,
+                              avl_function_copy fcopy,
+                              avl_function_destroy fdestroy, size_t key_size,
+                              avl_function_copy fcopy_value,
+                              avl_function_destroy fdestroy_value,
+                              size_t value_size, unsigned int options) {
+  avl_tree *tree;
+  if (key_size > 0)
+    tree = avl_create_tree_inline(fcompare, key_size, options & ~AVL_OPT_POOL);
+  else
+    tree = avl_create_tree_ex(fcompare, fcopy, fdestroy,
+                              options & ~AVL_OPT_POOL);
+  tree->options = options;
+  tree->map_value_offset = (tree->node_size + 7) & ~(size_t)7;
+  tree->map_value_size = value_size;
+  tree->function_copy_map = fcopy_value;
+  tree->function_destroy_map = fdestroy_value;
+  tree->node_size =
+      tree->map_value_offset + (value_size > 0 ? value_size : sizeof(void *));
+
+  if (options & AVL_OPT_POOL)
+    tree->pool = pool_create(tree->node_size);
+
+  return tree;
+}
+
+avl_tree *avl_create_map(avl_function_compare fcompare,
+                         avl_function_copy fcopy,
+                         avl_function_destroy fdestroy,
+                         avl_function_copy fcopy_value,
+                         avl_function_destroy fdestroy_value,
+                         unsigned int options) {
+  return avl_init_map(fcompare, fcopy, fdestroy, 0, fcopy_value,
+                      fdestroy_value, 0, options);
+}
+
+avl_tree *avl_create_map_inline(avl_function_compare fcompare,
+                                size_t key_size, size_t value_size,
+                                unsigned int options) {
+  return avl_init_map(fcompare, NULL, NULL, key_size, NULL, NULL, value_size,
+                      options);
+}
+
 void avl_clear(avl_tree *tree) {
   if (tree != NULL) {
-    avl_impl_clear(tree, tree->root);
+    // Com pool e sem função de destruir não é preciso visitar os nós.
+    if (tree->pool == NULL || tree->function_destroy != NULL ||
+        tree->function_destroy_map != NULL)
+      avl_destroy_nodes(tree, tree->root, UINT_MAX, tree->pool == NULL);
+    if (tree->pool != NULL)
+      AVL_STAT_ADD(tree, node_frees, tree->size);
+    pool_clear(tree->pool); // Libera todos os chunks de uma vez.
     tree->root = NULL;
+    tree->leftmost = NULL;
+    tree->rightmost = NULL;
     tree->size = 0;
   }
 }
 
+avl_tree *avl_detach(avl_tree *tree) {
+  if (tree == NULL)
+    return NULL;
+
+  // A cópia da estrutura fica com a raiz e o pool; `tree` recebe um pool
+  // novo.
+  avl_tree *detached = (avl_tree *)malloc(sizeof(avl_tree));
+  *detached = *tree;
+  tree->root = NULL;
+  tree->leftmost = NULL;
+  tree->rightmost = NULL;
+  tree->size = 0;
+  if (tree->pool != NULL)
+    tree->pool = pool_create(tree->node_size);
+  return detached;
+}
+
+unsigned int avl_clear_step(avl_tree *tree, unsigned int budget) {
+  if (tree == NULL || tree->root == NULL)
+    return 0;
+
+  // Os extremos deixam de valer no primeiro passo.
+  tree->leftmost = NULL;
+  tree->rightmost = NULL;
+
+  // Com pool e sem função de destruir basta liberar os chunks.
+  if (tree->pool != NULL && tree->function_destroy == NULL &&
+      tree->function_destroy_map == NULL) {
+    avl_clear(tree);
+    return 0;
+  }
+
+  unsigned int count =
+      avl_destroy_nodes(tree, tree->root, budget, tree->pool == NULL);
+  tree->size -= count;
+  if (tree->pool != NULL)
+    AVL_STAT_ADD(tree, node_frees, count);
+
+  if (tree->size == 0) {
+    tree->root = NULL;
+    pool_clear(tree->pool);
+  }
+  return tree->size;
+}
+
 void avl_destroy_tree(avl_tree *tree) {
   if (tree == NULL)
     return;
 
   avl_clear(tree);
+  pool_destroy(tree->pool);
   free(tree);
 }
 
@@ -260,39 +913,518 @@ int avl_insert(avl_tree *tree, void *value) {
   if (tree == NULL)
     return 0;
 
-  unsigned int old_size = tree->size;
-  tree->root = avl_impl_insert(tree, tree->root, value);
+  int inserted;
+  avl_impl_insert(tree, value, &inserted);
+  return inserted; // 0 se for duplicata.
+}
 
-  if (tree->size > old_size)
-    return 1; // Sucesso na inserção.
+void *avl_find_or_insert(avl_tree *tree, void *value, int *inserted) {
+  if (tree == NULL)
+    return NULL;
 
-  return 0; // Duplicata encontrada.
+  int created;
+  avl_node *node = avl_impl_insert(tree, value, &created);
+  if (inserted != NULL)
+    *inserted = created;
+  return node->value;
+}
+
+avl_node *avl_insert_hint(avl_tree *tree, avl_node *hint, void *value,
+                          int *inserted) {
+  if (tree == NULL)
+    return NULL;
+
+  int created;
+  if (inserted == NULL)
+    inserted = &created;
+  if (hint == NULL)
+    return avl_impl_insert(tree, value, inserted);
+
+  int r = AVL_COMPARE(tree, value, hint->value);
+  if (r == 0) {
+    *inserted = 0; // Duplicata.
+    return hint;
+  }
+
+  // Sobe a partir da dica comparando só os ancestrais que limitam a chave do
+  // seu lado, como em `rb_insert_hint`: O(log d) comparações para uma chave a
+  // d posições da dica.
+  avl_node *node = hint;
+  int first = 1; // Nenhum limite ultrapassado: a chave é vizinha da dica.
+  while (node->parent != NULL) {
+    avl_node *parent = node->parent;
+    if (node == ((r > 0) ? parent->left : parent->right)) {
+      int cmp = AVL_COMPARE(tree, value, parent->value);
+      if (cmp == 0) {
+        *inserted = 0;
+        return parent;
+      }
+      if ((cmp < 0) == (r > 0)) {
+        if (first)
+          return avl_insert_from(tree, hint, r,
+                                 (r > 0) ? hint->right : hint->left, NULL,
+                                 value, inserted);
+        return avl_insert_from(tree, parent, -r, node, NULL, value, inserted);
+      }
+      first = 0;
+    }
+    node = parent;
+  }
+
+  // A chave passa de todos os limites da subida: inserção normal.
+  return avl_impl_insert(tree, value, inserted);
+}
+
+int avl_upsert(avl_tree *tree, void *value) {
+  if (tree == NULL)
+    return 0;
+
+  int inserted;
+  avl_node *node = avl_impl_insert(tree, value, &inserted);
+  if (!inserted)
+    avl_replace_value(tree, node, value);
+  return inserted;
 }
 
 int avl_remove(avl_tree *tree, void *value) {
   if (tree == NULL || tree->root == NULL)
     return 0;
 
-  unsigned int old_size = tree->size;
-  tree->root = avl_impl_remove(tree, tree->root, value);
-  if (tree->size > old_size)
-    return 1; // Sucesso na remoção.
-  
-  return 0; // Elemento não encontrado na árvore.
+  return avl_impl_remove(tree, value); // 0 se não encontrado.
+}
+
+void *avl_min(avl_tree *tree) {
+  if (tree == NULL || tree->root == NULL)
+    return NULL;
+  return tree->leftmost->value;
+}
+
+void *avl_max(avl_tree *tree) {
+  if (tree == NULL || tree->root == NULL)
+    return NULL;
+  return tree->rightmost->value;
+}
+
+int avl_pop_min(avl_tree *tree, void *out) {
+  if (tree == NULL || tree->root == NULL)
+    return 0;
+  avl_remove_node(tree, tree->leftmost, out);
+  return 1;
+}
+
+int avl_pop_max(avl_tree *tree, void *out) {
+  if (tree == NULL || tree->root == NULL)
+    return 0;
+  avl_remove_node(tree, tree->rightmost, out);
+  return 1;
+}
+
+int avl_map_put(avl_tree *tree, void *key, void *value) {
+  if (tree == NULL || tree->map_value_offset == 0)
+    return 0;
+
+  int inserted;
+  avl_node *node = avl_impl_insert(tree, key, &inserted);
+  avl_map_assign(tree, node, value);
+  return inserted;
+}
+
+void *avl_map_get(avl_tree *tree, void *key) {
+  if (tree == NULL || tree->map_value_offset == 0)
+    return NULL;
+
+  avl_node *node = avl_impl_search(tree, key);
+  return (node != NULL) ? avl_map_value(tree, node) : NULL;
+}
+
+void *avl_map_get_ptr(avl_tree *tree, void *key) {
+  if (tree == NULL || tree->map_value_offset == 0)
+    return NULL;
+
+  avl_node *node = avl_impl_search(tree, key);
+  return (node != NULL) ? avl_map_slot(tree, node) : NULL;
+}
+
+void *avl_map_value_ptr(avl_tree *tree, avl_node *node) {
+  if (tree == NULL || tree->map_value_offset == 0 || node == NULL)
+    return NULL;
+  return avl_map_slot(tree, node);
+}
+
+int avl_build_sorted(avl_tree *tree, const void *values, size_t count,
+                     size_t stride) {
+  if (tree == NULL || tree->root != NULL)
+    return 0;
+
+  // `avl_create_node` já incrementa o tamanho da árvore.
+  tree->root = avl_build_range(tree, (const char *)values, stride, 0, count);
+  avl_update_extremes(tree);
+  return 1;
+}
+
+int avl_append_sorted(avl_tree *tree, const void *values, size_t count,
+                      size_t stride) {
+  if (tree == NULL)
+    return 0;
+  if (tree->root == NULL)
+    return avl_build_sorted(tree, values, count, stride);
+  if (count == 0)
+    return 1;
+
+  const char *base = (const char *)values;
+  avl_node *max = tree->rightmost;
+  if (AVL_COMPARE(tree, (void *)base, max->value) <= 0)
+    return 0; // Os novos elementos precisam vir depois do maior.
+
+  // O primeiro elemento é o nó do meio do `join`, e os demais formam uma
+  // sub-árvore montada como em `avl_build_sorted`.
+  avl_node *k = avl_create_node(tree, (void *)base);
+  avl_node *rest = avl_build_range(tree, base, stride, 1, count);
+  avl_set_root(tree, avl_join(tree, tree->root, k, rest));
+  return 1;
+}
+
+unsigned int avl_union(avl_tree *dst, avl_tree *src) {
+  if (dst == NULL || src == NULL || dst == src)
+    return 0;
+  // Os valores associados só podem ser copiados entre mapas com o mesmo
+  // formato de nó.
+  if (dst->map_value_offset != src->map_value_offset ||
+      dst->map_value_size != src->map_value_size)
+    return 0;
+
+  unsigned int old_size = dst->size;
+  avl_set_root(dst, avl_union_rec(dst, dst->root, src->root));
+  return dst->size - old_size;
+}
+
+unsigned int avl_intersection(avl_tree *dst, avl_tree *src) {
+  if (dst == NULL || src == NULL || dst == src)
+    return 0;
+
+  unsigned int old_size = dst->size;
+  avl_set_root(dst, avl_intersection_rec(dst, dst->root, src->root));
+  return old_size - dst->size;
+}
+
+unsigned int avl_difference(avl_tree *dst, avl_tree *src) {
+  if (dst == NULL || src == NULL)
+    return 0;
+
+  unsigned int old_size = dst->size;
+  if (dst == src) {
+    avl_clear(dst);
+    return old_size;
+  }
+
+  avl_set_root(dst, avl_difference_rec(dst, dst->root, src->root));
+  return old_size - dst->size;
+}
+
+unsigned int avl_erase_range(avl_tree *tree, void *lo, void *hi) {
+  if (tree == NULL || tree->root == NULL)
+    return 0;
+  if (lo != NULL && hi != NULL && AVL_COMPARE(tree, lo, hi) >= 0)
+    return 0; // Intervalo vazio.
+
+  // Separa a árvore em [menores que lo] [lo, hi) [maiores ou iguais a hi].
+  avl_node *a = NULL, *b = tree->root, *c = NULL;
+  unsigned int removed = 0;
+
+  if (lo != NULL) {
+    avl_node *found = avl_split(tree, b, lo, &a, &b);
+    if (found != NULL) {
+      avl_destroy_node(tree, found);
+      removed++;
+    }
+  }
+  if (hi != NULL) {
+    avl_node *mid;
+    avl_node *found = avl_split(tree, b, hi, &mid, &c);
+    if (found != NULL) // `hi` fica fora do intervalo.
+      c = avl_join(tree, NULL, found, c);
+    b = mid;
+  }
+
+  removed += avl_destroy_subtree(tree, b);
+  tree->size -= removed;
+
+  avl_set_root(tree, avl_join2(tree, a, c));
+  return removed;
 }
 
 void *avl_search(avl_tree *tree, void *value) {
   if (tree == NULL)
     return NULL;
 
-  avl_node *node = avl_impl_search(tree, tree->root, value);
+  avl_node *node = avl_impl_search(tree, value);
   if (node != NULL)
     return node->value;
   return NULL;
 }
 
+// Busca um lote em grupos de AVL_BATCH_GROUP buscas, avançando todas um nível
+// por vez. O próximo nó de cada busca é carregado antecipadamente, então as
+// faltas de cache das buscas do grupo acontecem em paralelo.
+static void avl_search_interleaved(avl_tree *tree, void **keys, void **results,
+                                   size_t count) {
+  avl_node *current[AVL_BATCH_GROUP];
+
+  for (size_t base = 0; base < count; base += AVL_BATCH_GROUP) {
+    size_t n = count - base;
+    if (n > AVL_BATCH_GROUP)
+      n = AVL_BATCH_GROUP;
+
+    size_t active = 0;
+    for (size_t j = 0; j < n; j++) {
+      current[j] = tree->root;
+      results[base + j] = NULL;
+      if (current[j] != NULL)
+        active++;
+    }
+
+    while (active > 0) {
+      for (size_t j = 0; j < n; j++) {
+        avl_node *node = current[j];
+        if (node == NULL)
+          continue; // Busca já terminada.
+
+        int r = AVL_COMPARE(tree, keys[base + j], node->value);
+        if (r == 0) {
+          results[base + j] = node->value;
+          node = NULL;
+        } else {
+          node = (r < 0) ? node->left : node->right;
+          AVL_PREFETCH(node);
+        }
+
+        current[j] = node;
+        if (node == NULL)
+          active--;
+      }
+    }
+  }
+}
+
+// Busca um lote ordenado: cada busca parte do nó onde a anterior terminou,
+// subindo só até o ancestral cuja sub-árvore pode conter a nova chave.
+static void avl_search_sorted(avl_tree *tree, void **keys, void **results,
+                              size_t count) {
+  avl_node *finger = tree->root;
+
+  for (size_t i = 0; i < count; i++) {
+    void *key = keys[i];
+    avl_node *node = finger;
+    results[i] = NULL;
+
+    // Sobe enquanto a chave passar do limite superior da sub-árvore. Esse
+    // limite só muda quando subimos a partir de um filho esquerdo.
+    while (node != NULL && node->parent != NULL) {
+      avl_node *parent = node->parent;
+      if (node == parent->left) {
+        int r = AVL_COMPARE(tree, key, parent->value);
+        if (r < 0)
+          break;
+        if (r == 0) {
+          node = parent;
+          break;
+        }
+      }
+      node = parent;
+    }
+
+    // Desce normalmente a partir do ancestral encontrado.
+    while (node != NULL) {
+      finger = node;
+      int r = AVL_COMPARE(tree, key, node->value);
+      if (r == 0) {
+        results[i] = node->value;
+        break;
+      }
+      node = (r < 0) ? node->left : node->right;
+    }
+  }
+}
+
+void avl_search_many(avl_tree *tree, void **keys, void **results, size_t count,
+                     int sorted) {
+  if (tree == NULL || count == 0)
+    return;
+
+  if (sorted)
+    avl_search_sorted(tree, keys, results, count);
+  else
+    avl_search_interleaved(tree, keys, results, count);
+}
+
+avl_node *avl_first(avl_tree *tree) {
+  if (tree == NULL || tree->root == NULL)
+    return NULL;
+  return tree->leftmost;
+}
+
+avl_node *avl_last(avl_tree *tree) {
+  if (tree == NULL || tree->root == NULL)
+    return NULL;
+  return tree->rightmost;
+}
+
+avl_node *avl_next(avl_node *node) {
+  if (node == NULL)
+    return NULL;
+
+  // Sucessor: menor nó da sub-árvore direita, ou o primeiro ancestral do qual
+  // viemos pela esquerda.
+  if (node->right != NULL)
+    return avl_smallest_node(node->right);
+
+  avl_node *parent = node->parent;
+  while (parent != NULL && node == parent->right) {
+    node = parent;
+    parent = parent->parent;
+  }
+  return parent;
+}
+
+avl_node *avl_prev(avl_node *node) {
+  if (node == NULL)
+    return NULL;
+
+  if (node->left != NULL)
+    return avl_biggest_node(node->left);
+
+  avl_node *parent = node->parent;
+  while (parent != NULL && node == parent->left) {
+    node = parent;
+    parent = parent->parent;
+  }
+  return parent;
+}
+
+avl_node *avl_lower_bound(avl_tree *tree, void *value) {
+  if (tree == NULL)
+    return NULL;
+
+  avl_node *node = tree->root;
+  avl_node *result = NULL;
+  while (node != NULL) {
+    if (AVL_COMPARE(tree, node->value, value) >= 0) {
+      result = node; // Candidato, procura um menor à esquerda.
+      node = node->left;
+    } else {
+      node = node->right;
+    }
+  }
+  return result;
+}
+
+avl_node *avl_upper_bound(avl_tree *tree, void *value) {
+  if (tree == NULL)
+    return NULL;
+
+  avl_node *node = tree->root;
+  avl_node *result = NULL;
+  while (node != NULL) {
+    if (AVL_COMPARE(tree, node->value, value) > 0) {
+      result = node;
+      node = node->left;
+    } else {
+      node = node->right;
+    }
+  }
+  return result;
+}
+
+unsigned int avl_range(avl_tree *tree, void *lo, void *hi,
+                       avl_function_visit visit, void *ctx) {
+  if (tree == NULL)
+    return 0;
+
+  unsigned int count = 0;
+  avl_node *node = (lo != NULL) ? avl_lower_bound(tree, lo) : avl_first(tree);
+  while (node != NULL) {
+    if (hi != NULL && AVL_COMPARE(tree, node->value, hi) >= 0)
+      break;
+    count++;
+    if (visit(node->value, ctx) == 0)
+      break; // O visitante pediu para parar.
+    node = avl_next(node);
+  }
+  return count;
+}
+
+avl_node *avl_select(avl_tree *tree, unsigned int index) {
+  if (tree == NULL || !(tree->options & AVL_OPT_ORDER_STAT) ||
+      index >= tree->size)
+    return NULL;
+
+  avl_node *node = tree->root;
+  while (node != NULL) {
+    unsigned int left = avl_get_count(node->left);
+    if (index < left) {
+      node = node->left;
+    } else if (index > left) {
+      index -= left + 1; // Pula a sub-árvore esquerda e o próprio nó.
+      node = node->right;
+    } else {
+      return node;
+    }
+  }
+  return NULL;
+}
+
+unsigned int avl_rank(avl_tree *tree, void *value) {
+  if (tree == NULL || !(tree->options & AVL_OPT_ORDER_STAT))
+    return 0;
+
+  unsigned int rank = 0;
+  avl_node *node = tree->root;
+  while (node != NULL) {
+    if (AVL_COMPARE(tree, value, node->value) <= 0) {
+      node = node->left;
+    } else {
+      rank += avl_get_count(node->left) + 1; // A esquerda e o nó são menores.
+      node = node->right;
+    }
+  }
+  return rank;
+}
+
+unsigned int avl_count_range(avl_tree *tree, void *lo, void *hi) {
+  if (tree == NULL || !(tree->options & AVL_OPT_ORDER_STAT))
+    return 0;
+
+  unsigned int end = (hi != NULL) ? avl_rank(tree, hi) : tree->size;
+  unsigned int begin = (lo != NULL) ? avl_rank(tree, lo) : 0;
+  return (end > begin) ? end - begin : 0;
+}
+
 unsigned int avl_size(avl_tree *tree) {
   if (tree != NULL)
     return tree->size;
   return 0;
 }
+
+int avl_stats(avl_tree *tree, avl_tree_stats *stats) {
+  if (stats == NULL)
+    return 0;
+#ifdef COLLECTIONS_STATS
+  if (tree != NULL) {
+    *stats = tree->stats;
+    return 1;
+  }
+#else
+  (void)tree;
+#endif
+  memset(stats, 0, sizeof(avl_tree_stats));
+  return 0;
+}
+
+void avl_stats_reset(avl_tree *tree) {
+#ifdef COLLECTIONS_STATS
+  if (tree != NULL)
+    memset(&tree->stats, 0, sizeof(tree->stats));
+#else
+  (void)tree;
+#endif
+}
@@ -0,0 +1,410 @@
+#include <btree.h>
+
+#include <stdlib.h>
+#include <string.h>
+
+// ======================================== //
+//         Implementações privadas.         //
+// ======================================== //
+
+// Endereço do elemento `i` dentro do nó.
+static char *bt_slot(bt_tree *tree, bt_node *node, unsigned int i) {
+  return node->keys + (size_t)i * tree->slot_size;
+}
+
+// Valor de um elemento (o ponteiro que as funções do programador recebem).
+static void *bt_value(bt_tree *tree, char *slot) {
+  if (tree->value_size > 0)
+    return slot; // Os bytes do valor estão no próprio nó.
+  return *(void **)slot;
+}
+
+// Vetor de filhos de um nó interno.
+static bt_node **bt_children(bt_tree *tree, bt_node *node) {
+  return (bt_node **)((char *)node + tree->children_offset);
+}
+
+// Cria um nó vazio. As folhas não possuem o vetor de filhos.
+static bt_node *bt_create_node(bt_tree *tree, int leaf) {
+  size_t bytes = tree->children_offset;
+  if (!leaf)
+    bytes += (BT_MAX_KEYS + 1) * sizeof(bt_node *);
+
+  bt_node *node = (bt_node *)malloc(bytes);
+  node->count = 0;
+  node->leaf = leaf;
+  return node;
+}
+
+// Move `n` elementos de `src[si]` para `dst[di]` (as regiões podem se
+// sobrepor).
+static void bt_move_keys(bt_tree *tree, bt_node *dst, unsigned int di,
+                         bt_node *src, unsigned int si, unsigned int n) {
+  memmove(bt_slot(tree, dst, di), bt_slot(tree, src, si),
+          (size_t)n * tree->slot_size);
+}
+
+// Move `n` filhos de `src[si]` para `dst[di]`.
+static void bt_move_children(bt_tree *tree, bt_node *dst, unsigned int di,
+                             bt_node *src, unsigned int si, unsigned int n) {
+  memmove(bt_children(tree, dst) + di, bt_children(tree, src) + si,
+          (size_t)n * sizeof(bt_node *));
+}
+
+// Guarda uma cópia do valor no elemento.
+static void bt_store(bt_tree *tree, char *slot, void *value) {
+  if (tree->value_size > 0)
+    memcpy(slot, value, tree->value_size);
+  else
+    *(void **)slot = tree->function_copy(value);
+}
+
+// Destroi a cópia guardada no elemento.
+static void bt_destroy_slot(bt_tree *tree, char *slot) {
+  if (tree->function_destroy != NULL)
+    tree->function_destroy(*(void **)slot);
+}
+
+// Busca binária no nó: retorna o primeiro índice com elemento >= `value`.
+// `found` recebe 1 se o elemento do índice for igual a `value`.
+static unsigned int bt_find_index(bt_tree *tree, bt_node *node, void *value,
+                                  int *found) {
+  unsigned int lo = 0, hi = node->count;
+  while (lo < hi) {
+    unsigned int mid = lo + (hi - lo) / 2;
+    int cmp =
+        tree->function_compare(value, bt_value(tree, bt_slot(tree, node, mid)));
+    if (cmp > 0) {
+      lo = mid + 1;
+    } else if (cmp < 0) {
+      hi = mid;
+    } else {
+      *found = 1;
+      return mid;
+    }
+  }
+  *found = 0;
+  return lo;
+}
+
+// Divide o filho `i` (cheio) de `node` em dois, subindo o elemento do meio.
+static void bt_split_child(bt_tree *tree, bt_node *node, unsigned int i) {
+  bt_node *y = bt_children(tree, node)[i];
+  bt_node *z = bt_create_node(tree, y->leaf);
+
+  // z recebe a metade superior de y.
+  z->count = BT_MIN_DEGREE - 1;
+  bt_move_keys(tree, z, 0, y, BT_MIN_DEGREE, BT_MIN_DEGREE - 1);
+  if (!y->leaf)
+    bt_move_children(tree, z, 0, y, BT_MIN_DEGREE, BT_MIN_DEGREE);
+  y->count = BT_MIN_DEGREE - 1;
+
+  // Abre espaço em `node` para z e para o elemento do meio de y.
+  bt_move_children(tree, node, i + 2, node, i + 1, node->count - i);
+  bt_children(tree, node)[i + 1] = z;
+  bt_move_keys(tree, node, i + 1, node, i, node->count - i);
+  bt_move_keys(tree, node, i, y, BT_MIN_DEGREE - 1, 1);
+  node->count++;
+}
+
+// Passa um elemento do irmão esquerdo (via pai) para o filho `i`.
+static void bt_borrow_from_left(bt_tree *tree, bt_node *node, unsigned int i) {
+  bt_node *child = bt_children(tree, node)[i];
+  bt_node *sibling = bt_children(tree, node)[i - 1];
+
+  bt_move_keys(tree, child, 1, child, 0, child->count);
+  bt_move_keys(tree, child, 0, node, i - 1, 1);
+  if (!child->leaf) {
+    bt_move_children(tree, child, 1, child, 0, child->count + 1);
+    bt_children(tree, child)[0] = bt_children(tree, sibling)[sibling->count];
+  }
+
+  bt_move_keys(tree, node, i - 1, sibling, sibling->count - 1, 1);
+  sibling->count--;
+  child->count++;
+}
+
+// Passa um elemento do irmão direito (via pai) para o filho `i`.
+static void bt_borrow_from_right(bt_tree *tree, bt_node *node, unsigned int i) {
+  bt_node *child = bt_children(tree, node)[i];
+  bt_node *sibling = bt_children(tree, node)[i + 1];
+
+  bt_move_keys(tree, child, child->count, node, i, 1);
+  if (!child->leaf)
+    bt_children(tree, child)[child->count + 1] = bt_children(tree, sibling)[0];
+
+  bt_move_keys(tree, node, i, sibling, 0, 1);
+  bt_move_keys(tree, sibling, 0, sibling, 1, sibling->count - 1);
+  if (!sibling->leaf)
+    bt_move_children(tree, sibling, 0, sibling, 1, sibling->count);
+
+  sibling->count--;
+  child->count++;
+}
+
+// Junta o filho `i + 1` e o elemento `i` do pai ao filho `i`.
+static void bt_merge(bt_tree *tree, bt_node *node, unsigned int i) {
+  bt_node *child = bt_children(tree, node)[i];
+  bt_node *sibling = bt_children(tree, node)[i + 1];
+
+  bt_move_keys(tree, child, child->count, node, i, 1);
+  bt_move_keys(tree, child, child->count + 1, sibling, 0, sibling->count);
+  if (!child->leaf)
+    bt_move_children(tree, child, child->count + 1, sibling, 0,
+                     sibling->count + 1);
+  child->count += sibling->count + 1;
+
+  // Remove o elemento `i` e o filho `i + 1` do pai.
+  bt_move_keys(tree, node, i, node, i + 1, node->count - i - 1);
+  bt_move_children(tree, node, i + 1, node, i + 2, node->count - i - 1);
+  node->count--;
+
+  free(sibling);
+}
+
+// Garante que o filho `i` tenha pelo menos BT_MIN_DEGREE elementos antes de
+// descer nele. Retorna o índice do filho onde a descida deve continuar.
+static unsigned int bt_fill(bt_tree *tree, bt_node *node, unsigned int i) {
+  bt_node **children = bt_children(tree, node);
+  if (children[i]->count >= BT_MIN_DEGREE)
+    return i;
+
+  if (i > 0 && children[i - 1]->count >= BT_MIN_DEGREE) {
+    bt_borrow_from_left(tree, node, i);
+    return i;
+  }
+  if (i < node->count && children[i + 1]->count >= BT_MIN_DEGREE) {
+    bt_borrow_from_right(tree, node, i);
+    return i;
+  }
+
+  if (i < node->count) {
+    bt_merge(tree, node, i);
+    return i;
+  }
+  bt_merge(tree, node, i - 1);
+  return i - 1;
+}
+
+// Retira o maior elemento da sub-árvore, movendo-o (sem destruir) para `dst`.
+static void bt_extract_max(bt_tree *tree, bt_node *node, char *dst) {
+  while (!node->leaf) {
+    unsigned int i = bt_fill(tree, node, node->count);
+    node = bt_children(tree, node)[i];
+  }
+  memcpy(dst, bt_slot(tree, node, node->count - 1), tree->slot_size);
+  node->count--;
+}
+
+// Retira o menor elemento da sub-árvore, movendo-o (sem destruir) para `dst`.
+static void bt_extract_min(bt_tree *tree, bt_node *node, char *dst) {
+  while (!node->leaf) {
+    unsigned int i = bt_fill(tree, node, 0);
+    node = bt_children(tree, node)[i];
+  }
+  memcpy(dst, bt_slot(tree, node, 0), tree->slot_size);
+  bt_move_keys(tree, node, 0, node, 1, node->count - 1);
+  node->count--;
+}
+
+// Faz uma remoção recursiva a partir de `node`, que já possui elementos
+// suficientes para perder um (ou é a raiz).
+static int bt_impl_remove(bt_tree *tree, bt_node *node, void *value) {
+  int found;
+  unsigned int i = bt_find_index(tree, node, value, &found);
+
+  if (found) {
+    if (node->leaf) {
+      bt_destroy_slot(tree, bt_slot(tree, node, i));
+      bt_move_keys(tree, node, i, node, i + 1, node->count - i - 1);
+      node->count--;
+      return 1;
+    }
+
+    // Em um nó interno o elemento é substituído pelo antecessor ou sucessor.
+    bt_node *left = bt_children(tree, node)[i];
+    bt_node *right = bt_children(tree, node)[i + 1];
+    if (left->count >= BT_MIN_DEGREE) {
+      bt_destroy_slot(tree, bt_slot(tree, node, i));
+      bt_extract_max(tree, left, bt_slot(tree, node, i));
+      return 1;
+    }
+    if (right->count >= BT_MIN_DEGREE) {
+      bt_destroy_slot(tree, bt_slot(tree, node, i));
+      bt_extract_min(tree, right, bt_slot(tree, node, i));
+      return 1;
+    }
+
+    // Os dois filhos são mínimos: junta tudo e remove do nó resultante.
+    bt_merge(tree, node, i);
+    return bt_impl_remove(tree, left, value);
+  }
+
+  if (node->leaf)
+    return 0; // Não encontrado.
+
+  i = bt_fill(tree, node, i);
+  return bt_impl_remove(tree, bt_children(tree, node)[i], value);
+}
+
+// Função recursiva para destruir todos os nós.
+static void bt_impl_clear(bt_tree *tree, bt_node *node) {
+  if (!node->leaf) {
+    for (unsigned int i = 0; i <= node->count; i++)
+      bt_impl_clear(tree, bt_children(tree, node)[i]);
+  }
+  for (unsigned int i = 0; i < node->count; i++)
+    bt_destroy_slot(tree, bt_slot(tree, node, i));
+  free(node);
+}
+
+// Bytes de cada elemento inline: `value_size` arredondado para o alinhamento
+// que um valor desse tamanho pode exigir (a menor potência de dois >=
+// `value_size`, até 8), para que todos os elementos do nó fiquem alinhados.
+// Valores de 1, 2, 4 e 8 bytes continuam sem folga, e um tipo com
+// alinhamento maior (long double) tem tamanho múltiplo dele, então também
+// fica alinhado a partir de `keys`.
+static size_t bt_slot_size(size_t value_size) {
+  size_t align = 1;
+  while (align < value_size && align < 8)
+    align <<= 1;
+  return (value_size + align - 1) & ~(align - 1);
+}
+
+// Inicializa a árvore para os dois modos de armazenamento dos valores.
+static bt_tree *bt_init_tree(bt_function_compare compare, bt_function_copy copy,
+                             bt_function_destroy destroy, size_t value_size) {
+  bt_tree *tree = (bt_tree *)malloc(sizeof(bt_tree));
+  tree->function_compare = compare;
+  tree->function_copy = copy;
+  tree->function_destroy = destroy;
+  tree->root = NULL;
+  tree->size = 0;
+
+  tree->value_size = value_size;
+  tree->slot_size = (value_size > 0) ? bt_slot_size(value_size)
+                                     : sizeof(void *);
+
+  // Os elementos começam alinhados a `max_align_t` (`keys`) e o vetor de
+  // filhos começa alinhado após o último elemento.
+  size_t offset = offsetof(bt_node, keys) + BT_MAX_KEYS * tree->slot_size;
+  tree->children_offset =
+      (offset + sizeof(void *) - 1) & ~(sizeof(void *) - 1);
+
+  return tree;
+}
+
+// ======================================== //
+//         Implementações publicas.         //
+// ======================================== //
+
+bt_tree *bt_create_tree(bt_function_compare compare, bt_function_copy copy,
+                        bt_function_destroy destroy) {
+  return bt_init_tree(compare, copy, destroy, 0);
+}
+
+bt_tree *bt_create_tree_inline(bt_function_compare compare,
+                               size_t value_size) {
+  return bt_init_tree(compare, NULL, NULL, value_size);
+}
+
+void bt_clear(bt_tree *tree) {
+  if (tree == NULL || tree->root == NULL)
+    return;
+
+  bt_impl_clear(tree, tree->root);
+  tree->root = NULL;
+  tree->size = 0;
+}
+
+void bt_destroy_tree(bt_tree *tree) {
+  if (tree == NULL)
+    return;
+  bt_clear(tree);
+  free(tree);
+}
+
+int bt_insert(bt_tree *tree, void *value) {
+  if (tree == NULL)
+    return 0;
+
+  if (tree->root == NULL)
+    tree->root = bt_create_node(tree, 1);
+
+  // Raiz cheia: a árvore cresce em altura.
+  if (tree->root->count == BT_MAX_KEYS) {
+    bt_node *root = bt_create_node(tree, 0);
+    bt_children(tree, root)[0] = tree->root;
+    bt_split_child(tree, root, 0);
+    tree->root = root;
+  }
+
+  // Descida única: todo nó cheio no caminho é dividido antes de descer.
+  bt_node *node = tree->root;
+  for (;;) {
+    int found;
+    unsigned int i = bt_find_index(tree, node, value, &found);
+    if (found)
+      return 0; // Valor duplicado.
+
+    if (node->leaf) {
+      bt_move_keys(tree, node, i + 1, node, i, node->count - i);
+      bt_store(tree, bt_slot(tree, node, i), value);
+      node->count++;
+      tree->size++;
+      return 1;
+    }
+
+    if (bt_children(tree, node)[i]->count == BT_MAX_KEYS) {
+      bt_split_child(tree, node, i);
+      int cmp = tree->function_compare(
+          value, bt_value(tree, bt_slot(tree, node, i)));
+      if (cmp == 0)
+        return 0;
+      if (cmp > 0)
+        i++;
+    }
+    node = bt_children(tree, node)[i];
+  }
+}
+
+int bt_remove(bt_tree *tree, void *value) {
+  if (tree == NULL || tree->root == NULL)
+    return 0;
+
+  int removed = bt_impl_remove(tree, tree->root, value);
+
+  // Raiz sem elementos: a árvore diminui em altura.
+  if (tree->root->count == 0) {
+    bt_node *old = tree->root;
+    tree->root = old->leaf ? NULL : bt_children(tree, old)[0];
+    free(old);
+  }
+
+  if (removed)
+    tree->size--;
+  return removed;
+}
+
+void *bt_search(bt_tree *tree, void *value) {
+  if (tree == NULL)
+    return NULL;
+
+  bt_node *node = tree->root;
+  while (node != NULL) {
+    int found;
+    unsigned int i = bt_find_index(tree, node, value, &found);
+    if (found)
+      return bt_value(tree, bt_slot(tree, node, i));
+    if (node->leaf)
+      break;
+    node = bt_children(tree, node)[i];
+  }
+  return NULL;
+}
+
+unsigned int bt_size(bt_tree *tree) {
+  if (tree != NULL)
+    return tree->size;
+  return 0;
+}
@@ -0,0 +1,343 @@
+#include <frozen.h>
+
+#include <stdlib.h>
+#include <string.h>
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#endif
+
+// Busca antecipada (prefetch) de uma linha de cache, quando disponível.
+#if defined(__GNUC__) || defined(__clang__)
+#define FROZEN_PREFETCH(addr) __builtin_prefetch(addr)
+#else
+#define FROZEN_PREFETCH(addr) ((void)(addr))
+#endif
+
+// Tamanho da linha de cache (alinhamento do vetor).
+#define FROZEN_CACHE_LINE 64
+
+// Quantidade de buscas intercaladas em `frozen_search_many_i64`, sem AVX2 e
+// com AVX2 (múltiplo de 4).
+#define FROZEN_BATCH_GROUP 8
+#define FROZEN_AVX2_LANES 32
+
+// Origem dos elementos, em ordem crescente: um vetor ou uma das árvores.
+typedef struct frozen_source {
+  const char *values; // Vetor (se não for NULL) e o tamanho dos elementos.
+  size_t stride;
+
+  rb_tree *rb;
+  rb_node *rb_node;
+  avl_node *avl_node;
+} frozen_source;
+
+// ======================================== //
+//         Implementações privadas.         //
+// ======================================== //
+
+// Compara dois int64_t (chave, elemento).
+static int frozen_compare_i64(void *a, void *b) {
+  int64_t x = *(const int64_t *)a;
+  int64_t y = *(const int64_t *)b;
+  return (x > y) - (x < y);
+}
+
+// Retorna o próximo elemento da origem.
+static const void *frozen_source_next(frozen_source *source) {
+  const void *value;
+  if (source->values != NULL) {
+    value = source->values;
+    source->values += source->stride;
+  } else if (source->rb != NULL) {
+    value = source->rb_node->value;
+    source->rb_node = rb_next(source->rb, source->rb_node);
+  } else {
+    value = source->avl_node->value;
+    source->avl_node = avl_next(source->avl_node);
+  }
+  return value;
+}
+
+// Preenche a sub-árvore implícita da posição `k` percorrendo-a em ordem, de
+// modo que os elementos (em ordem crescente) caiam nas posições certas.
+static void frozen_fill(frozen_index *index, size_t k, frozen_source *source) {
+  if (k > index->count)
+    return;
+  frozen_fill(index, 2 * k, source);
+  memcpy(index->keys + k * index->element_size, frozen_source_next(source),
+         index->element_size);
+  frozen_fill(index, 2 * k + 1, source);
+}
+
+// Cria o índice com `count` elementos vindos da origem.
+static frozen_index *frozen_build(frozen_source *source, size_t count,
+                                  size_t element_size,
+                                  frozen_function_compare compare,
+                                  int is_i64) {
+  if (element_size == 0 || compare == NULL)
+    return NULL;
+
+  frozen_index *index = (frozen_index *)malloc(sizeof(frozen_index));
+  if (index == NULL)
+    return NULL;
+
+  // O vetor começa alinhado à linha de cache (a posição 0 não é usada).
+  size_t bytes = (count + 1) * element_size;
+  bytes = (bytes + FROZEN_CACHE_LINE - 1) / FROZEN_CACHE_LINE *
+          FROZEN_CACHE_LINE;
+  index->keys = (char *)aligned_alloc(FROZEN_CACHE_LINE, bytes);
+  if (index->keys == NULL) {
+    free(index);
+    return NULL;
+  }
+
+  index->count = count;
+  index->element_size = element_size;
+  index->is_i64 = is_i64;
+  index->function_compare = compare;
+
+  // Os descendentes de k alguns níveis abaixo ocupam as posições
+  // [k * prefetch, k * prefetch + prefetch), que cabem em uma linha de cache.
+  index->prefetch = 2;
+  while (index->prefetch * 2 * element_size <= FROZEN_CACHE_LINE)
+    index->prefetch *= 2;
+
+  memset(index->keys, 0, element_size); // Posição 0 sem uso.
+  frozen_fill(index, 1, source);
+  return index;
+}
+
+// Posição do primeiro elemento >= chave a partir da posição em que a descida
+// saiu do vetor: sobe enquanto veio pela direita, e mais um nível (0 indica
+// que todos os elementos são menores que a chave).
+static size_t frozen_restore(size_t k) {
+#if defined(__GNUC__) || defined(__clang__)
+  return k >> __builtin_ffsll((long long)~k);
+#else
+  while (k & 1)
+    k >>= 1;
+  return k >> 1;
+#endif
+}
+
+// Desce sem desvios até sair do vetor. Retorna a posição do primeiro
+// elemento >= `key` (0 se não existir).
+static size_t frozen_find(frozen_index *index, void *key) {
+  const char *keys = index->keys;
+  size_t size = index->element_size;
+  size_t ahead = index->prefetch * size;
+  size_t k = 1;
+
+  while (k <= index->count) {
+    FROZEN_PREFETCH(keys + k * ahead);
+    k = 2 * k + (index->function_compare(key, (void *)(keys + k * size)) > 0);
+  }
+  return frozen_restore(k);
+}
+
+// Mesma descida para int64_t, comparando direto.
+static size_t frozen_find_i64(frozen_index *index, int64_t key) {
+  const int64_t *keys = (const int64_t *)index->keys;
+  size_t ahead = index->prefetch;
+  size_t k = 1;
+
+  while (k <= index->count) {
+    FROZEN_PREFETCH(keys + k * ahead);
+    k = 2 * k + (keys[k] < key);
+  }
+  return frozen_restore(k);
+}
+
+// Retorna o elemento na posição `k` se for igual a `key`.
+static const int64_t *frozen_match_i64(frozen_index *index, size_t k,
+                                       int64_t key) {
+  const int64_t *keys = (const int64_t *)index->keys;
+  return (k != 0 && keys[k] == key) ? &keys[k] : NULL;
+}
+
+// Quantidade de níveis da árvore implícita (floor(log2(count)) + 1).
+static int frozen_levels(size_t count) {
+  int levels = 0;
+  for (; count > 0; count >>= 1)
+    levels++;
+  return levels;
+}
+
+#if defined(__AVX2__)
+// Desce FROZEN_AVX2_LANES buscas juntas: cada faixa dos vetores AVX2 guarda
+// uma posição k, os elementos são lidos com gather e as faixas que já saíram
+// do vetor ficam paradas (máscara). Vários vetores por vez mantêm mais
+// leituras da memória em andamento.
+static void frozen_search_avx2_i64(frozen_index *index, const int64_t *keys,
+                                   const int64_t **results) {
+  const long long *base = (const long long *)index->keys;
+  const __m256i one = _mm256_set1_epi64x(1);
+  const __m256i limit = _mm256_set1_epi64x((long long)index->count + 1);
+  __m256i key[FROZEN_AVX2_LANES / 4];
+  __m256i k[FROZEN_AVX2_LANES / 4];
+  for (int v = 0; v < FROZEN_AVX2_LANES / 4; v++) {
+    key[v] = _mm256_loadu_si256((const __m256i *)(keys + 4 * v));
+    k[v] = one;
+  }
+
+  int levels = frozen_levels(index->count);
+  for (int level = 0; level < levels; level++) {
+    for (int v = 0; v < FROZEN_AVX2_LANES / 4; v++) {
+      __m256i active = _mm256_cmpgt_epi64(limit, k[v]); // k <= count
+      __m256i value = _mm256_mask_i64gather_epi64(_mm256_setzero_si256(),
+                                                  base, k[v], active, 8);
+      __m256i right =
+          _mm256_and_si256(_mm256_cmpgt_epi64(key[v], value), one);
+      __m256i next = _mm256_add_epi64(_mm256_add_epi64(k[v], k[v]), right);
+      k[v] = _mm256_blendv_epi8(k[v], next, active);
+    }
+  }
+
+  long long positions[FROZEN_AVX2_LANES];
+  for (int v = 0; v < FROZEN_AVX2_LANES / 4; v++)
+    _mm256_storeu_si256((__m256i *)(positions + 4 * v), k[v]);
+  for (int i = 0; i < FROZEN_AVX2_LANES; i++)
+    results[i] =
+        frozen_match_i64(index, frozen_restore((size_t)positions[i]), keys[i]);
+}
+#endif
+
+// Intercala até FROZEN_BATCH_GROUP buscas, um nível de cada por vez.
+static void frozen_search_group_i64(frozen_index *index, const int64_t *keys,
+                                    const int64_t **results, size_t count) {
+  const int64_t *base = (const int64_t *)index->keys;
+  size_t ahead = index->prefetch;
+  size_t k[FROZEN_BATCH_GROUP];
+  for (size_t i = 0; i < count; i++)
+    k[i] = 1;
+
+  int levels = frozen_levels(index->count);
+  for (int level = 0; level < levels; level++) {
+    for (size_t i = 0; i < count; i++) {
+      if (k[i] <= index->count) {
+        FROZEN_PREFETCH(base + k[i] * ahead);
+        k[i] = 2 * k[i] + (base[k[i]] < keys[i]);
+      }
+    }
+  }
+
+  for (size_t i = 0; i < count; i++)
+    results[i] = frozen_match_i64(index, frozen_restore(k[i]), keys[i]);
+}
+
+// ======================================== //
+//         Implementações publicas.         //
+// ======================================== //
+
+frozen_index *frozen_create(const void *values, size_t count,
+                            size_t element_size,
+                            frozen_function_compare compare) {
+  frozen_source source = {(const char *)values, element_size, NULL, NULL,
+                          NULL};
+  return frozen_build(&source, count, element_size, compare, 0);
+}
+
+frozen_index *frozen_create_i64(const int64_t *values, size_t count) {
+  frozen_source source = {(const char *)values, sizeof(int64_t), NULL, NULL,
+                          NULL};
+  return frozen_build(&source, count, sizeof(int64_t), frozen_compare_i64, 1);
+}
+
+frozen_index *rb_freeze(rb_tree *tree, size_t element_size) {
+  // O índice só guarda os elementos: os valores de um mapa seriam perdidos.
+  if (tree == NULL || tree->map_value_offset != 0)
+    return NULL;
+
+  frozen_source source = {NULL, 0, tree, rb_first(tree), NULL};
+  return frozen_build(&source, tree->size,
+                      element_size ? element_size : tree->value_size,
+                      tree->function_compare, 0);
+}
+
+frozen_index *avl_freeze(avl_tree *tree, size_t element_size) {
+  if (tree == NULL || tree->map_value_offset != 0)
+    return NULL;
+
+  frozen_source source = {NULL, 0, NULL, NULL, avl_first(tree)};
+  return frozen_build(&source, tree->size,
+                      element_size ? element_size : tree->value_size,
+                      tree->function_compare, 0);
+}
+
+frozen_index *rb_freeze_i64(rb_tree *tree) {
+  if (tree == NULL || tree->map_value_offset != 0)
+    return NULL;
+
+  frozen_source source = {NULL, 0, tree, rb_first(tree), NULL};
+  return frozen_build(&source, tree->size, sizeof(int64_t),
+                      frozen_compare_i64, 1);
+}
+
+frozen_index *avl_freeze_i64(avl_tree *tree) {
+  if (tree == NULL || tree->map_value_offset != 0)
+    return NULL;
+
+  frozen_source source = {NULL, 0, NULL, NULL, avl_first(tree)};
+  return frozen_build(&source, tree->size, sizeof(int64_t),
+                      frozen_compare_i64, 1);
+}
+
+void frozen_destroy(frozen_index *index) {
+  if (index == NULL)
+    return;
+  free(index->keys);
+  free(index);
+}
+
+size_t frozen_size(frozen_index *index) { return index->count; }
+
+const void *frozen_search(frozen_index *index, void *key) {
+  size_t k = frozen_find(index, key);
+  if (k == 0)
+    return NULL;
+
+  void *element = index->keys + k * index->element_size;
+  return (index->function_compare(key, element) == 0) ? element : NULL;
+}
+
+const void *frozen_lower_bound(frozen_index *index, void *key) {
+  size_t k = frozen_find(index, key);
+  return (k != 0) ? index->keys + k * index->element_size : NULL;
+}
+
+const int64_t *frozen_search_i64(frozen_index *index, int64_t key) {
+  if (!index->is_i64)
+    return NULL;
+  return frozen_match_i64(index, frozen_find_i64(index, key), key);
+}
+
+const int64_t *frozen_lower_bound_i64(frozen_index *index, int64_t key) {
+  if (!index->is_i64)
+    return NULL;
+
+  size_t k = frozen_find_i64(index, key);
+  return (k != 0) ? (const int64_t *)index->keys + k : NULL;
+}
+
+void frozen_search_many_i64(frozen_index *index, const int64_t *keys,
+                            const int64_t **results, size_t count) {
+  if (!index->is_i64) {
+    for (size_t i = 0; i < count; i++)
+      results[i] = NULL;
+    return;
+  }
+
+  size_t i = 0;
+#if defined(__AVX2__)
+  for (; i + FROZEN_AVX2_LANES <= count; i += FROZEN_AVX2_LANES)
+    frozen_search_avx2_i64(index, keys + i, results + i);
+#endif
+  while (i < count) {
+    size_t n = count - i;
+    if (n > FROZEN_BATCH_GROUP)
+      n = FROZEN_BATCH_GROUP;
+    frozen_search_group_i64(index, keys + i, results + i, n);
+    i += n;
+  }
+}
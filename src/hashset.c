@@ -0,0 +1,353 @@
+#include <hashset.h>
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+// Bytes de controle especiais. As posições livres têm o bit mais alto ligado;
+// as ocupadas guardam os 7 bits mais baixos do hash (0 a 127).
+#define HS_EMPTY ((signed char)-128)
+#define HS_DELETED ((signed char)-2)
+
+// Capacidade da primeira tabela alocada.
+#define HS_MIN_CAPACITY 16
+
+// Retorno de `hs_find_index` quando o elemento não existe.
+#define HS_NOT_FOUND ((size_t)-1)
+
+// Índice do bit menos significativo ligado (x != 0).
+#if defined(__GNUC__) || defined(__clang__)
+#define HS_CTZ(x) ((unsigned int)__builtin_ctz(x))
+#else
+static unsigned int hs_ctz(unsigned int x) {
+  unsigned int n = 0;
+  while (!(x & 1)) {
+    x >>= 1;
+    n++;
+  }
+  return n;
+}
+#define HS_CTZ(x) hs_ctz(x)
+#endif
+
+// ======================================== //
+//         Implementações privadas.         //
+// ======================================== //
+
+// Máscara com um bit para cada byte de controle do grupo em `ctrl` igual a
+// `c`. Com SSE2 os HS_GROUP_WIDTH bytes são comparados de uma vez.
+static unsigned int hs_match(const signed char *ctrl, signed char c) {
+#if defined(__SSE2__)
+  __m128i group = _mm_loadu_si128((const __m128i *)ctrl);
+  return (unsigned int)_mm_movemask_epi8(
+      _mm_cmpeq_epi8(group, _mm_set1_epi8(c)));
+#else
+  unsigned int mask = 0;
+  for (int i = 0; i < HS_GROUP_WIDTH; i++)
+    mask |= (unsigned int)(ctrl[i] == c) << i;
+  return mask;
+#endif
+}
+
+// Máscara das posições livres (vazias ou removidas) do grupo.
+static unsigned int hs_match_free(const signed char *ctrl) {
+#if defined(__SSE2__)
+  // O bit mais alto de cada byte já indica uma posição livre.
+  return (unsigned int)_mm_movemask_epi8(
+      _mm_loadu_si128((const __m128i *)ctrl));
+#else
+  unsigned int mask = 0;
+  for (int i = 0; i < HS_GROUP_WIDTH; i++)
+    mask |= (unsigned int)(ctrl[i] < 0) << i;
+  return mask;
+#endif
+}
+
+// Mistura os bits do hash do usuário, para que hashes ruins (como a
+// identidade de inteiros) se espalhem pela tabela.
+static uint64_t hs_hash(hs_set *set, void *value) {
+  uint64_t h = (uint64_t)set->function_hash(value);
+  h ^= h >> 33;
+  h *= 0xff51afd7ed558ccdull;
+  h ^= h >> 33;
+  h *= 0xc4ceb9fe1a85ec53ull;
+  h ^= h >> 33;
+  return h;
+}
+
+// Quantidade máxima de posições ocupadas (vazias que viraram ocupadas ou
+// removidas) antes de reorganizar a tabela: 7/8 da capacidade.
+static size_t hs_max_load(size_t capacity) { return capacity - capacity / 8; }
+
+// Retorna a posição `i` do vetor de elementos.
+static char *hs_slot(hs_set *set, size_t i) {
+  return set->slots + i * set->slot_size;
+}
+
+// Retorna o elemento guardado na posição `i`.
+static void *hs_value(hs_set *set, size_t i) {
+  char *slot = hs_slot(set, i);
+  return (set->value_size > 0) ? (void *)slot : *(void **)slot;
+}
+
+// Define o byte de controle da posição `i`. Os primeiros bytes são repetidos
+// após o fim da tabela para que um grupo lido perto do fim dê a volta.
+static void hs_set_ctrl(hs_set *set, size_t i, signed char c) {
+  set->ctrl[i] = c;
+  if (i < HS_GROUP_WIDTH)
+    set->ctrl[set->capacity + i] = c;
+}
+
+// Busca a posição do elemento igual a `value`. A sondagem percorre grupos
+// (com passos crescentes, que visitam toda a tabela) e para no primeiro grupo
+// com uma posição vazia.
+static size_t hs_find_index(hs_set *set, void *value, uint64_t hash) {
+  size_t mask = set->capacity - 1;
+  size_t pos = (size_t)(hash >> 7) & mask;
+  signed char h2 = (signed char)(hash & 0x7F);
+
+  for (size_t stride = HS_GROUP_WIDTH;; stride += HS_GROUP_WIDTH) {
+    const signed char *group = set->ctrl + pos;
+    for (unsigned int match = hs_match(group, h2); match != 0;
+         match &= match - 1) {
+      size_t i = (pos + HS_CTZ(match)) & mask;
+      if (set->function_compare(value, hs_value(set, i)) == 0)
+        return i;
+    }
+    if (hs_match(group, HS_EMPTY) != 0)
+      return HS_NOT_FOUND;
+    pos = (pos + stride) & mask;
+  }
+}
+
+// Retorna a primeira posição livre (vazia ou removida) da sondagem de `hash`.
+static size_t hs_find_free(hs_set *set, uint64_t hash) {
+  size_t mask = set->capacity - 1;
+  size_t pos = (size_t)(hash >> 7) & mask;
+
+  for (size_t stride = HS_GROUP_WIDTH;; stride += HS_GROUP_WIDTH) {
+    unsigned int free_mask = hs_match_free(set->ctrl + pos);
+    if (free_mask != 0)
+      return (pos + HS_CTZ(free_mask)) & mask;
+    pos = (pos + stride) & mask;
+  }
+}
+
+// Troca a tabela por uma nova, vazia, com `capacity` posições.
+static int hs_alloc_table(hs_set *set, size_t capacity) {
+  signed char *ctrl = (signed char *)malloc(capacity + HS_GROUP_WIDTH);
+  char *slots = (char *)malloc(capacity * set->slot_size);
+  if (ctrl == NULL || slots == NULL) {
+    free(ctrl);
+    free(slots);
+    return 0;
+  }
+
+  memset(ctrl, HS_EMPTY, capacity + HS_GROUP_WIDTH);
+  set->ctrl = ctrl;
+  set->slots = slots;
+  set->capacity = capacity;
+  set->growth_left = hs_max_load(capacity);
+  return 1;
+}
+
+// Reorganiza a tabela quando não há mais posições vazias para ocupar: dobra a
+// capacidade se os elementos ocupam mais da metade da carga máxima; senão
+// apenas reinsere os elementos, descartando as posições removidas.
+static int hs_rehash(hs_set *set) {
+  signed char *old_ctrl = set->ctrl;
+  char *old_slots = set->slots;
+  size_t old_capacity = set->capacity;
+
+  size_t capacity = old_capacity;
+  if (set->size + 1 > hs_max_load(old_capacity) / 2)
+    capacity *= 2;
+  if (!hs_alloc_table(set, capacity))
+    return 0;
+
+  // A função de comparação não é chamada: os elementos já são distintos.
+  for (size_t i = 0; i < old_capacity; i++) {
+    if (old_ctrl[i] < 0)
+      continue;
+    char *slot = old_slots + i * set->slot_size;
+    void *value = (set->value_size > 0) ? (void *)slot : *(void **)slot;
+    uint64_t hash = hs_hash(set, value);
+    size_t j = hs_find_free(set, hash);
+    hs_set_ctrl(set, j, (signed char)(hash & 0x7F));
+    memcpy(hs_slot(set, j), slot, set->slot_size);
+  }
+  set->growth_left -= set->size;
+
+  free(old_ctrl);
+  free(old_slots);
+  return 1;
+}
+
+// Destroi as cópias de todos os elementos (modo padrão).
+static void hs_destroy_values(hs_set *set) {
+  if (set->value_size > 0 || set->function_destroy == NULL)
+    return;
+  for (size_t i = 0; i < set->capacity; i++) {
+    if (set->ctrl[i] >= 0)
+      set->function_destroy(*(void **)hs_slot(set, i));
+  }
+}
+
+// Bytes de cada elemento inline: `value_size` arredondado para a menor
+// potência de dois >= `value_size`, até 8. O vetor vem do malloc (alinhado a
+// `max_align_t`), então todos os elementos ficam alinhados; tipos com
+// alinhamento maior têm tamanho múltiplo dele e não mudam.
+static size_t hs_slot_size(size_t value_size) {
+  size_t align = 1;
+  while (align < value_size && align < 8)
+    align <<= 1;
+  return (value_size + align - 1) & ~(align - 1);
+}
+
+// Inicializa o conjunto para os dois modos de armazenamento dos valores.
+static hs_set *hs_init_set(hs_function_hash hash, hs_function_compare compare,
+                           hs_function_copy copy, hs_function_destroy destroy,
+                           size_t value_size) {
+  hs_set *set = (hs_set *)malloc(sizeof(hs_set));
+  if (set == NULL)
+    return NULL;
+
+  // A tabela só é alocada na primeira inserção.
+  set->ctrl = NULL;
+  set->slots = NULL;
+  set->capacity = 0;
+  set->growth_left = 0;
+  set->size = 0;
+  set->value_size = value_size;
+  set->slot_size = (value_size > 0) ? hs_slot_size(value_size)
+                                    : sizeof(void *);
+
+  set->function_hash = hash;
+  set->function_compare = compare;
+  set->function_copy = copy;
+  set->function_destroy = destroy;
+  return set;
+}
+
+// ======================================== //
+//         Implementações publicas.         //
+// ======================================== //
+
+hs_set *hs_create_set(hs_function_hash hash, hs_function_compare compare,
+                      hs_function_copy copy, hs_function_destroy destroy) {
+  return hs_init_set(hash, compare, copy, destroy, 0);
+}
+
+hs_set *hs_create_set_inline(hs_function_hash hash,
+                             hs_function_compare compare, size_t value_size) {
+  return hs_init_set(hash, compare, NULL, NULL, value_size);
+}
+
+void hs_clear(hs_set *set) {
+  if (set == NULL || set->capacity == 0)
+    return;
+
+  hs_destroy_values(set);
+  memset(set->ctrl, HS_EMPTY, set->capacity + HS_GROUP_WIDTH);
+  set->growth_left = hs_max_load(set->capacity);
+  set->size = 0;
+}
+
+void hs_destroy_set(hs_set *set) {
+  if (set == NULL)
+    return;
+
+  hs_destroy_values(set);
+  free(set->ctrl);
+  free(set->slots);
+  free(set);
+}
+
+int hs_insert(hs_set *set, void *value) {
+  if (set == NULL)
+    return 0;
+  if (set->capacity == 0 && !hs_alloc_table(set, HS_MIN_CAPACITY))
+    return 0;
+
+  uint64_t hash = hs_hash(set, value);
+  if (hs_find_index(set, value, hash) != HS_NOT_FOUND)
+    return 0; // Duplicata.
+
+  size_t i = hs_find_free(set, hash);
+  if (set->ctrl[i] == HS_EMPTY && set->growth_left == 0) {
+    if (!hs_rehash(set))
+      return 0;
+    i = hs_find_free(set, hash);
+  }
+
+  // Posições removidas são reaproveitadas sem consumir `growth_left`.
+  if (set->ctrl[i] == HS_EMPTY)
+    set->growth_left--;
+  hs_set_ctrl(set, i, (signed char)(hash & 0x7F));
+
+  char *slot = hs_slot(set, i);
+  if (set->value_size > 0)
+    memcpy(slot, value, set->value_size);
+  else
+    *(void **)slot = set->function_copy(value);
+
+  set->size++;
+  return 1;
+}
+
+int hs_remove(hs_set *set, void *value) {
+  if (set == NULL || set->size == 0)
+    return 0;
+
+  size_t i = hs_find_index(set, value, hs_hash(set, value));
+  if (i == HS_NOT_FOUND)
+    return 0;
+
+  if (set->value_size == 0 && set->function_destroy != NULL)
+    set->function_destroy(*(void **)hs_slot(set, i));
+
+  // Se nenhum grupo que contém `i` esteve totalmente ocupado, nenhuma
+  // sondagem passou por `i` sem parar, e a posição pode voltar a ser vazia.
+  // Senão ela fica marcada como removida, para não interromper sondagens.
+  size_t mask = set->capacity - 1;
+  unsigned int empty_before =
+      hs_match(set->ctrl + ((i - HS_GROUP_WIDTH) & mask), HS_EMPTY);
+  unsigned int empty_after = hs_match(set->ctrl + i, HS_EMPTY);
+  unsigned int run = HS_GROUP_WIDTH;
+  if (empty_before != 0 && empty_after != 0) {
+    // Posições ocupadas antes de `i` (contadas do fim do grupo anterior) e a
+    // partir de `i`.
+    unsigned int before = 0;
+    while (!(empty_before & (1u << (HS_GROUP_WIDTH - 1 - before))))
+      before++;
+    run = before + HS_CTZ(empty_after);
+  }
+
+  if (run < HS_GROUP_WIDTH) {
+    hs_set_ctrl(set, i, HS_EMPTY);
+    set->growth_left++;
+  } else {
+    hs_set_ctrl(set, i, HS_DELETED);
+  }
+
+  set->size--;
+  return 1;
+}
+
+void *hs_search(hs_set *set, void *value) {
+  if (set == NULL || set->size == 0)
+    return NULL;
+
+  size_t i = hs_find_index(set, value, hs_hash(set, value));
+  return (i != HS_NOT_FOUND) ? hs_value(set, i) : NULL;
+}
+
+unsigned int hs_size(hs_set *set) {
+  if (set != NULL)
+    return set->size;
+  return 0;
+}
@@ -0,0 +1,112 @@
+#include <nodepool.h>
+
+#include <stdlib.h>
+
+// Quantidade de blocos do primeiro chunk e limite de bytes por chunk.
+#define POOL_FIRST_BLOCKS 32
+#define POOL_MAX_CHUNK_BYTES (1u << 20)
+
+// Cabeçalho de cada chunk, mantém a lista de chunks para liberação.
+typedef struct pool_chunk {
+  struct pool_chunk *next;
+  void *padding; // Cabeçalho de 16 bytes: o primeiro bloco fica alinhado
+                 // como o retorno do malloc.
+} pool_chunk;
+
+// ======================================== //
+//         Implementações privadas.         //
+// ======================================== //
+
+// Aloca um novo chunk e o torna o chunk atual.
+static int pool_grow(node_pool *pool) {
+  size_t bytes = sizeof(pool_chunk) + pool->block_size * pool->chunk_blocks;
+  pool_chunk *chunk = (pool_chunk *)malloc(bytes);
+  if (chunk == NULL)
+    return 0;
+
+  chunk->next = (pool_chunk *)pool->chunks;
+  pool->chunks = chunk;
+  pool->chunk_count++;
+
+  pool->cursor = (char *)(chunk + 1);
+  pool->limit = pool->cursor + pool->block_size * pool->chunk_blocks;
+
+  // O próximo chunk terá o dobro de blocos, até o limite.
+  if (pool->block_size * pool->chunk_blocks * 2 <= POOL_MAX_CHUNK_BYTES)
+    pool->chunk_blocks *= 2;
+
+  return 1;
+}
+
+// ======================================== //
+//         Implementações publicas.         //
+// ======================================== //
+
+node_pool *pool_create(size_t block_size) {
+  node_pool *pool = (node_pool *)malloc(sizeof(node_pool));
+  if (pool == NULL)
+    return NULL;
+
+  // Todo bloco precisa caber o ponteiro da lista livre. Os blocos ficam
+  // alinhados a `sizeof(void *)` (o que os nós exigem), não a 16 bytes: um
+  // arredondamento maior faria um nó de 40 bytes ocupar 48.
+  if (block_size < sizeof(void *))
+    block_size = sizeof(void *);
+  block_size = (block_size + sizeof(void *) - 1) & ~(sizeof(void *) - 1);
+
+  pool->block_size = block_size;
+  pool->chunk_blocks = POOL_FIRST_BLOCKS;
+  pool->chunks = NULL;
+  pool->free_list = NULL;
+  pool->cursor = NULL;
+  pool->limit = NULL;
+  pool->chunk_count = 0;
+
+  return pool;
+}
+
+void *pool_alloc(node_pool *pool) {
+  // Reaproveita um bloco liberado, se existir.
+  if (pool->free_list != NULL) {
+    void *block = pool->free_list;
+    pool->free_list = *(void **)block;
+    return block;
+  }
+
+  if (pool->cursor == pool->limit && !pool_grow(pool))
+    return NULL;
+
+  void *block = pool->cursor;
+  pool->cursor += pool->block_size;
+  return block;
+}
+
+void pool_free(node_pool *pool, void *block) {
+  *(void **)block = pool->free_list;
+  pool->free_list = block;
+}
+
+void pool_clear(node_pool *pool) {
+  if (pool == NULL)
+    return;
+
+  pool_chunk *chunk = (pool_chunk *)pool->chunks;
+  while (chunk != NULL) {
+    pool_chunk *next = chunk->next;
+    free(chunk);
+    chunk = next;
+  }
+
+  pool->chunks = NULL;
+  pool->free_list = NULL;
+  pool->cursor = NULL;
+  pool->limit = NULL;
+  pool->chunk_blocks = POOL_FIRST_BLOCKS;
+}
+
+void pool_destroy(node_pool *pool) {
+  if (pool == NULL)
+    return;
+  pool_clear(pool);
+  free(pool);
+}
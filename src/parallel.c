@@ -0,0 +1,548 @@
+#include <parallel.h>
+
+#include <stdatomic.h>
+#include <stdlib.h>
+#include <string.h>
+
+// Quantidade de pedaços da árvore por thread do pool.
+#define PAR_PIECES_PER_THREAD 8
+
+// Abaixo destes tamanhos a operação é feita na thread atual.
+#define PAR_MIN_ELEMENTS 4096
+#define PAR_SORT_MIN_ELEMENTS 8192
+
+// Runs ordenados por inserção antes das passadas de merge.
+#define PAR_SORT_RUN 16
+
+// Comparação comum às duas árvores.
+typedef int (*par_function_compare)(void *, void *);
+
+// Operação paralela sobre uma das árvores.
+typedef struct par_job {
+  rb_tree *rb; // Árvore percorrida (apenas uma das duas é usada).
+  avl_tree *avl;
+
+  int (*visit)(void *, void *); // Visita (for_each) ou NULL.
+  par_function_reduce reduce;   // Redução (reduce) ou NULL.
+  void *ctx;
+
+  atomic_int stop; // 1 quando alguma visita pediu para parar.
+} par_job;
+
+// Pedaço da árvore: nós de `first` até `last`, em ordem.
+typedef struct par_piece {
+  par_job *job;
+  void *first;
+  void *last;
+  void *acc;          // Parcial do pedaço (reduce).
+  unsigned int count; // Elementos visitados.
+} par_piece;
+
+// Lista de pedaços montada ao cortar a árvore.
+typedef struct par_plan {
+  par_piece *pieces;
+  size_t count;
+  int depth; // Profundidade do corte.
+} par_plan;
+
+// Uma parte do vetor a ordenar, ou um par de runs a juntar.
+typedef struct par_sort_task {
+  par_function_compare compare;
+  void **src;
+  void **dst;
+  size_t lo, mid, hi;
+} par_sort_task;
+
+// ======================================== //
+//         Implementações privadas.         //
+// ======================================== //
+
+// Prepara a operação sobre uma das árvores.
+static void par_job_init(par_job *job, rb_tree *rb, avl_tree *avl,
+                         int (*visit)(void *, void *),
+                         par_function_reduce reduce, void *ctx) {
+  job->rb = rb;
+  job->avl = avl;
+  job->visit = visit;
+  job->reduce = reduce;
+  job->ctx = ctx;
+  atomic_init(&job->stop, 0);
+}
+
+// Sucessor de um nó da árvore da operação (NULL no fim).
+static void *par_next(par_job *job, void *node) {
+  if (job->rb != NULL)
+    return rb_next(job->rb, (rb_node *)node);
+  return avl_next((avl_node *)node);
+}
+
+// Valor guardado em um nó da árvore da operação.
+static void *par_value(par_job *job, void *node) {
+  if (job->rb != NULL)
+    return ((rb_node *)node)->value;
+  return ((avl_node *)node)->value;
+}
+
+// Adiciona uma sub-árvore inteira (do menor ao maior nó) como novo pedaço.
+static void par_add_subtree(par_plan *plan, par_job *job, void *first,
+                            void *last) {
+  par_piece *piece = &plan->pieces[plan->count++];
+  piece->job = job;
+  piece->first = first;
+  piece->last = last;
+  piece->acc = NULL;
+  piece->count = 0;
+}
+
+// Adiciona um nó acima do corte: ele estende o pedaço anterior (é o sucessor
+// do último nó dele), ou começa o primeiro pedaço.
+static void par_add_node(par_plan *plan, par_job *job, void *node) {
+  if (plan->count == 0)
+    par_add_subtree(plan, job, node, node);
+  else
+    plan->pieces[plan->count - 1].last = node;
+}
+
+// Corta a sub-árvore Rubro-Negra na profundidade do plano, em ordem.
+static void par_collect_rb(par_plan *plan, par_job *job, rb_node *node,
+                           int depth) {
+  rb_tree *tree = job->rb;
+  if (node == tree->NIL)
+    return;
+
+  if (depth == plan->depth) {
+    rb_node *first = node, *last = node;
+    while (first->left != tree->NIL)
+      first = first->left;
+    while (last->right != tree->NIL)
+      last = last->right;
+    par_add_subtree(plan, job, first, last);
+    return;
+  }
+
+  par_collect_rb(plan, job, node->left, depth + 1);
+  par_add_node(plan, job, node);
+  par_collect_rb(plan, job, node->right, depth + 1);
+}
+
+// Corta a sub-árvore AVL na profundidade do plano, em ordem.
+static void par_collect_avl(par_plan *plan, par_job *job, avl_node *node,
+                            int depth) {
+  if (node == NULL)
+    return;
+
+  if (depth == plan->depth) {
+    avl_node *first = node, *last = node;
+    while (first->left != NULL)
+      first = first->left;
+    while (last->right != NULL)
+      last = last->right;
+    par_add_subtree(plan, job, first, last);
+    return;
+  }
+
+  par_collect_avl(plan, job, node->left, depth + 1);
+  par_add_node(plan, job, node);
+  par_collect_avl(plan, job, node->right, depth + 1);
+}
+
+// Monta os pedaços da árvore para as threads do pool. Retorna 0 se faltar
+// memória.
+static int par_plan_create(par_plan *plan, par_job *job, thread_pool *pool) {
+  size_t target = (size_t)tp_threads(pool) * PAR_PIECES_PER_THREAD;
+  plan->depth = 0;
+  while (((size_t)1 << plan->depth) < target && plan->depth < 24)
+    plan->depth++;
+
+  // Cada sub-árvore do corte gera um pedaço, e os nós acima dele também
+  // podem gerar um (os que vêm antes da primeira sub-árvore).
+  plan->count = 0;
+  plan->pieces = (par_piece *)malloc(((size_t)2 << plan->depth) *
+                                     sizeof(par_piece));
+  if (plan->pieces == NULL)
+    return 0;
+
+  if (job->rb != NULL)
+    par_collect_rb(plan, job, job->rb->root, 0);
+  else
+    par_collect_avl(plan, job, job->avl->root, 0);
+  return 1;
+}
+
+// Tarefa: percorre os nós de um pedaço pelo sucessor.
+static void par_run_piece(void *arg) {
+  par_piece *piece = (par_piece *)arg;
+  par_job *job = piece->job;
+  void *node = piece->first;
+
+  for (;;) {
+    void *value = par_value(job, node);
+    if (job->visit != NULL) {
+      if (atomic_load_explicit(&job->stop, memory_order_relaxed))
+        break;
+      piece->count++;
+      if (job->visit(value, job->ctx) == 0) {
+        atomic_store_explicit(&job->stop, 1, memory_order_relaxed);
+        break; // O visitante pediu para parar.
+      }
+    } else {
+      job->reduce(piece->acc, value, job->ctx);
+      piece->count++;
+    }
+
+    if (node == piece->last)
+      break;
+    node = par_next(job, node);
+  }
+}
+
+// Percorre a árvore inteira na thread atual.
+static unsigned int par_run_serial(par_job *job, void *first, void *result) {
+  unsigned int count = 0;
+  for (void *node = first; node != NULL; node = par_next(job, node)) {
+    count++;
+    if (job->visit != NULL) {
+      if (job->visit(par_value(job, node), job->ctx) == 0)
+        break; // O visitante pediu para parar.
+    } else {
+      job->reduce(result, par_value(job, node), job->ctx);
+    }
+  }
+  return count;
+}
+
+// Executa a operação: divide a árvore, distribui os pedaços pelo pool e
+// junta os parciais (reduce). Retorna quantos elementos foram visitados.
+static unsigned int par_run(par_job *job, thread_pool *pool, unsigned int size,
+                            void *first, void *result, size_t result_size,
+                            par_function_combine combine) {
+  if (first == NULL)
+    return 0;
+
+  par_plan plan;
+  if (pool == NULL || size < PAR_MIN_ELEMENTS ||
+      !par_plan_create(&plan, job, pool))
+    return par_run_serial(job, first, result);
+
+  char *accs = NULL;
+  if (job->reduce != NULL) {
+    accs = (char *)malloc(plan.count * result_size);
+    if (accs == NULL) {
+      free(plan.pieces);
+      return par_run_serial(job, first, result);
+    }
+    // Todos os parciais começam com o elemento neutro.
+    for (size_t i = 0; i < plan.count; i++) {
+      plan.pieces[i].acc = accs + i * result_size;
+      memcpy(plan.pieces[i].acc, result, result_size);
+    }
+  }
+
+  // Espera só pelos próprios pedaços: o pool pode estar rodando outras
+  // operações (ou esta pode ser uma tarefa dele).
+  tp_group group;
+  tp_group_init(&group);
+  for (size_t i = 0; i < plan.count; i++) {
+    if (!tp_submit_group(pool, &group, par_run_piece, &plan.pieces[i]))
+      par_run_piece(&plan.pieces[i]); // Sem memória para a tarefa.
+  }
+  tp_wait_group(pool, &group);
+
+  unsigned int count = 0;
+  for (size_t i = 0; i < plan.count; i++) {
+    count += plan.pieces[i].count;
+    if (accs != NULL)
+      combine(result, plan.pieces[i].acc, job->ctx);
+  }
+
+  free(accs);
+  free(plan.pieces);
+  return count;
+}
+
+// Junta os runs ordenados [lo, mid) e [mid, hi) de `src` em `dst`. Em caso
+// de empate o elemento do primeiro run vem antes (estável).
+static void par_merge(par_function_compare compare, void **src, void **dst,
+                      size_t lo, size_t mid, size_t hi) {
+  size_t i = lo, j = mid, k = lo;
+  while (i < mid && j < hi) {
+    if (compare(src[j], src[i]) < 0)
+      dst[k++] = src[j++];
+    else
+      dst[k++] = src[i++];
+  }
+  while (i < mid)
+    dst[k++] = src[i++];
+  while (j < hi)
+    dst[k++] = src[j++];
+}
+
+// Ordena `items[lo, hi)` (merge sort estável de baixo para cima), usando
+// `tmp[lo, hi)` como apoio. O resultado fica em `items`.
+static void par_sort_range(par_function_compare compare, void **items,
+                           void **tmp, size_t lo, size_t hi) {
+  // Runs pequenos ordenados por inserção.
+  for (size_t start = lo; start < hi; start += PAR_SORT_RUN) {
+    size_t end = (hi - start < PAR_SORT_RUN) ? hi : start + PAR_SORT_RUN;
+    for (size_t i = start + 1; i < end; i++) {
+      void *item = items[i];
+      size_t j = i;
+      while (j > start && compare(item, items[j - 1]) < 0) {
+        items[j] = items[j - 1];
+        j--;
+      }
+      items[j] = item;
+    }
+  }
+
+  void **src = items, **dst = tmp;
+  for (size_t width = PAR_SORT_RUN; width < hi - lo; width *= 2) {
+    for (size_t start = lo; start < hi; start += 2 * width) {
+      size_t mid = (hi - start < width) ? hi : start + width;
+      size_t end = (hi - mid < width) ? hi : mid + width;
+      par_merge(compare, src, dst, start, mid, end);
+    }
+    void **swap = src;
+    src = dst;
+    dst = swap;
+  }
+
+  if (src != items)
+    memcpy(items + lo, src + lo, (hi - lo) * sizeof(void *));
+}
+
+// Tarefa: ordena uma parte do vetor.
+static void par_sort_task_run(void *arg) {
+  par_sort_task *task = (par_sort_task *)arg;
+  par_sort_range(task->compare, task->src, task->dst, task->lo, task->hi);
+}
+
+// Tarefa: junta dois runs vizinhos.
+static void par_merge_task_run(void *arg) {
+  par_sort_task *task = (par_sort_task *)arg;
+  par_merge(task->compare, task->src, task->dst, task->lo, task->mid,
+            task->hi);
+}
+
+// Envia a tarefa ao pool no grupo da ordenação (ou a executa, se faltar
+// memória para a fila).
+static void par_submit(thread_pool *pool, tp_group *group,
+                       tp_function_task function, par_sort_task *task) {
+  if (!tp_submit_group(pool, group, function, task))
+    function(task);
+}
+
+// Ordena os ponteiros em paralelo: cada thread ordena uma parte, e os runs
+// são juntados dois a dois (também em paralelo) até sobrar um. Retorna 0 se
+// faltar memória.
+static int par_sort(thread_pool *pool, par_function_compare compare,
+                    void **items, size_t count) {
+  void **tmp = (void **)malloc(count * sizeof(void *));
+  if (tmp == NULL)
+    return 0;
+
+  size_t parts = 1;
+  if (pool != NULL && count >= PAR_SORT_MIN_ELEMENTS)
+    parts = tp_threads(pool);
+
+  par_sort_task *tasks =
+      (par_sort_task *)malloc(parts * sizeof(par_sort_task));
+  size_t *bounds = (size_t *)malloc((parts + 1) * sizeof(size_t));
+  if (tasks == NULL || bounds == NULL) {
+    free(tasks);
+    free(bounds);
+    free(tmp);
+    return 0;
+  }
+
+  for (size_t i = 0; i <= parts; i++)
+    bounds[i] = count * i / parts;
+
+  if (parts == 1) {
+    par_sort_range(compare, items, tmp, 0, count);
+  } else {
+    tp_group group;
+    tp_group_init(&group);
+    for (size_t i = 0; i < parts; i++) {
+      tasks[i] = (par_sort_task){compare, items, tmp, bounds[i], 0,
+                                 bounds[i + 1]};
+      par_submit(pool, &group, par_sort_task_run, &tasks[i]);
+    }
+    tp_wait_group(pool, &group);
+
+    // Cada passada junta os runs (bounds[i], bounds[i + step]) e
+    // (bounds[i + step], bounds[i + 2 step]) de `src` em `dst`.
+    void **src = items, **dst = tmp;
+    for (size_t step = 1; step < parts; step *= 2) {
+      size_t n = 0;
+      for (size_t i = 0; i < parts; i += 2 * step) {
+        size_t mid = (i + step < parts) ? bounds[i + step] : count;
+        size_t hi = (i + 2 * step < parts) ? bounds[i + 2 * step] : count;
+        tasks[n] = (par_sort_task){compare, src, dst, bounds[i], mid, hi};
+        par_submit(pool, &group, par_merge_task_run, &tasks[n]);
+        n++;
+      }
+      tp_wait_group(pool, &group);
+      void **swap = src;
+      src = dst;
+      dst = swap;
+    }
+    if (src != items)
+      memcpy(items, src, count * sizeof(void *));
+  }
+
+  free(bounds);
+  free(tasks);
+  free(tmp);
+  return 1;
+}
+
+// Ordena os elementos e copia os distintos (a primeira ocorrência) em ordem
+// para um novo vetor. Retorna o vetor (NULL se faltar memória) e a quantidade
+// em `unique`.
+static char *par_sort_unique(thread_pool *pool, par_function_compare compare,
+                             const void *values, size_t count, size_t stride,
+                             size_t *unique) {
+  void **items = (void **)malloc(count * sizeof(void *));
+  char *sorted = (char *)malloc(count * stride);
+  if (items == NULL || sorted == NULL) {
+    free(items);
+    free(sorted);
+    return NULL;
+  }
+
+  for (size_t i = 0; i < count; i++)
+    items[i] = (char *)values + i * stride;
+
+  if (!par_sort(pool, compare, items, count)) {
+    free(items);
+    free(sorted);
+    return NULL;
+  }
+
+  size_t n = 0;
+  for (size_t i = 0; i < count; i++) {
+    if (n > 0 && compare(items[i], items[i - 1]) == 0)
+      continue; // Duplicata: o elemento anterior veio antes no vetor.
+    memcpy(sorted + n * stride, items[i], stride);
+    n++;
+  }
+
+  free(items);
+  *unique = n;
+  return sorted;
+}
+
+// Tarefas que destroem as árvores separadas por `*_clear_async`.
+static void par_destroy_rb_task(void *arg) { rb_destroy_tree((rb_tree *)arg); }
+
+static void par_destroy_avl_task(void *arg) {
+  avl_destroy_tree((avl_tree *)arg);
+}
+
+// ======================================== //
+//         Implementações publicas.         //
+// ======================================== //
+
+unsigned int rb_parallel_for_each(rb_tree *tree, thread_pool *pool,
+                                  rb_function_visit visit, void *ctx) {
+  if (tree == NULL)
+    return 0;
+
+  par_job job;
+  par_job_init(&job, tree, NULL, visit, NULL, ctx);
+  return par_run(&job, pool, tree->size, rb_first(tree), NULL, 0, NULL);
+}
+
+unsigned int avl_parallel_for_each(avl_tree *tree, thread_pool *pool,
+                                   avl_function_visit visit, void *ctx) {
+  if (tree == NULL)
+    return 0;
+
+  par_job job;
+  par_job_init(&job, NULL, tree, visit, NULL, ctx);
+  return par_run(&job, pool, tree->size, avl_first(tree), NULL, 0, NULL);
+}
+
+void rb_parallel_reduce(rb_tree *tree, thread_pool *pool, void *result,
+                        size_t result_size, par_function_reduce reduce,
+                        par_function_combine combine, void *ctx) {
+  if (tree == NULL)
+    return;
+
+  par_job job;
+  par_job_init(&job, tree, NULL, NULL, reduce, ctx);
+  par_run(&job, pool, tree->size, rb_first(tree), result, result_size,
+          combine);
+}
+
+void avl_parallel_reduce(avl_tree *tree, thread_pool *pool, void *result,
+                         size_t result_size, par_function_reduce reduce,
+                         par_function_combine combine, void *ctx) {
+  if (tree == NULL)
+    return;
+
+  par_job job;
+  par_job_init(&job, NULL, tree, NULL, reduce, ctx);
+  par_run(&job, pool, tree->size, avl_first(tree), result, result_size,
+          combine);
+}
+
+int rb_parallel_build(rb_tree *tree, thread_pool *pool, const void *values,
+                      size_t count, size_t stride) {
+  if (tree == NULL || tree->root != tree->NIL)
+    return 0;
+
+  size_t unique;
+  char *sorted = par_sort_unique(pool, tree->function_compare, values, count,
+                                 stride, &unique);
+  if (sorted == NULL)
+    return count == 0;
+
+  int built = rb_build_sorted(tree, sorted, unique, stride);
+  free(sorted);
+  return built;
+}
+
+int avl_parallel_build(avl_tree *tree, thread_pool *pool, const void *values,
+                       size_t count, size_t stride) {
+  if (tree == NULL || tree->root != NULL)
+    return 0;
+
+  size_t unique;
+  char *sorted = par_sort_unique(pool, tree->function_compare, values, count,
+                                 stride, &unique);
+  if (sorted == NULL)
+    return count == 0;
+
+  int built = avl_build_sorted(tree, sorted, unique, stride);
+  free(sorted);
+  return built;
+}
+
+void rb_clear_async(rb_tree *tree, thread_pool *pool) {
+  if (tree == NULL || tree->size == 0)
+    return;
+  if (pool == NULL) {
+    rb_clear(tree);
+    return;
+  }
+
+  // Sem memória para a tarefa a árvore separada é destruída aqui mesmo.
+  rb_tree *detached = rb_detach(tree);
+  if (!tp_submit(pool, par_destroy_rb_task, detached))
+    rb_destroy_tree(detached);
+}
+
+void avl_clear_async(avl_tree *tree, thread_pool *pool) {
+  if (tree == NULL || tree->size == 0)
+    return;
+  if (pool == NULL) {
+    avl_clear(tree);
+    return;
+  }
+
+  avl_tree *detached = avl_detach(tree);
+  if (!tp_submit(pool, par_destroy_avl_task, detached))
+    avl_destroy_tree(detached);
+}
@@ -0,0 +1,496 @@
+#include <pavltree.h>
+
+#include <stdlib.h>
+#include <string.h>
+
+// `current` guarda o ponteiro da versão atual nos 48 bits baixos e a contagem
+// de snapshots em andamento nos 16 altos.
+#define PAVL_PTR_MASK ((UINT64_C(1) << 48) - 1)
+#define PAVL_REF_ONE (UINT64_C(1) << 48)
+#define PAVL_VERSION(c) ((pavl_version *)(uintptr_t)((c) & PAVL_PTR_MASK))
+
+// ======================================== //
+//         Implementações privadas.         //
+// ======================================== //
+
+static int pavl_height(pavl_node *node) {
+  return (node != NULL) ? node->height : 0;
+}
+
+static void pavl_update_height(pavl_node *node) {
+  int hl = pavl_height(node->left);
+  int hr = pavl_height(node->right);
+  node->height = 1 + ((hl > hr) ? hl : hr);
+}
+
+static int pavl_factor(pavl_node *node) {
+  return pavl_height(node->left) - pavl_height(node->right);
+}
+
+// Aloca um nó da operação atual, sem filhos e sem elemento.
+static pavl_node *pavl_alloc_node(pavl_tree *tree, int height) {
+  pavl_node *node = (pavl_node *)malloc(sizeof(pavl_node) + tree->value_size);
+  if (node == NULL)
+    return NULL;
+
+  node->value = NULL;
+  node->left = NULL;
+  node->right = NULL;
+  node->box = NULL;
+  node->stamp = tree->stamp;
+  node->height = height;
+  atomic_init(&node->refs, 1);
+  return node;
+}
+
+// Cria uma folha com uma cópia de `value`.
+static pavl_node *pavl_create_node(pavl_tree *tree, void *value) {
+  pavl_node *node = pavl_alloc_node(tree, 1);
+  if (node == NULL)
+    return NULL;
+
+  if (tree->value_size > 0) {
+    node->value = (void *)(node + 1);
+    memcpy(node->value, value, tree->value_size);
+    return node;
+  }
+
+  pavl_value *box = (pavl_value *)malloc(sizeof(pavl_value));
+  if (box == NULL) {
+    free(node);
+    return NULL;
+  }
+  box->value = tree->function_copy(value);
+  atomic_init(&box->refs, 1);
+  node->box = box;
+  node->value = box->value;
+  return node;
+}
+
+// Cria uma cópia de `node` para a operação atual, com o mesmo elemento e sem
+// filhos (o chamador os define).
+static pavl_node *pavl_copy_node(pavl_tree *tree, pavl_node *node) {
+  pavl_node *copy = pavl_alloc_node(tree, node->height);
+  if (copy == NULL)
+    return NULL;
+
+  if (tree->value_size > 0) {
+    copy->value = (void *)(copy + 1);
+    memcpy(copy->value, node->value, tree->value_size);
+  } else {
+    atomic_fetch_add_explicit(&node->box->refs, 1, memory_order_relaxed);
+    copy->box = node->box;
+    copy->value = node->value;
+  }
+  return copy;
+}
+
+// Conta uma referência nova para o nó.
+static pavl_node *pavl_retain(pavl_node *node) {
+  if (node != NULL)
+    atomic_fetch_add_explicit(&node->refs, 1, memory_order_relaxed);
+  return node;
+}
+
+// Solta uma referência do nó. O último dono libera o nó (e o elemento, se
+// nenhuma cópia do nó o usa) e solta as referências dos filhos.
+static void pavl_release(pavl_tree *tree, pavl_node *node) {
+  while (node != NULL) {
+    if (atomic_fetch_sub_explicit(&node->refs, 1, memory_order_acq_rel) != 1)
+      return;
+
+    pavl_node *right = node->right;
+    pavl_release(tree, node->left);
+
+    pavl_value *box = node->box;
+    if (box != NULL &&
+        atomic_fetch_sub_explicit(&box->refs, 1, memory_order_acq_rel) == 1) {
+      if (tree->function_destroy != NULL)
+        tree->function_destroy(box->value);
+      free(box);
+    }
+    free(node);
+
+    // O filho direito é tratado no laço (a recursão fica só na esquerda).
+    node = right;
+  }
+}
+
+// Garante que o nó em `*slot` (filho de um nó da operação atual) possa ser
+// alterado, trocando-o por uma cópia se ele pertence a outras versões.
+static int pavl_own(pavl_tree *tree, pavl_node **slot) {
+  pavl_node *node = *slot;
+  if (node == NULL || node->stamp == tree->stamp)
+    return 1;
+
+  pavl_node *copy = pavl_copy_node(tree, node);
+  if (copy == NULL)
+    return 0;
+  copy->left = pavl_retain(node->left);
+  copy->right = pavl_retain(node->right);
+  *slot = copy;
+  pavl_release(tree, node);
+  return 1;
+}
+
+// Rotações de um nó da operação atual. O filho que sobe é copiado se for
+// compartilhado; sem memória para a cópia a rotação não é feita (a árvore
+// continua correta, apenas menos balanceada).
+static pavl_node *pavl_rotate_right(pavl_tree *tree, pavl_node *a) {
+  if (!pavl_own(tree, &a->left))
+    return a;
+
+  pavl_node *b = a->left;
+  a->left = b->right;
+  b->right = a;
+  pavl_update_height(a);
+  pavl_update_height(b);
+  return b;
+}
+
+static pavl_node *pavl_rotate_left(pavl_tree *tree, pavl_node *a) {
+  if (!pavl_own(tree, &a->right))
+    return a;
+
+  pavl_node *b = a->right;
+  a->right = b->left;
+  b->left = a;
+  pavl_update_height(a);
+  pavl_update_height(b);
+  return b;
+}
+
+// Rebalanceia um nó da operação atual e retorna a nova raiz da sub-árvore.
+static pavl_node *pavl_balance(pavl_tree *tree, pavl_node *node) {
+  pavl_update_height(node);
+  int factor = pavl_factor(node);
+
+  if (factor > 1) {
+    if (pavl_factor(node->left) < 0 && pavl_own(tree, &node->left))
+      node->left = pavl_rotate_left(tree, node->left);
+    return pavl_rotate_right(tree, node);
+  }
+  if (factor < -1) {
+    if (pavl_factor(node->right) > 0 && pavl_own(tree, &node->right))
+      node->right = pavl_rotate_right(tree, node->right);
+    return pavl_rotate_left(tree, node);
+  }
+  return node;
+}
+
+// Cria em `*out` a nova versão de `node` com os filhos `left` e `right` (com
+// as referências já contadas), rebalanceada. Sem memória solta os filhos.
+static int pavl_rebuild(pavl_tree *tree, pavl_node *node, pavl_node *left,
+                        pavl_node *right, pavl_node **out) {
+  pavl_node *copy = pavl_copy_node(tree, node);
+  if (copy == NULL) {
+    pavl_release(tree, left);
+    pavl_release(tree, right);
+    return -1;
+  }
+
+  copy->left = left;
+  copy->right = right;
+  *out = pavl_balance(tree, copy);
+  return 1;
+}
+
+// Insere `value` na sub-árvore `node` e guarda em `*out` a nova versão dela.
+// Retorna 1 se inseriu, 0 se o elemento já existia e -1 se faltou memória.
+static int pavl_insert_rec(pavl_tree *tree, pavl_node *node, void *value,
+                           pavl_node **out) {
+  if (node == NULL) {
+    *out = pavl_create_node(tree, value);
+    return (*out != NULL) ? 1 : -1;
+  }
+
+  int cmp = tree->function_compare(value, node->value);
+  if (cmp == 0)
+    return 0;
+
+  pavl_node *child;
+  int status = pavl_insert_rec(tree, (cmp < 0) ? node->left : node->right,
+                               value, &child);
+  if (status != 1)
+    return status;
+
+  if (cmp < 0)
+    return pavl_rebuild(tree, node, child, pavl_retain(node->right), out);
+  return pavl_rebuild(tree, node, pavl_retain(node->left), child, out);
+}
+
+// Remove o menor elemento da sub-árvore `node` (não vazia) e guarda em `*out`
+// a nova versão dela. `*min` recebe uma cópia, sem filhos, do nó removido.
+static int pavl_remove_min(pavl_tree *tree, pavl_node *node, pavl_node **out,
+                           pavl_node **min) {
+  if (node->left == NULL) {
+    *min = pavl_copy_node(tree, node);
+    if (*min == NULL)
+      return -1;
+    *out = pavl_retain(node->right);
+    return 1;
+  }
+
+  pavl_node *left;
+  if (pavl_remove_min(tree, node->left, &left, min) != 1)
+    return -1;
+  return pavl_rebuild(tree, node, left, pavl_retain(node->right), out);
+}
+
+// Remove `value` da sub-árvore `node` e guarda em `*out` a nova versão dela.
+// Retorna 1 se removeu, 0 se o elemento não existe e -1 se faltou memória.
+static int pavl_remove_rec(pavl_tree *tree, pavl_node *node, void *value,
+                           pavl_node **out) {
+  if (node == NULL)
+    return 0;
+
+  int cmp = tree->function_compare(value, node->value);
+  pavl_node *child;
+  if (cmp < 0) {
+    int status = pavl_remove_rec(tree, node->left, value, &child);
+    if (status != 1)
+      return status;
+    return pavl_rebuild(tree, node, child, pavl_retain(node->right), out);
+  }
+  if (cmp > 0) {
+    int status = pavl_remove_rec(tree, node->right, value, &child);
+    if (status != 1)
+      return status;
+    return pavl_rebuild(tree, node, pavl_retain(node->left), child, out);
+  }
+
+  // O nó some da nova versão; o elemento continua nas versões anteriores.
+  if (node->left == NULL) {
+    *out = pavl_retain(node->right);
+    return 1;
+  }
+  if (node->right == NULL) {
+    *out = pavl_retain(node->left);
+    return 1;
+  }
+
+  // Dois filhos: o sucessor toma o lugar do nó.
+  pavl_node *min = NULL;
+  if (pavl_remove_min(tree, node->right, &child, &min) != 1) {
+    pavl_release(tree, min);
+    return -1;
+  }
+  min->left = pavl_retain(node->left);
+  min->right = child;
+  *out = pavl_balance(tree, min);
+  return 1;
+}
+
+// Busca `value` na sub-árvore `node`.
+static void *pavl_find(pavl_tree *tree, pavl_node *node, void *value) {
+  while (node != NULL) {
+    int cmp = tree->function_compare(value, node->value);
+    if (cmp == 0)
+      return node->value;
+    node = (cmp < 0) ? node->left : node->right;
+  }
+  return NULL;
+}
+
+// Visita em ordem os elementos de `node` em [lo, hi). Retorna 0 se a visita
+// foi interrompida.
+static int pavl_range_rec(pavl_tree *tree, pavl_node *node, void *lo,
+                          void *hi, pavl_function_visit visit, void *ctx,
+                          unsigned int *count) {
+  while (node != NULL) {
+    if (lo != NULL && tree->function_compare(node->value, lo) < 0) {
+      node = node->right;
+      continue;
+    }
+    if (!pavl_range_rec(tree, node->left, lo, hi, visit, ctx, count))
+      return 0;
+    if (hi != NULL && tree->function_compare(node->value, hi) >= 0)
+      return 1;
+
+    (*count)++;
+    if (visit(node->value, ctx) == 0)
+      return 0;
+
+    // Toda a sub-árvore direita já é maior ou igual a `lo`.
+    lo = NULL;
+    node = node->right;
+  }
+  return 1;
+}
+
+static pavl_version *pavl_create_version(pavl_tree *tree, pavl_node *root,
+                                         unsigned int size) {
+  pavl_version *version = (pavl_version *)malloc(sizeof(pavl_version));
+  if (version == NULL)
+    return NULL;
+
+  version->root = root;
+  version->size = size;
+  atomic_init(&version->refs, 1);
+  version->tree = tree;
+  return version;
+}
+
+static void pavl_release_version(pavl_version *version) {
+  if (atomic_fetch_sub_explicit(&version->refs, 1, memory_order_acq_rel) == 1) {
+    pavl_release(version->tree, version->root);
+    free(version);
+  }
+}
+
+// Versão atual, lida pelo escritor (só ele troca o ponteiro).
+static pavl_version *pavl_current(pavl_tree *tree) {
+  return PAVL_VERSION(
+      atomic_load_explicit(&tree->current, memory_order_relaxed));
+}
+
+// Publica a nova versão com a raiz `root` (referência já contada) e solta a
+// referência da árvore à anterior. Os snapshots em andamento na anterior
+// passam a ser contados nela própria.
+static int pavl_commit(pavl_tree *tree, pavl_node *root, unsigned int size) {
+  pavl_version *version = pavl_create_version(tree, root, size);
+  if (version == NULL) {
+    pavl_release(tree, root);
+    return 0;
+  }
+
+  uint64_t old = atomic_exchange_explicit(
+      &tree->current, (uint64_t)(uintptr_t)version, memory_order_acq_rel);
+  pavl_version *prev = PAVL_VERSION(old);
+  unsigned int pending = (unsigned int)(old >> 48);
+  if (pending > 0)
+    atomic_fetch_add_explicit(&prev->refs, pending, memory_order_relaxed);
+  pavl_release_version(prev);
+  return 1;
+}
+
+// ======================================== //
+//         Implementações publicas.         //
+// ======================================== //
+
+pavl_tree *pavl_create_tree(pavl_function_compare compare,
+                            pavl_function_copy copy,
+                            pavl_function_destroy destroy) {
+  pavl_tree *tree = (pavl_tree *)malloc(sizeof(pavl_tree));
+  if (tree == NULL)
+    return NULL;
+
+  tree->stamp = 0;
+  tree->value_size = 0;
+  tree->function_compare = compare;
+  tree->function_copy = copy;
+  tree->function_destroy = destroy;
+
+  pavl_version *empty = pavl_create_version(tree, NULL, 0);
+  if (empty == NULL) {
+    free(tree);
+    return NULL;
+  }
+  atomic_init(&tree->current, (uint64_t)(uintptr_t)empty);
+  return tree;
+}
+
+pavl_tree *pavl_create_tree_inline(pavl_function_compare compare,
+                                   size_t value_size) {
+  pavl_tree *tree = pavl_create_tree(compare, NULL, NULL);
+  if (tree != NULL)
+    tree->value_size = value_size;
+  return tree;
+}
+
+void pavl_destroy_tree(pavl_tree *tree) {
+  if (tree == NULL)
+    return;
+
+  pavl_release_version(pavl_current(tree));
+  free(tree);
+}
+
+int pavl_insert(pavl_tree *tree, void *value) {
+  if (tree == NULL)
+    return 0;
+
+  pavl_version *current = pavl_current(tree);
+  pavl_node *root;
+  tree->stamp++;
+  if (pavl_insert_rec(tree, current->root, value, &root) != 1)
+    return 0;
+  return pavl_commit(tree, root, current->size + 1);
+}
+
+int pavl_remove(pavl_tree *tree, void *value) {
+  if (tree == NULL)
+    return 0;
+
+  pavl_version *current = pavl_current(tree);
+  pavl_node *root;
+  tree->stamp++;
+  if (pavl_remove_rec(tree, current->root, value, &root) != 1)
+    return 0;
+  return pavl_commit(tree, root, current->size - 1);
+}
+
+void *pavl_search(pavl_tree *tree, void *value) {
+  if (tree == NULL)
+    return NULL;
+  return pavl_find(tree, pavl_current(tree)->root, value);
+}
+
+unsigned int pavl_size(pavl_tree *tree) {
+  if (tree != NULL)
+    return pavl_current(tree)->size;
+  return 0;
+}
+
+pavl_snapshot *pavl_snapshot_take(pavl_tree *tree) {
+  if (tree == NULL)
+    return NULL;
+
+  // Anuncia o snapshot em `current` (a versão não pode ser liberada enquanto
+  // a contagem estiver lá), conta a referência na versão e retira o anúncio.
+  uint64_t cur = atomic_fetch_add_explicit(&tree->current, PAVL_REF_ONE,
+                                           memory_order_acquire) +
+                 PAVL_REF_ONE;
+  pavl_version *version = PAVL_VERSION(cur);
+  atomic_fetch_add_explicit(&version->refs, 1, memory_order_relaxed);
+
+  for (;;) {
+    if (PAVL_VERSION(cur) != version) {
+      // O escritor publicou outra versão e já transferiu o anúncio para a
+      // contagem desta: uma das duas referências sobra.
+      atomic_fetch_sub_explicit(&version->refs, 1, memory_order_relaxed);
+      break;
+    }
+    if (atomic_compare_exchange_weak_explicit(&tree->current, &cur,
+                                              cur - PAVL_REF_ONE,
+                                              memory_order_relaxed,
+                                              memory_order_relaxed))
+      break;
+  }
+  return version;
+}
+
+void pavl_snapshot_release(pavl_snapshot *snapshot) {
+  if (snapshot != NULL)
+    pavl_release_version(snapshot);
+}
+
+void *pavl_snapshot_search(pavl_snapshot *snapshot, void *value) {
+  if (snapshot == NULL)
+    return NULL;
+  return pavl_find(snapshot->tree, snapshot->root, value);
+}
+
+unsigned int pavl_snapshot_size(pavl_snapshot *snapshot) {
+  if (snapshot != NULL)
+    return snapshot->size;
+  return 0;
+}
+
+unsigned int pavl_snapshot_range(pavl_snapshot *snapshot, void *lo, void *hi,
+                                 pavl_function_visit visit, void *ctx) {
+  unsigned int count = 0;
+  if (snapshot != NULL)
+    pavl_range_rec(snapshot->tree, snapshot->root, lo, hi, visit, ctx, &count);
+  return count;
+}
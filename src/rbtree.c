@@ -1,11 +1,111 @@
 #include <rbtree.h>
 
+#include <limits.h>
+#include <stdint.h>
 #include <stdlib.h>
+#include <string.h>
+
+// Busca antecipada (prefetch) de uma linha de cache, quando disponível.
+#if defined(__GNUC__) || defined(__clang__)
+#define RB_PREFETCH(addr) __builtin_prefetch(addr)
+#else
+#define RB_PREFETCH(addr) ((void)(addr))
+#endif
+
+// Quantidade de buscas intercaladas por grupo em `rb_search_many`.
+#define RB_BATCH_GROUP 16
+
+// Contadores de instrumentação (somente com COLLECTIONS_STATS).
+#ifdef COLLECTIONS_STATS
+#define RB_STAT(tree, field) ((tree)->stats.field++)
+#define RB_STAT_ADD(tree, field, n) ((tree)->stats.field += (n))
+#define RB_STAT_SEARCH(tree, depth)                                            \
+  ((tree)->stats.searches++,                                                   \
+   (tree)->stats.search_depth[(depth) < RB_STATS_DEPTHS ? (depth)              \
+                                                        : RB_STATS_DEPTHS - 1]++)
+#else
+#define RB_STAT(tree, field) ((void)(tree))
+#define RB_STAT_ADD(tree, field, n) ((void)(tree))
+#define RB_STAT_SEARCH(tree, depth) ((void)(depth))
+#endif
+
+// Chama a função de comparação da árvore, contando a chamada.
+#define RB_COMPARE(tree, a, b)                                                 \
+  (RB_STAT(tree, compares), (tree)->function_compare(a, b))
+
+// Acesso ao pai, à cor e ao tamanho da sub-árvore dos nós. No layout compacto
+// (COLLECTIONS_COMPACT_NODES) a cor fica no bit menos significativo do
+// ponteiro do pai, e o tamanho da sub-árvore fica logo após o nó, em um
+// espaço que só existe nas árvores com RB_OPT_ORDER_STAT.
+#ifdef COLLECTIONS_COMPACT_NODES
+#define RB_PARENT(n) ((rb_node *)((n)->parent_color & ~(uintptr_t)1))
+#define RB_COLOR(n) ((int)((n)->parent_color & 1))
+#define RB_SET_PARENT(n, p)                                                    \
+  ((n)->parent_color = (uintptr_t)(p) | ((n)->parent_color & 1))
+#define RB_SET_COLOR(n, c)                                                     \
+  ((n)->parent_color = ((n)->parent_color & ~(uintptr_t)1) | (uintptr_t)(c))
+#define RB_COUNT(n) (*(unsigned int *)((n) + 1))
+#define RB_COUNT_BYTES(tree)                                                   \
+  (((tree)->options & RB_OPT_ORDER_STAT) ? sizeof(uint64_t) : 0)
+#define RB_SET_COUNT(tree, n, c)                                               \
+  (((tree)->options & RB_OPT_ORDER_STAT) ? (void)(RB_COUNT(n) = (c)) : (void)0)
+#else
+#define RB_PARENT(n) ((n)->parent)
+#define RB_COLOR(n) ((n)->color)
+#define RB_SET_PARENT(n, p) ((n)->parent = (p))
+#define RB_SET_COLOR(n, c) ((n)->color = (c))
+#define RB_COUNT(n) ((n)->count)
+#define RB_COUNT_BYTES(tree) ((size_t)0)
+#define RB_SET_COUNT(tree, n, c) ((n)->count = (c))
+#endif
+
+// Opção interna das arvores de intervalos (rb_create_interval*). Os
+// construtores publicos a removem das opções recebidas, pois uma arvore com
+// ela e sem `function_interval` falharia na primeira inserção.
+#define RB_OPT_INTERVAL 0x100
+
+// Maior fim de intervalo da sub-árvore, guardado após o nó (e após o tamanho
+// da sub-árvore, no layout compacto) só nas arvores de intervalos. O do
+// sentinela é INT64_MIN.
+#define RB_INTERVAL_BYTES(tree)                                                \
+  (((tree)->options & RB_OPT_INTERVAL) ? sizeof(int64_t) : 0)
+#define RB_MAX_END(tree, n)                                                    \
+  (*(int64_t *)((char *)((n) + 1) + RB_COUNT_BYTES(tree)))
+
+// Bytes entre o nó e o valor inline.
+#define RB_EXTRA_BYTES(tree) (RB_COUNT_BYTES(tree) + RB_INTERVAL_BYTES(tree))
 
 // ======================================== //
 //         Implementações privadas.         //
 // ======================================== //
 
+// Fim do intervalo do elemento do nó (arvores de intervalos).
+static int64_t rb_interval_end(rb_tree *tree, rb_node *node) {
+  int64_t start, end;
+  tree->function_interval(node->value, &start, &end);
+  return end;
+}
+
+// Recalcula o maior fim de intervalo da sub-árvore de `node` a partir dos
+// filhos. (Somente nas arvores de intervalos).
+static void rb_update_max_end(rb_tree *tree, rb_node *node) {
+  int64_t end = rb_interval_end(tree, node);
+  if (RB_MAX_END(tree, node->left) > end)
+    end = RB_MAX_END(tree, node->left);
+  if (RB_MAX_END(tree, node->right) > end)
+    end = RB_MAX_END(tree, node->right);
+  RB_MAX_END(tree, node) = end;
+}
+
+// Após uma rotação `top` ocupa o lugar de `low` e herda o seu maior fim (a
+// sub-árvore tem os mesmos nós); o de `low` é recalculado.
+static void rb_rotate_max_end(rb_tree *tree, rb_node *top, rb_node *low) {
+  if (!(tree->options & RB_OPT_INTERVAL))
+    return;
+  RB_MAX_END(tree, top) = RB_MAX_END(tree, low);
+  rb_update_max_end(tree, low);
+}
+
 /* Rotaçao a esquerda no nó x.
 - Vizualização da rotação:
         y            x
@@ -15,47 +115,58 @@
     T1  T2           T2  T3
 */
 static void rb_rotate_left(rb_tree *tree, rb_node *x) {
+  RB_STAT(tree, rotations_left);
   rb_node *y = x->right; // y é o filho direito de x.
   x->right =
       y->left; // A sub-árvore esquerda de y vira a sub-árvore direita de x.
 
   if (y->left != tree->NIL)
-    y->left->parent = x; // Atualiza o pai da sub-árvore movida.
+    RB_SET_PARENT(y->left, x); // Atualiza o pai da sub-árvore movida.
 
-  y->parent = x->parent; // O pai de y se torna o pai de x.
+  RB_SET_PARENT(y, RB_PARENT(x)); // O pai de y se torna o pai de x.
 
   // Conecta o antigo pai de x a y.
-  if (x->parent == tree->NIL) {
+  if (RB_PARENT(x) == tree->NIL) {
     tree->root = y;
-  } else if (x == x->parent->left) {
-    x->parent->left = y;
+  } else if (x == RB_PARENT(x)->left) {
+    RB_PARENT(x)->left = y;
   } else {
-    x->parent->right = y;
+    RB_PARENT(x)->right = y;
   }
 
   y->left = x;   // x se torna filho esquerdo de y.
-  x->parent = y; // E o pai de x agora é y.
+  RB_SET_PARENT(x, y); // E o pai de x agora é y.
+
+  // y assume a sub-árvore inteira de x, e x perde a sub-árvore direita de y.
+  RB_SET_COUNT(tree, y, RB_COUNT(x));
+  RB_SET_COUNT(tree, x, RB_COUNT(x->left) + RB_COUNT(x->right) + 1);
+  rb_rotate_max_end(tree, y, x);
 }
 
 // Rotaçao a direita no nó y (o contrario da rotação à esquerda).
 static void rb_rotate_right(rb_tree *tree, rb_node *y) {
+  RB_STAT(tree, rotations_right);
   rb_node *x = y->left;
   y->left = x->right;
 
   if (x->right != tree->NIL)
-    x->right->parent = y;
+    RB_SET_PARENT(x->right, y);
 
-  x->parent = y->parent;
+  RB_SET_PARENT(x, RB_PARENT(y));
 
-  if (y->parent == tree->NIL)
+  if (RB_PARENT(y) == tree->NIL)
     tree->root = x;
-  else if (y == y->parent->right)
-    y->parent->right = x;
+  else if (y == RB_PARENT(y)->right)
+    RB_PARENT(y)->right = x;
   else
-    y->parent->left = x;
+    RB_PARENT(y)->left = x;
 
   x->right = y;
-  y->parent = x;
+  RB_SET_PARENT(y, x);
+
+  RB_SET_COUNT(tree, x, RB_COUNT(y));
+  RB_SET_COUNT(tree, y, RB_COUNT(y->left) + RB_COUNT(y->right) + 1);
+  rb_rotate_max_end(tree, x, y);
 }
 
 // Encontra o nó com o menor valor em uma sub-árvore.
@@ -66,181 +177,962 @@ static rb_node *rb_minimum(rb_tree *tree, rb_node *node) {
   return node;
 }
 
+// Encontra o nó com o maior valor em uma sub-árvore.
+static rb_node *rb_maximum(rb_tree *tree, rb_node *node) {
+  while (node->right != tree->NIL) {
+    node = node->right;
+  }
+  return node;
+}
+
 // Busca por um nó com um valor especificado.
 static rb_node *rb_find_node(rb_tree *tree, rb_node *node, void *value) {
+  unsigned int depth = 0; // Nós visitados (histograma das estatísticas).
   while (node != tree->NIL) {
-    int cmp = tree->function_compare(value, node->value);
+    depth++;
+    int cmp = RB_COMPARE(tree, value, node->value);
     if (cmp < 0) {
       node = node->left;
     } else if (cmp > 0) {
       node = node->right;
     } else {
+      RB_STAT_SEARCH(tree, depth);
       return node; // Encontrado.
     }
   }
+  RB_STAT_SEARCH(tree, depth);
   return tree->NIL; // Não encontrado.
 }
 
+// Recalcula o tamanho e o maior fim de intervalo da sub-árvore do nó a
+// partir dos filhos.
+static void rb_update_node(rb_tree *tree, rb_node *node) {
+  RB_SET_COUNT(tree, node, RB_COUNT(node->left) + RB_COUNT(node->right) + 1);
+  if (tree->options & RB_OPT_INTERVAL)
+    rb_update_max_end(tree, node);
+}
+
+// Recalcula o tamanho das sub-árvores (e o maior fim de intervalo) de `node`
+// até a raiz, após uma mudança estrutural abaixo de `node`. (Somente com
+// RB_OPT_ORDER_STAT ou nas arvores de intervalos).
+static void rb_update_path(rb_tree *tree, rb_node *node) {
+  if (!(tree->options & (RB_OPT_ORDER_STAT | RB_OPT_INTERVAL)))
+    return;
+  while (node != tree->NIL) {
+    rb_update_node(tree, node);
+    node = RB_PARENT(node);
+  }
+}
+
 // Função auxiliar que substitui a sub-árvore `u` pela sub-árvore `v`.
+// O tamanho das sub-árvores acima de `u` é corrigido depois, com
+// `rb_update_path`, a partir do nó mais baixo alterado pela remoção.
 static void rb_transplant(rb_tree *tree, rb_node *u, rb_node *v) {
-  if (u->parent == tree->NIL)
+  if (RB_PARENT(u) == tree->NIL)
     tree->root = v;
-  else if (u == u->parent->left)
-    u->parent->left = v;
+  else if (u == RB_PARENT(u)->left)
+    RB_PARENT(u)->left = v;
   else
-    u->parent->right = v;
+    RB_PARENT(u)->right = v;
 
-  v->parent = u->parent;
+  RB_SET_PARENT(v, RB_PARENT(u));
 }
 
 // Restaura as propriedades da árvore Rubro-Negra após a inserção de `z`.
-static void rb_insert_fixup(rb_tree *tree, rb_node *z) {
+static int rb_insert_fixup(rb_tree *tree, rb_node *z) {
   // O loop continua enquanto o pai de z for Vermelho (violando a Regra 4).
-  while (z->parent->color == RB_RED) {
+  while (RB_COLOR(RB_PARENT(z)) == RB_RED) {
+    // O avô de z não muda no CASO 2, que só rotaciona abaixo dele.
+    rb_node *g = RB_PARENT(RB_PARENT(z));
+
     // Se o pai de z é um filho ESQUERDO do avô
-    if (z->parent == z->parent->parent->left) {
-      rb_node *y = z->parent->parent->right; // y é o TIO de z.
+    if (RB_PARENT(z) == g->left) {
+      rb_node *y = g->right; // y é o TIO de z.
 
       // CASO 1: O tio é VERMELHO.
-      if (y->color == RB_RED) {
-        z->parent->color = RB_BLACK;       // Pai -> Preto
-        y->color = RB_BLACK;               // Tio -> Preto
-        z->parent->parent->color = RB_RED; // Avo -> Vermelho
-        z = z->parent->parent;             // Volta o foco para o avo
+      if (RB_COLOR(y) == RB_RED) {
+        RB_STAT(tree, insert_fixup[0]);
+        RB_SET_COLOR(RB_PARENT(z), RB_BLACK); // Pai -> Preto
+        RB_SET_COLOR(y, RB_BLACK);            // Tio -> Preto
+        RB_SET_COLOR(g, RB_RED);              // Avo -> Vermelho
+        z = g;                                // Volta o foco para o avo
       } else {
         // CASO 2: O tio é PRETO (e z é um filho DIREITO).
-        if (z == z->parent->right) {
-          z = z->parent; // Move o foco para o pai.
+        if (z == RB_PARENT(z)->right) {
+          RB_STAT(tree, insert_fixup[1]);
+          z = RB_PARENT(z); // Move o foco para o pai.
           rb_rotate_left(
               tree, z); // Rotaciona para transformar em um caso "linha reta".
         }
         // CASO 3: O tio é PRETO (e z é um filho ESQUERDO).
-        z->parent->color = RB_BLACK;              // Pai -> Preto
-        z->parent->parent->color = RB_RED;        // Avô -> Vermelho
-        rb_rotate_right(tree, z->parent->parent); // Rotaciona o avô.
+        RB_STAT(tree, insert_fixup[2]);
+        RB_SET_COLOR(RB_PARENT(z), RB_BLACK); // Pai -> Preto
+        RB_SET_COLOR(g, RB_RED);              // Avô -> Vermelho
+        rb_rotate_right(tree, g);             // Rotaciona o avô.
       }
     } else { // Se o pai de z é um filho DIREITO do avô (código espelhado).
-      rb_node *y = z->parent->parent->left; // y é o TIO de z.
+      rb_node *y = g->left; // y é o TIO de z.
 
       // CASO 1: O tio é VERMELHO.
-      if (y->color == RB_RED) {
-        z->parent->color = RB_BLACK;
-        y->color = RB_BLACK;
-        z->parent->parent->color = RB_RED;
-        z = z->parent->parent;
+      if (RB_COLOR(y) == RB_RED) {
+        RB_STAT(tree, insert_fixup[0]);
+        RB_SET_COLOR(RB_PARENT(z), RB_BLACK);
+        RB_SET_COLOR(y, RB_BLACK);
+        RB_SET_COLOR(g, RB_RED);
+        z = g;
       } else {
         // CASO 2: O tio é PRETO (e z é um filho ESQUERDO).
-        if (z == z->parent->left) {
-          z = z->parent;
+        if (z == RB_PARENT(z)->left) {
+          RB_STAT(tree, insert_fixup[1]);
+          z = RB_PARENT(z);
           rb_rotate_right(tree, z);
         }
         // CASO 3: O tio é PRETO (e z é um filho DIREITO).
-        z->parent->color = RB_BLACK;
-        z->parent->parent->color = RB_RED;
-        rb_rotate_left(tree, z->parent->parent);
+        RB_STAT(tree, insert_fixup[2]);
+        RB_SET_COLOR(RB_PARENT(z), RB_BLACK);
+        RB_SET_COLOR(g, RB_RED);
+        rb_rotate_left(tree, g);
       }
     }
   }
-  // Garante que a raiz seja sempre Preta (Regra 2).
-  tree->root->color = RB_BLACK;
+  // Garante que a raiz seja sempre Preta (Regra 2). Retorna 1 se a raiz
+  // estava Vermelha, isto é, se a altura negra da árvore aumentou.
+  if (RB_COLOR(tree->root) == RB_RED) {
+    RB_SET_COLOR(tree->root, RB_BLACK);
+    return 1;
+  }
+  return 0;
 }
 
 // Restaura as propriedades da árvore binaria Rubro-Negra após uma remoção.
 static void rb_remove_fixup(rb_tree *tree, rb_node *x) {
   // O loop continua enquanto `x` for "Preto-Duplo" e não for a raiz.
-  while (x != tree->root && x->color == RB_BLACK) {
+  while (x != tree->root && RB_COLOR(x) == RB_BLACK) {
     // Se x é um filho esquerdo.
-    if (x == x->parent->left) {
-      rb_node *w = x->parent->right; // w é o IRMÃO de x.
+    if (x == RB_PARENT(x)->left) {
+      rb_node *w = RB_PARENT(x)->right; // w é o IRMÃO de x.
 
       // CASO 1: O irmão é vermelho.
-      if (w->color == RB_RED) {
-        w->color = RB_BLACK;
-        x->parent->color = RB_RED;
-        rb_rotate_left(tree, x->parent);
-        w = x->parent->right;
+      if (RB_COLOR(w) == RB_RED) {
+        RB_STAT(tree, remove_fixup[0]);
+        RB_SET_COLOR(w, RB_BLACK);
+        RB_SET_COLOR(RB_PARENT(x), RB_RED);
+        rb_rotate_left(tree, RB_PARENT(x));
+        w = RB_PARENT(x)->right;
       }
       // CASO 2: O irmão é preto e seus dois filhos são pretos.
-      if (w->left->color == RB_BLACK && w->right->color == RB_BLACK) {
-        w->color = RB_RED;
-        x = x->parent;
+      if (RB_COLOR(w->left) == RB_BLACK && RB_COLOR(w->right) == RB_BLACK) {
+        RB_STAT(tree, remove_fixup[1]);
+        RB_SET_COLOR(w, RB_RED);
+        x = RB_PARENT(x);
       } else {
         // CASO 3: O irmão é preto, filho esquerdo vermelho, filho direito preto
-        if (w->right->color == RB_BLACK) {
-          w->left->color = RB_BLACK;
-          w->color = RB_RED;
+        if (RB_COLOR(w->right) == RB_BLACK) {
+          RB_SET_COLOR(w->left, RB_BLACK);
+          RB_STAT(tree, remove_fixup[2]);
+          RB_SET_COLOR(w, RB_RED);
           rb_rotate_right(tree, w);
-          w = x->parent->right;
+          w = RB_PARENT(x)->right;
         }
         // CASO 4: O irmão é preto, filho direito vermelho.
-        w->color = x->parent->color;
-        x->parent->color = RB_BLACK;
-        w->right->color = RB_BLACK;
-        rb_rotate_left(tree, x->parent);
+        RB_STAT(tree, remove_fixup[3]);
+        RB_SET_COLOR(w, RB_COLOR(RB_PARENT(x)));
+        RB_SET_COLOR(RB_PARENT(x), RB_BLACK);
+        RB_SET_COLOR(w->right, RB_BLACK);
+        rb_rotate_left(tree, RB_PARENT(x));
         x = tree->root;
       }
     } else { // Se x é um filho direito (código espelhado).
-      rb_node *w = x->parent->left; // w é o IRMÃO de x.
+      rb_node *w = RB_PARENT(x)->left; // w é o IRMÃO de x.
 
       // CASO 1
-      if (w->color == RB_RED) {
-        w->color = RB_BLACK;
-        x->parent->color = RB_RED;
-        rb_rotate_right(tree, x->parent);
-        w = x->parent->left;
+      if (RB_COLOR(w) == RB_RED) {
+        RB_STAT(tree, remove_fixup[0]);
+        RB_SET_COLOR(w, RB_BLACK);
+        RB_SET_COLOR(RB_PARENT(x), RB_RED);
+        rb_rotate_right(tree, RB_PARENT(x));
+        w = RB_PARENT(x)->left;
       }
       // CASO 2
-      if (w->right->color == RB_BLACK && w->left->color == RB_BLACK) {
-        w->color = RB_RED;
-        x = x->parent;
+      if (RB_COLOR(w->right) == RB_BLACK && RB_COLOR(w->left) == RB_BLACK) {
+        RB_STAT(tree, remove_fixup[1]);
+        RB_SET_COLOR(w, RB_RED);
+        x = RB_PARENT(x);
       } else {
         // CASO 3
-        if (w->left->color == RB_BLACK) {
-          w->right->color = RB_BLACK;
-          w->color = RB_RED;
+        if (RB_COLOR(w->left) == RB_BLACK) {
+          RB_SET_COLOR(w->right, RB_BLACK);
+          RB_STAT(tree, remove_fixup[2]);
+          RB_SET_COLOR(w, RB_RED);
           rb_rotate_left(tree, w);
-          w = x->parent->left;
+          w = RB_PARENT(x)->left;
         }
         // CASO 4
-        w->color = x->parent->color;
-        x->parent->color = RB_BLACK;
-        w->left->color = RB_BLACK;
-        rb_rotate_right(tree, x->parent);
+        RB_STAT(tree, remove_fixup[3]);
+        RB_SET_COLOR(w, RB_COLOR(RB_PARENT(x)));
+        RB_SET_COLOR(RB_PARENT(x), RB_BLACK);
+        RB_SET_COLOR(w->left, RB_BLACK);
+        rb_rotate_right(tree, RB_PARENT(x));
         x = tree->root;
       }
     }
   }
-  x->color = RB_BLACK;
+  RB_SET_COLOR(x, RB_BLACK);
 }
 
-// Função recursiva para destruir todos os nós.
-static void rb_destroy_recursive(rb_tree *tree, rb_node *node) {
-  if (node != tree->NIL) {
-    rb_destroy_recursive(tree, node->left);
-    rb_destroy_recursive(tree, node->right);
-    tree->function_destroy(node->value);
+// Desconecta o nó `z` da árvore (sem destruí-lo) e a rebalanceia.
+static void rb_detach_node(rb_tree *tree, rb_node *z) {
+  rb_node *y = z; // y é o nó que será fisicamente removido.
+  rb_node *x;     // x é o filho que tomará o lugar de y.
+  int y_original_color = RB_COLOR(y);
+
+  if (z->left == tree->NIL) {
+    x = z->right;
+    rb_transplant(tree, z, z->right);
+  } else if (z->right == tree->NIL) {
+    x = z->left;
+    rb_transplant(tree, z, z->left);
+  } else {
+    y = rb_minimum(tree, z->right); // y é o sucessor de z.
+    y_original_color = RB_COLOR(y);
+    x = y->right;
+
+    if (RB_PARENT(y) == z) {
+      RB_SET_PARENT(x, y);
+    } else {
+      rb_transplant(tree, y, y->right);
+      y->right = z->right;
+      RB_SET_PARENT(y->right, y);
+    }
+
+    rb_transplant(tree, z, y);
+    y->left = z->left;
+    RB_SET_PARENT(y->left, y);
+    RB_SET_COLOR(y, RB_COLOR(z));
+  }
+
+  // x->parent é o nó mais baixo cuja sub-árvore perdeu um elemento (vale
+  // também quando x é o NIL, pois `rb_transplant` ajusta seu pai).
+  rb_update_path(tree, RB_PARENT(x));
+
+  // Se o nó removido era Preto, a árvore pode estar desbalanceada.
+  if (y_original_color == RB_BLACK)
+    rb_remove_fixup(tree, x);
+}
+
+// Aloca um nó, do pool da árvore se existir.
+static rb_node *rb_alloc_node(rb_tree *tree) {
+  RB_STAT(tree, node_allocs);
+  if (tree->pool != NULL)
+    return (rb_node *)pool_alloc(tree->pool);
+  return (rb_node *)malloc(tree->node_size);
+}
+
+// Libera um nó, devolvendo-o ao pool se existir.
+static void rb_free_node(rb_tree *tree, rb_node *node) {
+  RB_STAT(tree, node_frees);
+  if (tree->pool != NULL)
+    pool_free(tree->pool, node);
+  else
     free(node);
+}
+
+// Cria um nó com uma cópia do valor (cópia inline ou `function_copy`).
+static rb_node *rb_create_node(rb_tree *tree, void *value) {
+  rb_node *node = rb_alloc_node(tree);
+  if (tree->value_size > 0) {
+    // Os bytes do valor ficam logo após o nó.
+    node->value = (void *)((char *)(node + 1) + RB_EXTRA_BYTES(tree));
+    memcpy(node->value, value, tree->value_size);
+  } else {
+    node->value = tree->function_copy(value);
   }
+  RB_SET_COUNT(tree, node, 1);
+  if (tree->options & RB_OPT_INTERVAL)
+    RB_MAX_END(tree, node) = rb_interval_end(tree, node);
+  // No modo mapa o valor associado começa zerado (NULL).
+  if (tree->map_value_offset > 0)
+    memset((char *)node + tree->map_value_offset, 0,
+           tree->node_size - tree->map_value_offset);
+  return node;
 }
 
-rb_tree *rb_create_tree(rb_function_compare compare, rb_function_copy copy,
-                   rb_function_destroy destroy) {
-  rb_tree *tree = (rb_tree *)malloc(sizeof(rb_tree));
-  tree->function_compare = compare;
-  tree->function_copy = copy;
-  tree->function_destroy = destroy;
-  tree->size = 0;
+// Retorna o endereço do valor associado ao nó (modo mapa).
+static void *rb_map_slot(rb_tree *tree, rb_node *node) {
+  return (char *)node + tree->map_value_offset;
+}
+
+// Retorna o valor associado ao nó: o ponteiro guardado ou o endereço dos
+// bytes inline (modo mapa).
+static void *rb_map_value(rb_tree *tree, rb_node *node) {
+  void *slot = rb_map_slot(tree, node);
+  return (tree->map_value_size > 0) ? slot : *(void **)slot;
+}
+
+// Substitui o valor associado ao nó por uma cópia de `value` (modo mapa). A
+// cópia é feita antes de destruir o valor antigo, que pode ser o próprio
+// `value`.
+static void rb_map_assign(rb_tree *tree, rb_node *node, void *value) {
+  void *slot = rb_map_slot(tree, node);
+  if (tree->map_value_size > 0) {
+    memmove(slot, value, tree->map_value_size);
+    return;
+  }
+
+  void *copy = value;
+  if (tree->function_copy_map != NULL && value != NULL)
+    copy = tree->function_copy_map(value);
+  void *old = *(void **)slot;
+  if (tree->function_destroy_map != NULL && old != NULL)
+    tree->function_destroy_map(old);
+  *(void **)slot = copy;
+}
+
+// Destroi o valor do nó (e o valor associado, no modo mapa), sem liberar o
+// nó.
+static void rb_destroy_value(rb_tree *tree, rb_node *node) {
+  if (tree->function_destroy != NULL)
+    tree->function_destroy(node->value);
+  if (tree->function_destroy_map != NULL) {
+    void *value = *(void **)rb_map_slot(tree, node);
+    if (value != NULL)
+      tree->function_destroy_map(value);
+  }
+}
+
+// Destroi o valor do nó e libera o nó.
+static void rb_destroy_node(rb_tree *tree, rb_node *node) {
+  rb_destroy_value(tree, node);
+  rb_free_node(tree, node);
+}
+
+// Destroi até `budget` nós da sub-árvore `root` sem recursão: desce até uma
+// folha, a desconecta do pai e volta para o pai, deixando `root` por último
+// (os nós que restarem continuam ligados a ela). Com `release` 0 só os
+// valores são destruídos (os nós são liberados junto com os chunks do pool).
+// Retorna quantos nós foram destruídos.
+static unsigned int rb_destroy_nodes(rb_tree *tree, rb_node *root,
+                                     unsigned int budget, int release) {
+  unsigned int count = 0;
+  rb_node *node = root;
+  while (node != tree->NIL && count < budget) {
+    if (node->left != tree->NIL) {
+      node = node->left;
+    } else if (node->right != tree->NIL) {
+      node = node->right;
+    } else {
+      rb_node *parent = tree->NIL;
+      if (node != root) {
+        parent = RB_PARENT(node);
+        if (parent->left == node)
+          parent->left = tree->NIL;
+        else
+          parent->right = tree->NIL;
+      }
+
+      if (release)
+        rb_destroy_node(tree, node);
+      else
+        rb_destroy_value(tree, node);
+      count++;
+      node = parent;
+    }
+  }
+  return count;
+}
+
+// Destroi todos os nós a partir de `root`.
+static void rb_destroy_all(rb_tree *tree, rb_node *root) {
+  // Com pool e sem função de destruir não é preciso visitar os nós.
+  if (tree->pool == NULL || tree->function_destroy != NULL ||
+      tree->function_destroy_map != NULL)
+    rb_destroy_nodes(tree, root, UINT_MAX, tree->pool == NULL);
+  if (tree->pool != NULL)
+    RB_STAT_ADD(tree, node_frees, tree->size);
+  pool_clear(tree->pool); // Libera todos os chunks de uma vez.
+}
+
+// Recalcula os extremos após uma mudança na raiz (construção e operações de
+// conjunto), em O(log n).
+static void rb_update_extremes(rb_tree *tree) {
+  if (tree->root == tree->NIL) {
+    tree->leftmost = tree->NIL;
+    tree->rightmost = tree->NIL;
+  } else {
+    tree->leftmost = rb_minimum(tree, tree->root);
+    tree->rightmost = rb_maximum(tree, tree->root);
+  }
+}
+
+// Remove o nó `z` da arvore e o destroi, atualizando os extremos. O menor nó
+// não tem filho à esquerda, então seu sucessor é o menor da sub-árvore
+// direita ou o pai (e simetricamente para o maior). Se `out` não for NULL,
+// ele recebe o valor de `z`, que não é destruído.
+static void rb_remove_node(rb_tree *tree, rb_node *z, void *out) {
+  if (z == tree->leftmost)
+    tree->leftmost =
+        (z->right != tree->NIL) ? rb_minimum(tree, z->right) : RB_PARENT(z);
+  if (z == tree->rightmost)
+    tree->rightmost =
+        (z->left != tree->NIL) ? rb_maximum(tree, z->left) : RB_PARENT(z);
+
+  rb_detach_node(tree, z);
+
+  // Libera a memória do nó removido.
+  if (out == NULL) {
+    rb_destroy_node(tree, z);
+  } else {
+    if (tree->value_size > 0)
+      memcpy(out, z->value, tree->value_size);
+    else
+      *(void **)out = z->value;
+    if (tree->function_destroy_map != NULL) {
+      void *value = *(void **)rb_map_slot(tree, z);
+      if (value != NULL)
+        tree->function_destroy_map(value);
+    }
+    rb_free_node(tree, z);
+  }
+  tree->size--;
+}
+
+// Cria o nó de `value` como filho de `y` (à esquerda se `rs` < 0, senão à
+// direita; `y` é NIL se a árvore estiver vazia), o conecta e rebalanceia.
+static rb_node *rb_link_node(rb_tree *tree, rb_node *y, int rs, void *value) {
+  // Cria o novo nó.
+  rb_node *z = rb_create_node(tree, value);
+  z->left = tree->NIL;
+  z->right = tree->NIL;
+  RB_SET_COLOR(z, RB_RED); // Todos os novos nós sempre são vermelhos.
+
+  // Conecta o novo nó `z` ao seu pai `y`, do lado da última comparação.
+  RB_SET_PARENT(z, y);
+  if (y == tree->NIL) {
+    tree->root = z; // Árvore estava vazia.
+  } else if (rs < 0) {
+    y->left = z;
+  } else {
+    y->right = z;
+  }
+
+  // Um novo extremo só pode ser filho do extremo anterior.
+  tree->append_probe = 0;
+  if (y == tree->NIL) {
+    tree->leftmost = z;
+    tree->rightmost = z;
+    tree->append_probe = 1;
+  } else if (y == tree->leftmost && rs < 0) {
+    tree->leftmost = z;
+  } else if (y == tree->rightmost && rs > 0) {
+    tree->rightmost = z;
+    tree->append_probe = 1;
+  }
 
-  // Aloca o nó NIL (sentinela).
-  tree->NIL = (rb_node *)malloc(sizeof(rb_node));
-  tree->NIL->color = RB_BLACK; // O sentinela é sempre Preto.
-  tree->NIL->parent = tree->NIL;
+  // Aumenta o tamanho e chama a função de correção.
+  tree->size++;
+  rb_update_path(tree, y);
+  rb_insert_fixup(tree, z);
+  return z;
+}
+
+// Desce a partir de `x` (filho de `y` do lado `rs`) até a posição de `value`
+// (lógica da arvore binaria padrão (iterativa)) e o insere ali, se ainda não
+// existir. `bound` é um nó já comparado e maior que `value` (ou NIL), que não
+// é comparado de novo. `inserted` recebe 1 se o nó foi criado.
+static rb_node *rb_insert_from(rb_tree *tree, rb_node *y, int rs, rb_node *x,
+                               rb_node *bound, void *value, int *inserted) {
+  while (x != tree->NIL) {
+    y = x;
+    rs = (x == bound) ? -1 : RB_COMPARE(tree, value, x->value);
+    if (rs < 0) {
+      x = x->left;
+    } else if (rs > 0) {
+      x = x->right;
+    } else {
+      *inserted = 0; // Valor duplicado.
+      return x;
+    }
+  }
+
+  *inserted = 1;
+  return rb_link_node(tree, y, rs, value);
+}
+
+// Busca a posição de `value` com uma única descida. Se já existir retorna o
+// nó existente; senão cria o nó (só então copiando o valor), o conecta e
+// rebalanceia. `inserted` recebe 1 se o nó foi criado.
+static rb_node *rb_insert_node(rb_tree *tree, void *value, int *inserted) {
+  // Caminho rápido para chaves crescentes (timestamps, sequências): um valor
+  // maior que o maior nó vira seu filho direito, sem descer da raiz. Só é
+  // tentado logo depois de uma inserção que criou um novo maior nó, para que
+  // as inserções aleatórias não paguem a comparação extra.
+  rb_node *bound = tree->NIL;
+  if (tree->root != tree->NIL && tree->append_probe) {
+    int rs = RB_COMPARE(tree, value, tree->rightmost->value);
+    if (rs > 0) {
+      *inserted = 1;
+      return rb_link_node(tree, tree->rightmost, rs, value);
+    }
+    if (rs == 0) {
+      *inserted = 0;
+      return tree->rightmost;
+    }
+    // `value` < `rightmost`: a descida pela borda direita para nele sem
+    // compará-lo de novo.
+    bound = tree->rightmost;
+    tree->append_probe = 0;
+  }
+
+  return rb_insert_from(tree, tree->NIL, 0, tree->root, bound, value,
+                        inserted);
+}
+
+// Substitui o valor do nó por uma cópia de `value` (que compara igual).
+static void rb_replace_value(rb_tree *tree, rb_node *node, void *value) {
+  if (tree->value_size > 0) {
+    memcpy(node->value, value, tree->value_size);
+  } else {
+    void *copy = tree->function_copy(value);
+    tree->function_destroy(node->value);
+    node->value = copy;
+  }
+  // O fim do intervalo do novo valor pode ser outro.
+  if (tree->options & RB_OPT_INTERVAL)
+    rb_update_path(tree, node);
+}
+
+// Quantidade de níveis completos de uma árvore balanceada com `count`
+// elementos: h = floor(log2(count + 1)).
+static int rb_full_levels(size_t count) {
+  int levels = 0;
+  while (((size_t)1 << (levels + 1)) - 1 <= count)
+    levels++;
+  return levels;
+}
+
+// Constroi uma sub-árvore balanceada com os elementos [lo, hi) do vetor.
+// Os nós na profundidade `red_depth` (último nível incompleto) são vermelhos.
+static rb_node *rb_build_range(rb_tree *tree, const char *base, size_t stride,
+                               size_t lo, size_t hi, int depth, int red_depth,
+                               rb_node *parent) {
+  if (lo >= hi)
+    return tree->NIL;
+
+  size_t mid = lo + (hi - lo) / 2;
+  rb_node *node = rb_create_node(tree, (void *)(base + mid * stride));
+  RB_SET_PARENT(node, parent);
+  RB_SET_COLOR(node, (depth == red_depth) ? RB_RED : RB_BLACK);
+  RB_SET_COUNT(tree, node, (unsigned int)(hi - lo));
+  node->left = rb_build_range(tree, base, stride, lo, mid, depth + 1,
+                              red_depth, node);
+  node->right = rb_build_range(tree, base, stride, mid + 1, hi, depth + 1,
+                               red_depth, node);
+  if (tree->options & RB_OPT_INTERVAL)
+    rb_update_max_end(tree, node);
+  return node;
+}
+
+// ---------------------------------------- //
+//   Split e join (operações de conjunto).   //
+// ---------------------------------------- //
+/*
+  As sub-árvores manipuladas aqui ficam soltas (com pai NIL) e são tratadas
+  temporariamente como a raiz da árvore, para que as rotações e as funções de
+  correção possam ser reaproveitadas. Junto de cada sub-árvore anda a sua
+  altura negra, para que o `join` custe apenas a diferença entre as alturas.
+*/
+
+// Altura negra da sub-árvore: nós Pretos no caminho até uma folha.
+static int rb_black_height(rb_tree *tree, rb_node *node) {
+  int height = 0;
+  for (; node != tree->NIL; node = node->left) {
+    if (RB_COLOR(node) == RB_BLACK)
+      height++;
+  }
+  return height;
+}
+
+// Junta as sub-árvores `l` e `r` (de alturas negras `hl` e `hr`) usando o nó
+// `k` como elemento do meio: todos de `l` < k < todos de `r`. Desce pela borda
+// da mais alta até um nó Preto com a altura negra da outra, pendura `k` ali
+// (Vermelho) e corrige como numa inserção. Retorna a nova raiz e sua altura
+// negra em `height`.
+static rb_node *rb_join(rb_tree *tree, rb_node *l, int hl, rb_node *k,
+                        rb_node *r, int hr, int *height) {
+  // Raízes Vermelhas são pintadas de Preto, evitando dois Vermelhos seguidos
+  // quando `k` é pendurado logo acima delas.
+  if (RB_COLOR(l) == RB_RED) {
+    RB_SET_COLOR(l, RB_BLACK);
+    hl++;
+  }
+  if (RB_COLOR(r) == RB_RED) {
+    RB_SET_COLOR(r, RB_BLACK);
+    hr++;
+  }
+
+  rb_node *parent = tree->NIL;
+  rb_node *top;
+  int h;
+  RB_SET_COLOR(k, RB_RED);
+
+  if (hl >= hr) {
+    rb_node *c = l;
+    h = hl;
+    while (RB_COLOR(c) == RB_RED || hl > hr) {
+      if (RB_COLOR(c) == RB_BLACK)
+        hl--;
+      parent = c;
+      c = c->right;
+    }
+    k->left = c;
+    k->right = r;
+    if (parent == tree->NIL) {
+      top = k;
+    } else {
+      parent->right = k;
+      top = l;
+    }
+  } else { // Código espelhado, descendo pela borda esquerda de `r`.
+    rb_node *c = r;
+    h = hr;
+    while (RB_COLOR(c) == RB_RED || hr > hl) {
+      if (RB_COLOR(c) == RB_BLACK)
+        hr--;
+      parent = c;
+      c = c->left;
+    }
+    k->left = l;
+    k->right = c;
+    if (parent == tree->NIL) {
+      top = k;
+    } else {
+      parent->left = k;
+      top = r;
+    }
+  }
+
+  RB_SET_PARENT(k, parent);
+  if (k->left != tree->NIL)
+    RB_SET_PARENT(k->left, k);
+  if (k->right != tree->NIL)
+    RB_SET_PARENT(k->right, k);
+  rb_update_node(tree, k);
+
+  RB_SET_PARENT(top, tree->NIL);
+  tree->root = top;
+  rb_update_path(tree, parent);
+  *height = h + rb_insert_fixup(tree, k);
+  return tree->root;
+}
+
+// Junta `l` e `r` (todos de `l` < todos de `r`) sem elemento do meio: o maior
+// de `l` é desconectado e usado como tal.
+static rb_node *rb_join2(rb_tree *tree, rb_node *l, int hl, rb_node *r, int hr,
+                         int *height) {
+  if (l == tree->NIL) {
+    *height = hr;
+    return r;
+  }
+  if (r == tree->NIL) {
+    *height = hl;
+    return l;
+  }
+
+  tree->root = l;
+  rb_node *k = rb_maximum(tree, l);
+  rb_detach_node(tree, k);
+  l = tree->root;
+  return rb_join(tree, l, rb_black_height(tree, l), k, r, hr, height);
+}
+
+// Divide a sub-árvore `t` (de altura negra `ht`) por `value`: `l` recebe os
+// menores e `r` os maiores, com suas alturas negras em `hl` e `hr`. Retorna o
+// nó igual a `value`, já solto, ou NIL. Custa O(log n), pois as alturas dos
+// `join` feitos na volta da recursão se cancelam.
+static rb_node *rb_split(rb_tree *tree, rb_node *t, int ht, void *value,
+                         rb_node **l, int *hl, rb_node **r, int *hr) {
+  if (t == tree->NIL) {
+    *l = *r = tree->NIL;
+    *hl = *hr = 0;
+    return tree->NIL;
+  }
+
+  rb_node *left = t->left;
+  rb_node *right = t->right;
+  int hc = ht - (RB_COLOR(t) == RB_BLACK); // Altura negra dos filhos.
+  RB_SET_PARENT(left, tree->NIL);
+  RB_SET_PARENT(right, tree->NIL);
+
+  int cmp = RB_COMPARE(tree, value, t->value);
+  if (cmp == 0) {
+    *l = left;
+    *hl = hc;
+    *r = right;
+    *hr = hc;
+    return t;
+  }
+
+  rb_node *mid;
+  int hm;
+  rb_node *found;
+  if (cmp < 0) {
+    found = rb_split(tree, left, hc, value, l, hl, &mid, &hm);
+    *r = rb_join(tree, mid, hm, t, right, hc, hr);
+  } else {
+    found = rb_split(tree, right, hc, value, &mid, &hm, r, hr);
+    *l = rb_join(tree, left, hc, t, mid, hm, hl);
+  }
+  return found;
+}
+
+// Copia para `tree` a sub-árvore `node` de `src`, mantendo o formato e as
+// cores (que continuam válidos). Retorna a cópia e sua altura negra.
+static rb_node *rb_copy_subtree(rb_tree *tree, rb_tree *src, rb_node *node,
+                                rb_node *parent, int *height) {
+  if (node == src->NIL) {
+    *height = 0;
+    return tree->NIL;
+  }
+
+  rb_node *copy = rb_create_node(tree, node->value);
+  if (tree->map_value_offset > 0)
+    rb_map_assign(tree, copy, rb_map_value(src, node));
+  RB_SET_COLOR(copy, RB_COLOR(node));
+  RB_SET_PARENT(copy, parent);
+  copy->left = rb_copy_subtree(tree, src, node->left, copy, height);
+  copy->right = rb_copy_subtree(tree, src, node->right, copy, height);
+  rb_update_node(tree, copy);
+  tree->size++;
+
+  *height += (RB_COLOR(copy) == RB_BLACK);
+  return copy;
+}
+
+// Destroi os nós da sub-árvore (um a um, devolvendo-os ao pool se existir).
+// Retorna quantos nós foram destruídos.
+static unsigned int rb_destroy_subtree(rb_tree *tree, rb_node *node) {
+  return rb_destroy_nodes(tree, node, UINT_MAX, 1);
+}
+
+// União da sub-árvore `t` com a sub-árvore `s` de `src`.
+static rb_node *rb_union_rec(rb_tree *tree, rb_node *t, int ht, rb_tree *src,
+                             rb_node *s, int *height) {
+  if (s == src->NIL) {
+    *height = ht;
+    return t;
+  }
+  if (t == tree->NIL)
+    return rb_copy_subtree(tree, src, s, tree->NIL, height);
+
+  rb_node *l, *r;
+  int hl, hr;
+  rb_node *k = rb_split(tree, t, ht, s->value, &l, &hl, &r, &hr);
+  l = rb_union_rec(tree, l, hl, src, s->left, &hl);
+  r = rb_union_rec(tree, r, hr, src, s->right, &hr);
+
+  // O nó de `tree` é reaproveitado; senão o elemento de `src` é copiado.
+  if (k == tree->NIL) {
+    k = rb_create_node(tree, s->value);
+    if (tree->map_value_offset > 0)
+      rb_map_assign(tree, k, rb_map_value(src, s));
+    tree->size++;
+  }
+  return rb_join(tree, l, hl, k, r, hr, height);
+}
+
+// Interseção da sub-árvore `t` com a sub-árvore `s` de `src`.
+static rb_node *rb_intersection_rec(rb_tree *tree, rb_node *t, int ht,
+                                    rb_tree *src, rb_node *s, int *height) {
+  if (t == tree->NIL || s == src->NIL) {
+    tree->size -= rb_destroy_subtree(tree, t);
+    *height = 0;
+    return tree->NIL;
+  }
+
+  rb_node *l, *r;
+  int hl, hr;
+  rb_node *k = rb_split(tree, t, ht, s->value, &l, &hl, &r, &hr);
+  l = rb_intersection_rec(tree, l, hl, src, s->left, &hl);
+  r = rb_intersection_rec(tree, r, hr, src, s->right, &hr);
+
+  if (k != tree->NIL)
+    return rb_join(tree, l, hl, k, r, hr, height);
+  return rb_join2(tree, l, hl, r, hr, height);
+}
+
+// Diferença da sub-árvore `t` com a sub-árvore `s` de `src`.
+static rb_node *rb_difference_rec(rb_tree *tree, rb_node *t, int ht,
+                                  rb_tree *src, rb_node *s, int *height) {
+  if (t == tree->NIL || s == src->NIL) {
+    *height = ht;
+    return t;
+  }
+
+  rb_node *l, *r;
+  int hl, hr;
+  rb_node *k = rb_split(tree, t, ht, s->value, &l, &hl, &r, &hr);
+  l = rb_difference_rec(tree, l, hl, src, s->left, &hl);
+  r = rb_difference_rec(tree, r, hr, src, s->right, &hr);
+
+  if (k != tree->NIL) {
+    rb_destroy_node(tree, k);
+    tree->size--;
+  }
+  return rb_join2(tree, l, hl, r, hr, height);
+}
+
+// Define a raiz após uma operação de conjunto.
+static void rb_set_root(rb_tree *tree, rb_node *root) {
+  RB_SET_PARENT(root, tree->NIL);
+  RB_SET_COLOR(root, RB_BLACK);
+  tree->root = root;
+  rb_update_extremes(tree);
+}
+
+// Visita em ordem os elementos da sub-árvore `node` que se sobrepõem a
+// [lo, hi). Retorna 0 se a visita foi interrompida.
+static int rb_overlap_rec(rb_tree *tree, rb_node *node, int64_t lo, int64_t hi,
+                          rb_function_visit visit, void *ctx,
+                          unsigned int *count) {
+  // Nenhum intervalo da sub-árvore termina depois de `lo`.
+  while (node != tree->NIL && RB_MAX_END(tree, node) > lo) {
+    if (!rb_overlap_rec(tree, node->left, lo, hi, visit, ctx, count))
+      return 0;
+
+    int64_t start, end;
+    tree->function_interval(node->value, &start, &end);
+    if (start >= hi)
+      return 1; // Os da direita começam depois.
+    if (end > lo) {
+      (*count)++;
+      if (visit(node->value, ctx) == 0)
+        return 0;
+    }
+    node = node->right;
+  }
+  return 1;
+}
+
+// Aloca o nó NIL (sentinela) e deixa a árvore vazia.
+static void rb_init_nil(rb_tree *tree) {
+  tree->NIL = (rb_node *)malloc(sizeof(rb_node) + RB_EXTRA_BYTES(tree));
+  RB_SET_COLOR(tree->NIL, RB_BLACK); // O sentinela é sempre Preto.
+  RB_SET_PARENT(tree->NIL, tree->NIL);
   tree->NIL->left = tree->NIL;
   tree->NIL->right = tree->NIL;
+  RB_SET_COUNT(tree, tree->NIL, 0); // O sentinela não conta nas sub-árvores.
+  if (tree->options & RB_OPT_INTERVAL)
+    RB_MAX_END(tree, tree->NIL) = INT64_MIN;
 
   // A raiz inicialmente aponta para o NIL (sentinela).
   tree->root = tree->NIL;
+  tree->leftmost = tree->NIL;
+  tree->rightmost = tree->NIL;
+  tree->append_probe = 1;
+  tree->size = 0;
+}
+
+// Inicializa a árvore para os dois modos de armazenamento dos valores.
+static rb_tree *rb_init_tree(rb_function_compare compare, rb_function_copy copy,
+                             rb_function_destroy destroy, size_t value_size,
+                             unsigned int options) {
+  rb_tree *tree = (rb_tree *)malloc(sizeof(rb_tree));
+  tree->function_compare = compare;
+  tree->function_copy = copy;
+  tree->function_destroy = destroy;
+  tree->options = options;
+  tree->value_size = value_size;
+  tree->node_size = sizeof(rb_node) + RB_EXTRA_BYTES(tree) + value_size;
+
+  tree->map_value_offset = 0;
+  tree->map_value_size = 0;
+  tree->function_copy_map = NULL;
+  tree->function_destroy_map = NULL;
+  tree->function_interval = NULL;
+
+  tree->pool = NULL;
+  if (options & RB_OPT_POOL)
+    tree->pool = pool_create(tree->node_size);
+
+  rb_init_nil(tree);
+
+#ifdef COLLECTIONS_STATS
+  memset(&tree->stats, 0, sizeof(tree->stats));
+#endif
+
+  return tree;
+}
+
+rb_tree *rb_create_tree(rb_function_compare compare, rb_function_copy copy,
+                   rb_function_destroy destroy) {
+  return rb_init_tree(compare, copy, destroy, 0, 0);
+}
+
+rb_tree *rb_create_tree_ex(rb_function_compare compare, rb_function_copy copy,
+                           rb_function_destroy destroy, unsigned int options) {
+  return rb_init_tree(compare, copy, destroy, 0, options & ~RB_OPT_INTERVAL);
+}
+
+rb_tree *rb_create_tree_inline(rb_function_compare compare, size_t value_size,
+                               unsigned int options) {
+  return rb_init_tree(compare, NULL, NULL, value_size,
+                      options & ~RB_OPT_INTERVAL);
+}
+
+// Inicializa um mapa: o valor associado fica após a chave, alinhado a 8
+// bytes (`map_value_size` bytes, ou um ponteiro).
+static rb_tree *rb_init_map(rb_function_compare compare, rb_function_copy copy,
+                            rb_function_destroy destroy, size_t key_size,
+                            rb_function_copy copy_value,
+                            rb_function_destroy destroy_value,
+                            size_t value_size, unsigned int options) {
+  // O pool só é criado depois que o tamanho do nó estiver definido.
+  options &= ~RB_OPT_INTERVAL;
+  rb_tree *tree =
+      rb_init_tree(compare, copy, destroy, key_size, options & ~RB_OPT_POOL);
+  tree->options = options;
+  tree->map_value_offset = (tree->node_size + 7) & ~(size_t)7;
+  tree->map_value_size = value_size;
+  tree->function_copy_map = copy_value;
+  tree->function_destroy_map = destroy_value;
+  tree->node_size =
+      tree->map_value_offset + (value_size > 0 ? value_size : sizeof(void *));
 
+  if (options & RB_OPT_POOL)
+    tree->pool = pool_create(tree->node_size);
+  return tree;
+}
+
+rb_tree *rb_create_map(rb_function_compare compare, rb_function_copy copy,
+                       rb_function_destroy destroy, rb_function_copy copy_value,
+                       rb_function_destroy destroy_value,
+                       unsigned int options) {
+  return rb_init_map(compare, copy, destroy, 0, copy_value, destroy_value, 0,
+                     options);
+}
+
+rb_tree *rb_create_map_inline(rb_function_compare compare, size_t key_size,
+                              size_t value_size, unsigned int options) {
+  return rb_init_map(compare, NULL, NULL, key_size, NULL, NULL, value_size,
+                     options);
+}
+
+rb_tree *rb_create_interval(rb_function_compare compare, rb_function_copy copy,
+                            rb_function_destroy destroy,
+                            rb_function_interval interval,
+                            unsigned int options) {
+  rb_tree *tree =
+      rb_init_tree(compare, copy, destroy, 0, options | RB_OPT_INTERVAL);
+  tree->function_interval = interval;
+  return tree;
+}
+
+rb_tree *rb_create_interval_inline(rb_function_compare compare,
+                                   rb_function_interval interval,
+                                   size_t value_size, unsigned int options) {
+  rb_tree *tree =
+      rb_init_tree(compare, NULL, NULL, value_size, options | RB_OPT_INTERVAL);
+  tree->function_interval = interval;
   return tree;
 }
 
@@ -252,111 +1144,326 @@ void rb_clear(rb_tree *tree) {
   if (tree == NULL || tree->root == tree->NIL)
     return; 
 
-  // Chama a função recursiva para liberar todos os nossos nós
-  rb_destroy_recursive(tree, tree->root);
+  // Libera todos os nós sem recursão (ou os chunks do pool de uma vez).
+  rb_destroy_all(tree, tree->root);
 
   tree->root = tree->NIL;
+  tree->leftmost = tree->NIL;
+  tree->rightmost = tree->NIL;
   tree->size = 0;
 }
 
+rb_tree *rb_detach(rb_tree *tree) {
+  if (tree == NULL)
+    return NULL;
+
+  // A cópia da estrutura fica com a raiz, o sentinela e o pool; `tree`
+  // recebe um sentinela e um pool novos.
+  rb_tree *detached = (rb_tree *)malloc(sizeof(rb_tree));
+  *detached = *tree;
+  rb_init_nil(tree);
+  if (tree->pool != NULL)
+    tree->pool = pool_create(tree->node_size);
+  return detached;
+}
+
+unsigned int rb_clear_step(rb_tree *tree, unsigned int budget) {
+  if (tree == NULL || tree->root == tree->NIL)
+    return 0;
+
+  // Os extremos deixam de valer no primeiro passo.
+  tree->leftmost = tree->NIL;
+  tree->rightmost = tree->NIL;
+
+  // Com pool e sem função de destruir basta liberar os chunks.
+  if (tree->pool != NULL && tree->function_destroy == NULL &&
+      tree->function_destroy_map == NULL) {
+    rb_clear(tree);
+    return 0;
+  }
+
+  unsigned int count =
+      rb_destroy_nodes(tree, tree->root, budget, tree->pool == NULL);
+  tree->size -= count;
+  if (tree->pool != NULL)
+    RB_STAT_ADD(tree, node_frees, count);
+
+  if (tree->size == 0) {
+    tree->root = tree->NIL;
+    pool_clear(tree->pool);
+  }
+  return tree->size;
+}
+
 void rb_destroy_tree(rb_tree *tree) {
   if (tree == NULL)
     return;
-  rb_destroy_recursive(tree, tree->root);
+  rb_destroy_all(tree, tree->root);
+  pool_destroy(tree->pool);
   free(tree->NIL); // Libera o sentinela.
   free(tree);      // Libera a estrutura da árvore.
 }
 
 int rb_insert(rb_tree *tree, void *value) {
-  int rs;
-  // Cria o novo nó.
-  rb_node *z = (rb_node *)malloc(sizeof(rb_node));
-  z->value = tree->function_copy(value);
-  z->left = tree->NIL;
-  z->right = tree->NIL;
-  z->color = RB_RED; // Todos os novos nós sempre são vermelhos.
+  int inserted;
+  rb_insert_node(tree, value, &inserted);
+  return inserted; // 0 se for duplicata.
+}
 
-  // Acha a posição correta na árvore para inserir (lógica da arvore binaria
-  // padrão (iterativa)).
-  rb_node *y = tree->NIL;
-  rb_node *x = tree->root;
-  while (x != tree->NIL) {
-    y = x;
-    rs = tree->function_compare(z->value, x->value);
-    if (rs < 0) {
-      x = x->left;
-    } else if (rs > 0) {
-      x = x->right;
-    } else {
-      // Valor duplicado. Aborta a inserção.
-      tree->function_destroy(z->value);
-      free(z);
-      return 0;
-    }
+void *rb_find_or_insert(rb_tree *tree, void *value, int *inserted) {
+  int created;
+  rb_node *node = rb_insert_node(tree, value, &created);
+  if (inserted != NULL)
+    *inserted = created;
+  return node->value;
+}
+
+rb_node *rb_insert_hint(rb_tree *tree, rb_node *hint, void *value,
+                        int *inserted) {
+  int created;
+  if (inserted == NULL)
+    inserted = &created;
+  if (hint == NULL || hint == tree->NIL)
+    return rb_insert_node(tree, value, inserted);
+
+  int rs = RB_COMPARE(tree, value, hint->value);
+  if (rs == 0) {
+    *inserted = 0; // Valor duplicado.
+    return hint;
   }
 
-  // Conecta o novo nó `z` ao seu pai `y`.
-  z->parent = y;
-  if (y == tree->NIL) {
-    tree->root = z; // Árvore estava vazia.
-  } else if (tree->function_compare(z->value, y->value) < 0) {
-    y->left = z;
-  } else {
-    y->right = z;
+  // Sobe a partir da dica até o primeiro ancestral que limita a chave do seu
+  // lado (para rs > 0, um ancestral maior que ela, do qual viemos pela
+  // esquerda). Só esses ancestrais são comparados, então uma chave a d
+  // posições da dica custa O(log d) comparações.
+  rb_node *node = hint;
+  int first = 1; // Nenhum limite ultrapassado: a chave é vizinha da dica.
+  while (RB_PARENT(node) != tree->NIL) {
+    rb_node *parent = RB_PARENT(node);
+    if (node == ((rs > 0) ? parent->left : parent->right)) {
+      int cmp = RB_COMPARE(tree, value, parent->value);
+      if (cmp == 0) {
+        *inserted = 0;
+        return parent;
+      }
+      if ((cmp < 0) == (rs > 0)) {
+        // A chave fica entre a dica e o limite: direto na sub-árvore da
+        // dica do lado da chave, ou desce a partir de `node`.
+        if (first)
+          return rb_insert_from(tree, hint, rs,
+                                (rs > 0) ? hint->right : hint->left,
+                                tree->NIL, value, inserted);
+        return rb_insert_from(tree, parent, -rs, node, tree->NIL, value,
+                              inserted);
+      }
+      first = 0;
+    }
+    node = parent;
   }
 
-  // Aumenta o tamanho e chama a função de correção.
-  tree->size++;
-  rb_insert_fixup(tree, z);
-  return 1;
+  // A chave passa de todos os limites da subida: inserção normal (que já
+  // trata em O(1) as chaves maiores que o maior elemento).
+  return rb_insert_node(tree, value, inserted);
+}
+
+int rb_upsert(rb_tree *tree, void *value) {
+  int inserted;
+  rb_node *node = rb_insert_node(tree, value, &inserted);
+  if (!inserted)
+    rb_replace_value(tree, node, value);
+  return inserted;
 }
 
 int rb_remove(rb_tree *tree, void *value) {
   rb_node *z = rb_find_node(tree, tree->root, value);
   if (z == tree->NIL)
     return 0; // Nó não encontrado.
-  
-  rb_node *y = z; // y é o nó que será fisicamente removido.
-  rb_node *x;     // x é o filho que tomará o lugar de y.
-  int y_original_color = y->color;
 
-  if (z->left == tree->NIL) {
-    x = z->right;
-    rb_transplant(tree, z, z->right);
-  } else if (z->right == tree->NIL) {
-    x = z->left;
-    rb_transplant(tree, z, z->left);
-  } else {
-    y = rb_minimum(tree, z->right); // y é o sucessor de z.
-    y_original_color = y->color;
-    x = y->right;
+  rb_remove_node(tree, z, NULL);
+  return 1;
+}
 
-    if (y->parent == z) {
-      x->parent = y;
-    } else {
-      rb_transplant(tree, y, y->right);
-      y->right = z->right;
-      y->right->parent = y;
-    }
+void *rb_min(rb_tree *tree) {
+  if (tree == NULL || tree->root == tree->NIL)
+    return NULL;
+  return tree->leftmost->value;
+}
 
-    rb_transplant(tree, z, y);
-    y->left = z->left;
-    y->left->parent = y;
-    y->color = z->color;
-  }
+void *rb_max(rb_tree *tree) {
+  if (tree == NULL || tree->root == tree->NIL)
+    return NULL;
+  return tree->rightmost->value;
+}
 
-  // Libera a memória do nó removido.
-  tree->function_destroy(z->value);
-  free(z);
-  tree->size--;
+int rb_pop_min(rb_tree *tree, void *out) {
+  if (tree == NULL || tree->root == tree->NIL)
+    return 0;
+  rb_remove_node(tree, tree->leftmost, out);
+  return 1;
+}
 
-  // Se o nó removido era Preto, a árvore pode estar desbalanceada.
-  if (y_original_color == RB_BLACK) 
-    rb_remove_fixup(tree, x);
+int rb_pop_max(rb_tree *tree, void *out) {
+  if (tree == NULL || tree->root == tree->NIL)
+    return 0;
+  rb_remove_node(tree, tree->rightmost, out);
+  return 1;
+}
+
+int rb_map_put(rb_tree *tree, void *key, void *value) {
+  if (tree == NULL || tree->map_value_offset == 0)
+    return 0;
+
+  int inserted;
+  rb_node *node = rb_insert_node(tree, key, &inserted);
+  rb_map_assign(tree, node, value);
+  return inserted;
+}
+
+void *rb_map_get(rb_tree *tree, void *key) {
+  if (tree == NULL || tree->map_value_offset == 0)
+    return NULL;
 
+  rb_node *node = rb_find_node(tree, tree->root, key);
+  return (node != tree->NIL) ? rb_map_value(tree, node) : NULL;
+}
+
+void *rb_map_get_ptr(rb_tree *tree, void *key) {
+  if (tree == NULL || tree->map_value_offset == 0)
+    return NULL;
+
+  rb_node *node = rb_find_node(tree, tree->root, key);
+  return (node != tree->NIL) ? rb_map_slot(tree, node) : NULL;
+}
+
+void *rb_map_value_ptr(rb_tree *tree, rb_node *node) {
+  if (tree == NULL || tree->map_value_offset == 0 || node == NULL ||
+      node == tree->NIL)
+    return NULL;
+  return rb_map_slot(tree, node);
+}
+
+int rb_build_sorted(rb_tree *tree, const void *values, size_t count,
+                    size_t stride) {
+  if (tree == NULL || tree->root != tree->NIL)
+    return 0;
+
+  tree->root = rb_build_range(tree, (const char *)values, stride, 0, count, 0,
+                              rb_full_levels(count), tree->NIL);
+  tree->size = count;
+  rb_update_extremes(tree);
   return 1;
 }
 
+int rb_append_sorted(rb_tree *tree, const void *values, size_t count,
+                     size_t stride) {
+  if (tree == NULL)
+    return 0;
+  if (tree->root == tree->NIL)
+    return rb_build_sorted(tree, values, count, stride);
+  if (count == 0)
+    return 1;
+
+  const char *base = (const char *)values;
+  rb_node *max = tree->rightmost;
+  if (RB_COMPARE(tree, (void *)base, max->value) <= 0)
+    return 0; // Os novos elementos precisam vir depois do maior.
+
+  // O primeiro elemento é o nó do meio do `join`, e os demais formam uma
+  // sub-árvore montada como em `rb_build_sorted` (sua altura negra é a
+  // quantidade de níveis completos).
+  rb_node *k = rb_create_node(tree, (void *)base);
+  int levels = rb_full_levels(count - 1);
+  rb_node *rest =
+      rb_build_range(tree, base, stride, 1, count, 0, levels, tree->NIL);
+
+  int height;
+  rb_set_root(tree, rb_join(tree, tree->root,
+                            rb_black_height(tree, tree->root), k, rest,
+                            levels, &height));
+  tree->size += count;
+  return 1;
+}
+
+unsigned int rb_union(rb_tree *dst, rb_tree *src) {
+  if (dst == NULL || src == NULL || dst == src)
+    return 0;
+  // Os valores associados só podem ser copiados entre mapas do mesmo tipo.
+  if ((dst->map_value_offset > 0) != (src->map_value_offset > 0) ||
+      dst->map_value_size != src->map_value_size)
+    return 0;
+
+  unsigned int old_size = dst->size;
+  int height;
+  rb_set_root(dst, rb_union_rec(dst, dst->root,
+                                rb_black_height(dst, dst->root), src,
+                                src->root, &height));
+  return dst->size - old_size;
+}
+
+unsigned int rb_intersection(rb_tree *dst, rb_tree *src) {
+  if (dst == NULL || src == NULL || dst == src)
+    return 0;
+
+  unsigned int old_size = dst->size;
+  int height;
+  rb_set_root(dst, rb_intersection_rec(dst, dst->root,
+                                       rb_black_height(dst, dst->root), src,
+                                       src->root, &height));
+  return old_size - dst->size;
+}
+
+unsigned int rb_difference(rb_tree *dst, rb_tree *src) {
+  if (dst == NULL || src == NULL)
+    return 0;
+
+  unsigned int old_size = dst->size;
+  if (dst == src) {
+    rb_clear(dst);
+    return old_size;
+  }
+
+  int height;
+  rb_set_root(dst, rb_difference_rec(dst, dst->root,
+                                     rb_black_height(dst, dst->root), src,
+                                     src->root, &height));
+  return old_size - dst->size;
+}
+
+unsigned int rb_erase_range(rb_tree *tree, void *lo, void *hi) {
+  if (tree == NULL || tree->root == tree->NIL)
+    return 0;
+  if (lo != NULL && hi != NULL && RB_COMPARE(tree, lo, hi) >= 0)
+    return 0; // Intervalo vazio.
+
+  // Separa a árvore em [menores que lo] [lo, hi) [maiores ou iguais a hi].
+  rb_node *a = tree->NIL, *b = tree->root, *c = tree->NIL;
+  int ha = 0, hb = rb_black_height(tree, tree->root), hc = 0;
+  unsigned int removed = 0;
+
+  if (lo != NULL) {
+    rb_node *found = rb_split(tree, b, hb, lo, &a, &ha, &b, &hb);
+    if (found != tree->NIL) {
+      rb_destroy_node(tree, found);
+      removed++;
+    }
+  }
+  if (hi != NULL) {
+    rb_node *mid, *found;
+    int hm;
+    found = rb_split(tree, b, hb, hi, &mid, &hm, &c, &hc);
+    if (found != tree->NIL) // `hi` fica fora do intervalo.
+      c = rb_join(tree, tree->NIL, 0, found, c, hc, &hc);
+    b = mid;
+  }
+
+  removed += rb_destroy_subtree(tree, b);
+  tree->size -= removed;
+
+  int height;
+  rb_set_root(tree, rb_join2(tree, a, ha, c, hc, &height));
+  return removed;
+}
+
 void *rb_search(rb_tree *tree, void *value) {
   if (tree == NULL)
     return NULL;
@@ -367,9 +1474,302 @@ void *rb_search(rb_tree *tree, void *value) {
   return NULL;
 }
 
+rb_node *rb_first(rb_tree *tree) {
+  if (tree == NULL || tree->root == tree->NIL)
+    return NULL;
+  return tree->leftmost;
+}
+
+rb_node *rb_last(rb_tree *tree) {
+  if (tree == NULL || tree->root == tree->NIL)
+    return NULL;
+  return tree->rightmost;
+}
+
+rb_node *rb_next(rb_tree *tree, rb_node *node) {
+  if (node == NULL)
+    return NULL;
+
+  // Sucessor: menor nó da sub-árvore direita, ou o primeiro ancestral do qual
+  // viemos pela esquerda.
+  if (node->right != tree->NIL)
+    return rb_minimum(tree, node->right);
+
+  rb_node *parent = RB_PARENT(node);
+  while (parent != tree->NIL && node == parent->right) {
+    node = parent;
+    parent = RB_PARENT(parent);
+  }
+  return (parent != tree->NIL) ? parent : NULL;
+}
+
+rb_node *rb_prev(rb_tree *tree, rb_node *node) {
+  if (node == NULL)
+    return NULL;
+
+  if (node->left != tree->NIL)
+    return rb_maximum(tree, node->left);
+
+  rb_node *parent = RB_PARENT(node);
+  while (parent != tree->NIL && node == parent->left) {
+    node = parent;
+    parent = RB_PARENT(parent);
+  }
+  return (parent != tree->NIL) ? parent : NULL;
+}
+
+rb_node *rb_lower_bound(rb_tree *tree, void *value) {
+  if (tree == NULL)
+    return NULL;
+
+  rb_node *node = tree->root;
+  rb_node *result = NULL;
+  while (node != tree->NIL) {
+    if (RB_COMPARE(tree, node->value, value) >= 0) {
+      result = node; // Candidato, procura um menor à esquerda.
+      node = node->left;
+    } else {
+      node = node->right;
+    }
+  }
+  return result;
+}
+
+rb_node *rb_upper_bound(rb_tree *tree, void *value) {
+  if (tree == NULL)
+    return NULL;
+
+  rb_node *node = tree->root;
+  rb_node *result = NULL;
+  while (node != tree->NIL) {
+    if (RB_COMPARE(tree, node->value, value) > 0) {
+      result = node;
+      node = node->left;
+    } else {
+      node = node->right;
+    }
+  }
+  return result;
+}
+
+unsigned int rb_range(rb_tree *tree, void *lo, void *hi,
+                      rb_function_visit visit, void *ctx) {
+  if (tree == NULL)
+    return 0;
+
+  unsigned int count = 0;
+  rb_node *node = (lo != NULL) ? rb_lower_bound(tree, lo) : rb_first(tree);
+  while (node != NULL) {
+    if (hi != NULL && RB_COMPARE(tree, node->value, hi) >= 0)
+      break;
+    count++;
+    if (visit(node->value, ctx) == 0)
+      break; // O visitante pediu para parar.
+    node = rb_next(tree, node);
+  }
+  return count;
+}
+
+rb_node *rb_overlap_any(rb_tree *tree, int64_t lo, int64_t hi) {
+  if (tree == NULL || !(tree->options & RB_OPT_INTERVAL) || lo >= hi)
+    return NULL;
+
+  // Se a esquerda tem um intervalo que termina depois de `lo` e nenhum dela
+  // se sobrepõe, todos os da direita começam depois de `hi`: basta descer por
+  // um caminho.
+  rb_node *node = tree->root;
+  while (node != tree->NIL) {
+    int64_t start, end;
+    tree->function_interval(node->value, &start, &end);
+    if (start < hi && lo < end)
+      return node;
+    if (RB_MAX_END(tree, node->left) > lo)
+      node = node->left;
+    else
+      node = node->right;
+  }
+  return NULL;
+}
+
+unsigned int rb_overlap_all(rb_tree *tree, int64_t lo, int64_t hi,
+                            rb_function_visit visit, void *ctx) {
+  unsigned int count = 0;
+  if (tree != NULL && (tree->options & RB_OPT_INTERVAL) && lo < hi)
+    rb_overlap_rec(tree, tree->root, lo, hi, visit, ctx, &count);
+  return count;
+}
+
+rb_node *rb_select(rb_tree *tree, unsigned int index) {
+  if (tree == NULL || !(tree->options & RB_OPT_ORDER_STAT) ||
+      index >= tree->size)
+    return NULL;
+
+  rb_node *node = tree->root;
+  while (node != tree->NIL) {
+    unsigned int left = RB_COUNT(node->left);
+    if (index < left) {
+      node = node->left;
+    } else if (index > left) {
+      index -= left + 1; // Pula a sub-árvore esquerda e o próprio nó.
+      node = node->right;
+    } else {
+      return node;
+    }
+  }
+  return NULL;
+}
+
+unsigned int rb_rank(rb_tree *tree, void *value) {
+  if (tree == NULL || !(tree->options & RB_OPT_ORDER_STAT))
+    return 0;
+
+  unsigned int rank = 0;
+  rb_node *node = tree->root;
+  while (node != tree->NIL) {
+    int cmp = RB_COMPARE(tree, value, node->value);
+    if (cmp <= 0) {
+      node = node->left;
+    } else {
+      rank += RB_COUNT(node->left) + 1; // Todos à esquerda e o nó são menores.
+      node = node->right;
+    }
+  }
+  return rank;
+}
+
+unsigned int rb_count_range(rb_tree *tree, void *lo, void *hi) {
+  if (tree == NULL || !(tree->options & RB_OPT_ORDER_STAT))
+    return 0;
+
+  unsigned int end = (hi != NULL) ? rb_rank(tree, hi) : tree->size;
+  unsigned int begin = (lo != NULL) ? rb_rank(tree, lo) : 0;
+  return (end > begin) ? end - begin : 0;
+}
+
+// Busca um lote em grupos de RB_BATCH_GROUP buscas, avançando todas um nível
+// por vez. O próximo nó de cada busca é carregado antecipadamente, então as
+// faltas de cache das buscas do grupo acontecem em paralelo.
+static void rb_search_interleaved(rb_tree *tree, void **keys, void **results,
+                                  size_t count) {
+  rb_node *current[RB_BATCH_GROUP];
+
+  for (size_t base = 0; base < count; base += RB_BATCH_GROUP) {
+    size_t n = count - base;
+    if (n > RB_BATCH_GROUP)
+      n = RB_BATCH_GROUP;
+
+    for (size_t j = 0; j < n; j++) {
+      current[j] = tree->root;
+      results[base + j] = NULL;
+    }
+
+    size_t active = n;
+    while (active > 0) {
+      for (size_t j = 0; j < n; j++) {
+        rb_node *node = current[j];
+        if (node == NULL)
+          continue; // Busca já terminada.
+
+        if (node == tree->NIL) {
+          current[j] = NULL; // Não encontrado.
+          active--;
+          continue;
+        }
+
+        int cmp = RB_COMPARE(tree, keys[base + j], node->value);
+        if (cmp == 0) {
+          results[base + j] = node->value;
+          current[j] = NULL;
+          active--;
+          continue;
+        }
+
+        node = (cmp < 0) ? node->left : node->right;
+        RB_PREFETCH(node);
+        current[j] = node;
+      }
+    }
+  }
+}
+
+// Busca um lote ordenado: cada busca parte do nó onde a anterior terminou,
+// subindo só até o ancestral cuja sub-árvore pode conter a nova chave.
+static void rb_search_sorted(rb_tree *tree, void **keys, void **results,
+                             size_t count) {
+  rb_node *finger = tree->root;
+
+  for (size_t i = 0; i < count; i++) {
+    void *key = keys[i];
+    rb_node *node = finger;
+    results[i] = NULL;
+
+    // Sobe enquanto a chave passar do limite superior da sub-árvore. Esse
+    // limite só muda quando subimos a partir de um filho esquerdo.
+    while (node != tree->NIL && RB_PARENT(node) != tree->NIL) {
+      rb_node *parent = RB_PARENT(node);
+      if (node == parent->left) {
+        int cmp = RB_COMPARE(tree, key, parent->value);
+        if (cmp < 0)
+          break;
+        if (cmp == 0) {
+          node = parent;
+          break;
+        }
+      }
+      node = parent;
+    }
+
+    // Desce normalmente a partir do ancestral encontrado.
+    while (node != tree->NIL) {
+      finger = node;
+      int cmp = RB_COMPARE(tree, key, node->value);
+      if (cmp == 0) {
+        results[i] = node->value;
+        break;
+      }
+      node = (cmp < 0) ? node->left : node->right;
+    }
+  }
+}
+
+void rb_search_many(rb_tree *tree, void **keys, void **results, size_t count,
+                    int sorted) {
+  if (tree == NULL || count == 0)
+    return;
+
+  if (sorted)
+    rb_search_sorted(tree, keys, results, count);
+  else
+    rb_search_interleaved(tree, keys, results, count);
+}
+
 unsigned int rb_size(rb_tree *tree) {
   if (tree != NULL) {
     return tree->size;
   }
   return 0;
+}
+
+int rb_stats(rb_tree *tree, rb_tree_stats *stats) {
+  if (stats == NULL)
+    return 0;
+#ifdef COLLECTIONS_STATS
+  if (tree != NULL) {
+    *stats = tree->stats;
+    return 1;
+  }
+#else
+  (void)tree;
+#endif
+  memset(stats, 0, sizeof(rb_tree_stats));
+  return 0;
+}
+
+void rb_stats_reset(rb_tree *tree) {
+#ifdef COLLECTIONS_STATS
+  if (tree != NULL)
+    memset(&tree->stats, 0, sizeof(tree->stats));
+#else
+  (void)tree;
+#endif
 }
\ No newline at end of file
@@ -0,0 +1,6 @@
+#include <rbtree_i64.h>
+
+// Comparação inline de inteiros, sem desvio condicional.
+#define RB_I64_COMPARE(a, b) ((*(a) > *(b)) - (*(a) < *(b)))
+
+RB_TYPED_GENERATE(rb_i64, int64_t, RB_I64_COMPARE)
@@ -0,0 +1,524 @@
+#include <skiplist.h>
+
+#include <stdlib.h>
+#include <string.h>
+
+// Marca de remoção lógica no bit mais baixo dos ponteiros `next`.
+#define SL_MARK ((uintptr_t)1)
+#define SL_PTR(p) ((sl_node *)((p) & ~SL_MARK))
+#define SL_MARKED(p) (((p)&SL_MARK) != 0)
+
+// Nós aposentados por uma thread antes de ela tentar avançar a época.
+#define SL_RETIRE_THRESHOLD 64
+
+// Identificador da próxima lista criada.
+static atomic_uint_fast64_t sl_next_id = 1;
+
+// Último registro usado pela thread (evita procurar na lista de registros a
+// cada operação).
+static _Thread_local struct {
+  uint64_t list_id;
+  sl_thread *thread;
+} sl_cache;
+
+// ======================================== //
+//         Implementações privadas.         //
+// ======================================== //
+
+// Cria um nó com `height` níveis (o valor é definido por quem chama).
+static sl_node *sl_create_node(void *value, int height) {
+  sl_node *node = (sl_node *)malloc(sizeof(sl_node) +
+                                    (size_t)height * sizeof(uintptr_t));
+  node->value = value;
+  node->height = height;
+  atomic_init(&node->refs, 2); // O inseridor e quem remover o nó.
+  node->retired_next = NULL;
+  for (int l = 0; l < height; l++)
+    atomic_init(&node->next[l], 0);
+  return node;
+}
+
+// Destroi o elemento e libera o nó.
+static void sl_destroy_node(sl_list *list, sl_node *node) {
+  if (list->function_destroy != NULL)
+    list->function_destroy(node->value);
+  free(node);
+}
+
+// Retorna o registro da thread atual, criando-o no primeiro uso da lista.
+static sl_thread *sl_self(sl_list *list) {
+  if (sl_cache.list_id == list->id)
+    return sl_cache.thread;
+
+  pthread_t self = pthread_self();
+  sl_thread *thread = atomic_load(&list->threads);
+  while (thread != NULL && !pthread_equal(thread->owner, self))
+    thread = thread->next;
+
+  if (thread == NULL) {
+    thread = (sl_thread *)calloc(1, sizeof(sl_thread));
+    thread->owner = self;
+    atomic_init(&thread->state, 0);
+    atomic_init(&thread->size, 0);
+    thread->seed = (unsigned int)(uintptr_t)thread ^ 0x9E3779B9u;
+
+    // Os registros só são acrescentados (no início), nunca removidos.
+    sl_thread *head = atomic_load(&list->threads);
+    do {
+      thread->next = head;
+    } while (!atomic_compare_exchange_weak(&list->threads, &head, thread));
+  }
+
+  sl_cache.list_id = list->id;
+  sl_cache.thread = thread;
+  return thread;
+}
+
+// Libera os nós aposentados em épocas já seguras (e + 2 <= `epoch`).
+static void sl_collect(sl_list *list, sl_thread *thread, uint64_t epoch) {
+  for (int i = 0; i < 3; i++) {
+    if (thread->retired[i] == NULL || thread->retired_epoch[i] + 2 > epoch)
+      continue;
+    sl_node *node = thread->retired[i];
+    thread->retired[i] = NULL;
+    while (node != NULL) {
+      sl_node *next = node->retired_next;
+      sl_destroy_node(list, node);
+      thread->retired_count--;
+      node = next;
+    }
+  }
+}
+
+// Avança a época global se todas as threads ativas já estão nela.
+static void sl_try_advance(sl_list *list) {
+  uint64_t epoch = atomic_load(&list->epoch);
+  for (sl_thread *t = atomic_load(&list->threads); t != NULL; t = t->next) {
+    uint64_t state = atomic_load(&t->state);
+    if ((state & 1) && (state >> 1) != epoch)
+      return; // Alguma thread ainda está em uma época anterior.
+  }
+  atomic_compare_exchange_strong(&list->epoch, &epoch, epoch + 1);
+}
+
+// Entra em uma seção protegida: anuncia a época global (a ordem
+// sequencialmente consistente garante que quem avançar a época veja o
+// anúncio antes de qualquer leitura da lista feita aqui).
+static sl_thread *sl_enter(sl_list *list) {
+  sl_thread *thread = sl_self(list);
+  if (thread->nesting++ == 0) {
+    uint64_t epoch = atomic_load(&list->epoch);
+    atomic_store(&thread->state, (epoch << 1) | 1);
+    atomic_thread_fence(memory_order_seq_cst);
+    sl_collect(list, thread, epoch);
+  }
+  return thread;
+}
+
+// Sai da seção protegida.
+static void sl_leave(sl_thread *thread) {
+  if (--thread->nesting == 0)
+    atomic_store(&thread->state, 0);
+}
+
+// Soma `delta` à contagem da thread. Só a dona escreve no registro, então
+// não precisa de uma operação atômica de leitura e escrita (nem disputa a
+// linha de cache com as outras threads).
+static void sl_count(sl_thread *thread, long delta) {
+  long size = atomic_load_explicit(&thread->size, memory_order_relaxed);
+  atomic_store_explicit(&thread->size, size + delta, memory_order_relaxed);
+}
+
+// Aposenta um nó já inalcançável: ele é destruído quando a época global
+// avançar duas vezes.
+static void sl_retire(sl_list *list, sl_thread *thread, sl_node *node) {
+  uint64_t epoch = atomic_load(&list->epoch);
+  int i = (int)(epoch % 3);
+  // O rodízio só reaproveita a posição de uma época anterior a epoch - 2.
+  if (thread->retired[i] != NULL && thread->retired_epoch[i] != epoch)
+    sl_collect(list, thread, epoch);
+
+  node->retired_next = thread->retired[i];
+  thread->retired[i] = node;
+  thread->retired_epoch[i] = epoch;
+  if (++thread->retired_count >= SL_RETIRE_THRESHOLD) {
+    sl_try_advance(list);
+    sl_collect(list, thread, atomic_load(&list->epoch));
+  }
+}
+
+// Solta uma das duas referências do nó (do inseridor ou do removedor). Cada
+// um desconecta o nó antes de soltar, então o último deixa-o inalcançável.
+static void sl_release(sl_list *list, sl_thread *thread, sl_node *node) {
+  if (atomic_fetch_sub(&node->refs, 1) == 1)
+    sl_retire(list, thread, node);
+}
+
+// Sorteia a altura de um novo nó (distribuição geométrica com p = 1/4).
+static int sl_random_level(sl_thread *thread) {
+  unsigned int x = thread->seed;
+  x ^= x << 13;
+  x ^= x >> 17;
+  x ^= x << 5;
+  thread->seed = x;
+
+  int level = 1;
+  while ((x & 3) == 0 && level < SL_MAX_LEVEL) {
+    level++;
+    x >>= 2;
+  }
+  return level;
+}
+
+// Procura a posição de `value` em todos os níveis: `preds[l]` recebe o último
+// nó menor que `value` e `succs[l]` o primeiro maior ou igual. Os nós
+// marcados encontrados no caminho são desconectados. Retorna 1 se
+// `succs[0]` for igual a `value`.
+static int sl_find(sl_list *list, void *value, sl_node **preds,
+                   sl_node **succs) {
+retry:;
+  sl_node *pred = list->head;
+  sl_node *curr = NULL;
+  sl_node *last = NULL; // Último nó comparado (o mesmo nos níveis de baixo).
+  int cmp = 1;
+  for (int l = SL_MAX_LEVEL - 1; l >= 0; l--) {
+    curr = SL_PTR(atomic_load(&pred->next[l]));
+    while (curr != NULL) {
+      uintptr_t succ = atomic_load(&curr->next[l]);
+      if (SL_MARKED(succ)) {
+        // Desconecta o nó removido; se `pred` mudou, recomeça do topo.
+        uintptr_t expected = (uintptr_t)curr;
+        if (!atomic_compare_exchange_strong(&pred->next[l], &expected,
+                                            succ & ~SL_MARK))
+          goto retry;
+        curr = SL_PTR(succ);
+        continue;
+      }
+      if (curr != last) {
+        cmp = list->function_compare(value, curr->value);
+        last = curr;
+      }
+      if (cmp <= 0)
+        break;
+      pred = curr;
+      curr = SL_PTR(succ);
+    }
+    preds[l] = pred;
+    succs[l] = curr;
+  }
+  return curr != NULL && cmp == 0;
+}
+
+// Desconecta o nó marcado `node` de todos os níveis. Diferente de `sl_find`,
+// percorre também os nós iguais a ele, pois um elemento igual pode ter sido
+// inserido na frente de `node` enquanto ele era removido.
+static void sl_unlink(sl_list *list, sl_node *node) {
+  void *value = node->value;
+retry:;
+  sl_node *pred = list->head;
+  for (int l = SL_MAX_LEVEL - 1; l >= 0; l--) {
+    // `pred` avança só pelos nós menores; os iguais são varridos por `p`.
+    sl_node *p = pred;
+    sl_node *curr = SL_PTR(atomic_load(&p->next[l]));
+    int before = 1; // `p` ainda é menor que `value`.
+    while (curr != NULL) {
+      uintptr_t succ = atomic_load(&curr->next[l]);
+      if (SL_MARKED(succ)) {
+        uintptr_t expected = (uintptr_t)curr;
+        if (!atomic_compare_exchange_strong(&p->next[l], &expected,
+                                            succ & ~SL_MARK))
+          goto retry;
+        curr = SL_PTR(succ);
+        continue;
+      }
+      int cmp = list->function_compare(value, curr->value);
+      if (cmp < 0)
+        break;
+      if (cmp > 0 && before)
+        pred = curr;
+      else
+        before = 0;
+      p = curr;
+      curr = SL_PTR(succ);
+    }
+  }
+}
+
+// Primeiro nó não removido a partir de `curr` (nível 0).
+static sl_node *sl_skip_marked(sl_node *curr) {
+  while (curr != NULL && SL_MARKED(atomic_load(&curr->next[0])))
+    curr = SL_PTR(atomic_load(&curr->next[0]));
+  return curr;
+}
+
+// Busca sem alterar a lista: segue os ponteiros dos nós marcados em vez de
+// desconectá-los, então nunca repete nem espera. Retorna o nó igual a
+// `value` ou NULL.
+static sl_node *sl_find_node(sl_list *list, void *value) {
+  sl_node *pred = list->head;
+  sl_node *last = NULL; // Nó maior que `value` já comparado.
+  for (int l = SL_MAX_LEVEL - 1; l >= 0; l--) {
+    sl_node *curr = SL_PTR(atomic_load(&pred->next[l]));
+    while (curr != NULL && curr != last) {
+      uintptr_t succ = atomic_load(&curr->next[l]);
+      if (SL_MARKED(succ)) {
+        curr = SL_PTR(succ);
+        continue;
+      }
+      int cmp = list->function_compare(value, curr->value);
+      last = curr;
+      if (cmp == 0)
+        return curr;
+      if (cmp < 0)
+        break;
+      pred = curr;
+      curr = SL_PTR(succ);
+    }
+  }
+  return NULL;
+}
+
+// ======================================== //
+//         Implementações publicas.         //
+// ======================================== //
+
+sl_list *sl_create_list(sl_function_compare compare, sl_function_copy copy,
+                        sl_function_destroy destroy) {
+  sl_list *list = (sl_list *)malloc(sizeof(sl_list));
+  if (list == NULL)
+    return NULL;
+
+  list->head = sl_create_node(NULL, SL_MAX_LEVEL);
+  list->id = atomic_fetch_add(&sl_next_id, 1);
+  atomic_init(&list->epoch, 0);
+  atomic_init(&list->threads, NULL);
+
+  list->function_compare = compare;
+  list->function_copy = copy;
+  list->function_destroy = destroy;
+  return list;
+}
+
+void sl_destroy_list(sl_list *list) {
+  if (list == NULL)
+    return;
+
+  // Os nós ainda conectados no nível 0 (inclusive os marcados) e os
+  // aposentados são conjuntos disjuntos.
+  sl_node *node = SL_PTR(atomic_load(&list->head->next[0]));
+  while (node != NULL) {
+    sl_node *next = SL_PTR(atomic_load(&node->next[0]));
+    sl_destroy_node(list, node);
+    node = next;
+  }
+  free(list->head);
+
+  sl_thread *thread = atomic_load(&list->threads);
+  while (thread != NULL) {
+    sl_thread *next = thread->next;
+    sl_collect(list, thread, UINT64_MAX);
+    free(thread);
+    thread = next;
+  }
+
+  // Esquece o cache desta thread (outra lista pode reusar o endereço).
+  if (sl_cache.list_id == list->id)
+    sl_cache.list_id = 0;
+  free(list);
+}
+
+int sl_insert(sl_list *list, void *value) {
+  if (list == NULL)
+    return 0;
+
+  sl_thread *thread = sl_enter(list);
+  sl_node *preds[SL_MAX_LEVEL], *succs[SL_MAX_LEVEL];
+  sl_node *node = NULL;
+
+  for (;;) {
+    if (sl_find(list, value, preds, succs)) {
+      // Duplicata: o nó (se criado) nunca foi publicado.
+      if (node != NULL)
+        sl_destroy_node(list, node);
+      sl_leave(thread);
+      return 0;
+    }
+
+    // A cópia só é feita quando a inserção é possível.
+    if (node == NULL)
+      node = sl_create_node(list->function_copy(value),
+                            sl_random_level(thread));
+    for (int l = 0; l < node->height; l++)
+      atomic_store(&node->next[l], (uintptr_t)succs[l]);
+
+    // O nó passa a existir quando entra no nível 0.
+    uintptr_t expected = (uintptr_t)succs[0];
+    if (atomic_compare_exchange_strong(&preds[0]->next[0], &expected,
+                                       (uintptr_t)node))
+      break;
+  }
+  sl_count(thread, 1);
+
+  // Conecta os níveis de cima. Se o nó for removido enquanto isso, para.
+  for (int l = 1; l < node->height; l++) {
+    for (;;) {
+      uintptr_t next = atomic_load(&node->next[l]);
+      if (SL_MARKED(next))
+        goto linked;
+      if (next != (uintptr_t)succs[l] &&
+          !atomic_compare_exchange_strong(&node->next[l], &next,
+                                          (uintptr_t)succs[l]))
+        goto linked; // Só falha se o nó foi marcado.
+
+      uintptr_t expected = (uintptr_t)succs[l];
+      if (atomic_compare_exchange_strong(&preds[l]->next[l], &expected,
+                                         (uintptr_t)node))
+        break;
+      sl_find(list, value, preds, succs); // Posição mudou: procura de novo.
+    }
+  }
+
+linked:
+  // Se o nó foi removido durante a conexão, um nível pode ter sido ligado
+  // depois da desconexão feita pelo removedor.
+  if (SL_MARKED(atomic_load(&node->next[0])))
+    sl_unlink(list, node);
+  sl_release(list, thread, node);
+  sl_leave(thread);
+  return 1;
+}
+
+int sl_remove(sl_list *list, void *value) {
+  if (list == NULL)
+    return 0;
+
+  sl_thread *thread = sl_enter(list);
+  sl_node *preds[SL_MAX_LEVEL], *succs[SL_MAX_LEVEL];
+  if (!sl_find(list, value, preds, succs)) {
+    sl_leave(thread);
+    return 0;
+  }
+  sl_node *node = succs[0];
+
+  // Marca os níveis de cima para baixo; o nível 0 decide quem removeu.
+  for (int l = node->height - 1; l >= 1; l--) {
+    uintptr_t next = atomic_load(&node->next[l]);
+    while (!SL_MARKED(next) &&
+           !atomic_compare_exchange_weak(&node->next[l], &next,
+                                         next | SL_MARK))
+      ;
+  }
+  uintptr_t next = atomic_load(&node->next[0]);
+  for (;;) {
+    if (SL_MARKED(next)) { // Outra thread removeu antes.
+      sl_leave(thread);
+      return 0;
+    }
+    if (atomic_compare_exchange_weak(&node->next[0], &next, next | SL_MARK))
+      break;
+  }
+  sl_count(thread, -1);
+
+  // Tenta desconectar com os antecessores da busca; se algum mudou, percorre
+  // a lista de novo.
+  int l = node->height - 1;
+  for (; l >= 0; l--) {
+    uintptr_t expected = (uintptr_t)node;
+    uintptr_t succ = atomic_load(&node->next[l]) & ~SL_MARK;
+    if (!atomic_compare_exchange_strong(&preds[l]->next[l], &expected, succ))
+      break;
+  }
+  if (l >= 0)
+    sl_unlink(list, node);
+  sl_release(list, thread, node);
+  sl_leave(thread);
+  return 1;
+}
+
+int sl_contains(sl_list *list, void *value) {
+  if (list == NULL)
+    return 0;
+
+  sl_thread *thread = sl_enter(list);
+  int found = sl_find_node(list, value) != NULL;
+  sl_leave(thread);
+  return found;
+}
+
+void *sl_search(sl_list *list, void *value) {
+  if (list == NULL)
+    return NULL;
+
+  sl_thread *thread = sl_enter(list);
+  sl_node *node = sl_find_node(list, value);
+  void *found = (node != NULL) ? node->value : NULL;
+  sl_leave(thread);
+  return found;
+}
+
+void sl_pin(sl_list *list) { sl_enter(list); }
+
+void sl_unpin(sl_list *list) { sl_leave(sl_self(list)); }
+
+sl_node *sl_first(sl_list *list) {
+  if (list == NULL)
+    return NULL;
+  return sl_skip_marked(SL_PTR(atomic_load(&list->head->next[0])));
+}
+
+sl_node *sl_next(sl_list *list, sl_node *node) {
+  (void)list;
+  if (node == NULL)
+    return NULL;
+  return sl_skip_marked(SL_PTR(atomic_load(&node->next[0])));
+}
+
+unsigned int sl_range(sl_list *list, void *lo, void *hi,
+                      sl_function_visit visit, void *ctx) {
+  if (list == NULL)
+    return 0;
+
+  sl_thread *thread = sl_enter(list);
+
+  // Desce até o último nó menor que `lo` e segue pelo nível 0.
+  sl_node *pred = list->head;
+  if (lo != NULL) {
+    for (int l = SL_MAX_LEVEL - 1; l >= 0; l--) {
+      sl_node *curr = SL_PTR(atomic_load(&pred->next[l]));
+      while (curr != NULL) {
+        uintptr_t succ = atomic_load(&curr->next[l]);
+        if (!SL_MARKED(succ) && list->function_compare(lo, curr->value) <= 0)
+          break;
+        if (!SL_MARKED(succ))
+          pred = curr;
+        curr = SL_PTR(succ);
+      }
+    }
+  }
+
+  unsigned int count = 0;
+  sl_node *node = sl_skip_marked(SL_PTR(atomic_load(&pred->next[0])));
+  while (node != NULL) {
+    if (hi != NULL && list->function_compare(hi, node->value) <= 0)
+      break;
+    count++;
+    if (visit(node->value, ctx) == 0)
+      break;
+    node = sl_next(list, node);
+  }
+
+  sl_leave(thread);
+  return count;
+}
+
+unsigned int sl_size(sl_list *list) {
+  if (list == NULL)
+    return 0;
+
+  long size = 0;
+  for (sl_thread *t = atomic_load(&list->threads); t != NULL; t = t->next)
+    size += atomic_load_explicit(&t->size, memory_order_relaxed);
+
+  // Uma remoção pode ser contada antes da inserção do mesmo elemento.
+  return (size > 0) ? (unsigned int)size : 0;
+}
@@ -0,0 +1,418 @@
+#include <snapshot.h>
+
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+// Identificação do arquivo.
+#define SNAP_MAGIC "CCSNAP\0\0"
+#define SNAP_BYTE_ORDER 0x01020304u
+
+// Registros convertidos por lote no carregamento com `deserialize`.
+#define SNAP_LOAD_BATCH 1024
+
+// Capacidade inicial do buffer de serialização.
+#define SNAP_BUFFER_SIZE 256
+
+// Percorre em ordem os valores de uma das árvores.
+typedef struct snap_cursor {
+  rb_tree *rb; // Árvore percorrida (apenas uma das duas é usada).
+  rb_node *rb_node;
+  avl_node *avl_node;
+  int started;
+} snap_cursor;
+
+// Acrescenta um lote ordenado a uma das árvores (`*_append_sorted`).
+typedef int (*snap_function_append)(void *tree, const void *values,
+                                    size_t count, size_t stride);
+
+// ======================================== //
+//         Implementações privadas.         //
+// ======================================== //
+
+// Retorna o próximo valor do cursor (NULL no fim).
+static void *snap_cursor_next(snap_cursor *cursor) {
+  if (cursor->rb != NULL) {
+    if (cursor->started)
+      cursor->rb_node = rb_next(cursor->rb, cursor->rb_node);
+    cursor->started = 1;
+    return (cursor->rb_node != NULL) ? cursor->rb_node->value : NULL;
+  }
+
+  if (cursor->started)
+    cursor->avl_node = avl_next(cursor->avl_node);
+  cursor->started = 1;
+  return (cursor->avl_node != NULL) ? cursor->avl_node->value : NULL;
+}
+
+// Grava `size` bytes de zeros (alinhamento).
+static int snap_write_padding(FILE *file, size_t size) {
+  static const char zeros[8] = {0};
+  return size == 0 || fwrite(zeros, size, 1, file) == 1;
+}
+
+// Grava no disco a entrada de `path` no seu diretório (após o `rename`).
+static int snap_sync_dir(const char *path) {
+  const char *slash = strrchr(path, '/');
+  size_t length = 1; // "." ou "/".
+  if (slash != NULL && slash != path)
+    length = (size_t)(slash - path);
+
+  char *dir = (char *)malloc(length + 1);
+  if (dir == NULL)
+    return 0;
+  memcpy(dir, (slash != NULL) ? path : ".", length);
+  dir[length] = '\0';
+
+  int fd = open(dir, O_RDONLY);
+  free(dir);
+  if (fd < 0)
+    return 0;
+  int ok = fsync(fd) == 0;
+  close(fd);
+  return ok;
+}
+
+// Escreve os registros no arquivo temporário e o renomeia para `path`.
+static int snap_write(const char *path, snap_cursor *cursor, size_t count,
+                      size_t value_size, snap_function_serialize serialize,
+                      void *ctx) {
+  if (serialize == NULL && value_size == 0)
+    return 0; // Sem como obter os bytes dos elementos.
+
+  size_t length = strlen(path);
+  char *tmp_path = (char *)malloc(length + 5);
+  if (tmp_path == NULL)
+    return 0;
+  memcpy(tmp_path, path, length);
+  memcpy(tmp_path + length, ".tmp", 5);
+
+  FILE *file = fopen(tmp_path, "wb");
+  if (file == NULL) {
+    free(tmp_path);
+    return 0;
+  }
+
+  snap_header header;
+  memset(&header, 0, sizeof(header));
+  memcpy(header.magic, SNAP_MAGIC, sizeof(header.magic));
+  header.version = SNAP_VERSION;
+  header.byte_order = SNAP_BYTE_ORDER;
+  header.count = count;
+  header.record_size = (serialize == NULL) ? value_size : 0;
+  header.data_offset = sizeof(snap_header);
+
+  // O cabeçalho é reescrito no fim, com os tamanhos finais.
+  int ok = fwrite(&header, sizeof(header), 1, file) == 1;
+
+  uint64_t *offsets = NULL;
+  char *buffer = NULL;
+  size_t capacity = 0;
+  if (serialize != NULL) {
+    offsets = (uint64_t *)malloc((count + 1) * sizeof(uint64_t));
+    capacity = SNAP_BUFFER_SIZE;
+    buffer = (char *)malloc(capacity);
+    ok = ok && offsets != NULL && buffer != NULL;
+  }
+
+  uint64_t position = 0;
+  size_t index = 0;
+  for (void *value = snap_cursor_next(cursor); ok && value != NULL;
+       value = snap_cursor_next(cursor), index++) {
+    if (index >= count) {
+      ok = 0; // A árvore mudou durante a gravação.
+      break;
+    }
+
+    const void *record = value;
+    size_t size = value_size;
+
+    if (serialize != NULL) {
+      size = serialize(value, buffer, capacity, ctx);
+      if (size > capacity) {
+        capacity = (size > 2 * capacity) ? size : 2 * capacity;
+        char *grown = (char *)realloc(buffer, capacity);
+        if (grown == NULL) {
+          ok = 0;
+          break;
+        }
+        buffer = grown;
+        size = serialize(value, buffer, capacity, ctx);
+      }
+      record = buffer;
+      offsets[index] = position;
+    }
+
+    ok = size == 0 || fwrite(record, size, 1, file) == 1;
+    position += size;
+  }
+  ok = ok && index == count;
+  header.data_size = position;
+
+  if (ok && serialize != NULL) {
+    // A tabela de offsets fica alinhada em 8 bytes.
+    size_t padding = (size_t)((8 - position % 8) % 8);
+    offsets[count] = position;
+    header.index_offset = header.data_offset + position + padding;
+    ok = snap_write_padding(file, padding) &&
+         fwrite(offsets, sizeof(uint64_t), count + 1, file) == count + 1;
+  }
+
+  if (ok) {
+    ok = fseek(file, 0, SEEK_SET) == 0 &&
+         fwrite(&header, sizeof(header), 1, file) == 1;
+  }
+  // O conteúdo precisa estar no disco antes do `rename`, senão uma queda do
+  // sistema pode deixar `path` apontando para um arquivo incompleto.
+  ok = ok && fflush(file) == 0 && fsync(fileno(file)) == 0;
+  if (fclose(file) != 0)
+    ok = 0;
+
+  if (ok)
+    ok = rename(tmp_path, path) == 0 && snap_sync_dir(path);
+  if (!ok)
+    remove(tmp_path);
+
+  free(buffer);
+  free(offsets);
+  free(tmp_path);
+  return ok;
+}
+
+// Valida o cabeçalho contra o tamanho do arquivo mapeado.
+static int snap_validate(const snap_header *header, size_t map_size) {
+  if (memcmp(header->magic, SNAP_MAGIC, sizeof(header->magic)) != 0 ||
+      header->version != SNAP_VERSION ||
+      header->byte_order != SNAP_BYTE_ORDER)
+    return 0;
+
+  if (header->data_offset < sizeof(snap_header) ||
+      header->data_offset > map_size ||
+      header->data_size > map_size - header->data_offset)
+    return 0;
+
+  if (header->record_size > 0) {
+    return header->index_offset == 0 &&
+           header->count <= header->data_size / header->record_size &&
+           header->count * header->record_size == header->data_size;
+  }
+
+  uint64_t table_size = (header->count + 1) * sizeof(uint64_t);
+  if (header->index_offset % 8 != 0 || header->index_offset > map_size ||
+      header->count >= map_size / sizeof(uint64_t) ||
+      table_size > map_size - header->index_offset)
+    return 0;
+
+  // Offsets fora de ordem dariam tamanhos negativos (e leituras fora do
+  // mapeamento) em `snap_record`.
+  const uint64_t *offsets =
+      (const uint64_t *)((const char *)header + header->index_offset);
+  if (offsets[0] != 0 || offsets[header->count] != header->data_size)
+    return 0;
+  for (uint64_t i = 0; i < header->count; i++) {
+    if (offsets[i] > offsets[i + 1])
+      return 0;
+  }
+  return 1;
+}
+
+// Carrega os registros em uma das árvores, vazia.
+static int snap_load(void *tree, size_t value_size, snap_function_append append,
+                     snapshot *snap, snap_function_deserialize deserialize,
+                     size_t element_size, void *ctx) {
+  // Sem conversão, o próprio mapeamento é o vetor de elementos.
+  if (deserialize == NULL)
+    element_size = snap->record_size;
+
+  // Árvores inline copiam exatamente `value_size` bytes por elemento.
+  if (element_size == 0 || (value_size > 0 && element_size != value_size))
+    return 0;
+
+  if (deserialize == NULL)
+    return append(tree, snap->data, snap->count, snap->record_size);
+
+  char *buffer = (char *)malloc(SNAP_LOAD_BATCH * element_size);
+  if (buffer == NULL)
+    return 0;
+
+  int ok = 1;
+  for (size_t start = 0; ok && start < snap->count; start += SNAP_LOAD_BATCH) {
+    size_t n = snap->count - start;
+    if (n > SNAP_LOAD_BATCH)
+      n = SNAP_LOAD_BATCH;
+
+    for (size_t i = 0; i < n; i++) {
+      size_t size;
+      const void *record = snap_record(snap, start + i, &size);
+      deserialize(record, size, buffer + i * element_size, ctx);
+    }
+    ok = append(tree, buffer, n, element_size);
+  }
+
+  free(buffer);
+  return ok;
+}
+
+// Adaptadores de `*_append_sorted` para `snap_load`.
+static int snap_append_rb(void *tree, const void *values, size_t count,
+                          size_t stride) {
+  return rb_append_sorted((rb_tree *)tree, values, count, stride);
+}
+
+static int snap_append_avl(void *tree, const void *values, size_t count,
+                           size_t stride) {
+  return avl_append_sorted((avl_tree *)tree, values, count, stride);
+}
+
+// ======================================== //
+//         Implementações publicas.         //
+// ======================================== //
+
+int rb_snapshot_save(rb_tree *tree, const char *path,
+                     snap_function_serialize serialize, void *ctx) {
+  // Os registros só guardam o elemento do nó: os valores de um mapa seriam
+  // perdidos.
+  if (tree == NULL || path == NULL || tree->map_value_offset != 0)
+    return 0;
+
+  snap_cursor cursor = {tree, rb_first(tree), NULL, 0};
+  return snap_write(path, &cursor, tree->size, tree->value_size, serialize,
+                    ctx);
+}
+
+int avl_snapshot_save(avl_tree *tree, const char *path,
+                      snap_function_serialize serialize, void *ctx) {
+  if (tree == NULL || path == NULL || tree->map_value_offset != 0)
+    return 0;
+
+  snap_cursor cursor = {NULL, NULL, avl_first(tree), 0};
+  return snap_write(path, &cursor, tree->size, tree->value_size, serialize,
+                    ctx);
+}
+
+int rb_snapshot_load(rb_tree *tree, snapshot *snap,
+                     snap_function_deserialize deserialize,
+                     size_t element_size, void *ctx) {
+  if (tree == NULL || snap == NULL || tree->root != tree->NIL ||
+      tree->map_value_offset != 0)
+    return 0;
+  return snap_load(tree, tree->value_size, snap_append_rb, snap, deserialize,
+                   element_size, ctx);
+}
+
+int avl_snapshot_load(avl_tree *tree, snapshot *snap,
+                      snap_function_deserialize deserialize,
+                      size_t element_size, void *ctx) {
+  if (tree == NULL || snap == NULL || tree->root != NULL ||
+      tree->map_value_offset != 0)
+    return 0;
+  return snap_load(tree, tree->value_size, snap_append_avl, snap, deserialize,
+                   element_size, ctx);
+}
+
+snapshot *snap_open(const char *path, snap_function_compare compare) {
+  int fd = open(path, O_RDONLY);
+  if (fd < 0)
+    return NULL;
+
+  struct stat st;
+  if (fstat(fd, &st) != 0 || (size_t)st.st_size < sizeof(snap_header)) {
+    close(fd);
+    return NULL;
+  }
+
+  size_t map_size = (size_t)st.st_size;
+  void *map = mmap(NULL, map_size, PROT_READ, MAP_PRIVATE, fd, 0);
+  close(fd); // O mapeamento continua válido sem o descritor.
+  if (map == MAP_FAILED)
+    return NULL;
+
+  const snap_header *header = (const snap_header *)map;
+  snapshot *snap = NULL;
+  if (snap_validate(header, map_size))
+    snap = (snapshot *)malloc(sizeof(snapshot));
+  if (snap == NULL) {
+    munmap(map, map_size);
+    return NULL;
+  }
+
+  snap->map = map;
+  snap->map_size = map_size;
+  snap->data = (const char *)map + header->data_offset;
+  snap->offsets = (header->record_size == 0)
+                      ? (const uint64_t *)((const char *)map +
+                                           header->index_offset)
+                      : NULL;
+  snap->count = (size_t)header->count;
+  snap->record_size = (size_t)header->record_size;
+  snap->function_compare = compare;
+  return snap;
+}
+
+void snap_close(snapshot *snap) {
+  if (snap == NULL)
+    return;
+  munmap(snap->map, snap->map_size);
+  free(snap);
+}
+
+size_t snap_count(snapshot *snap) { return snap->count; }
+
+const void *snap_record(snapshot *snap, size_t index, size_t *size) {
+  if (index >= snap->count)
+    return NULL;
+
+  if (snap->record_size > 0) {
+    if (size != NULL)
+      *size = snap->record_size;
+    return snap->data + index * snap->record_size;
+  }
+
+  if (size != NULL)
+    *size = (size_t)(snap->offsets[index + 1] - snap->offsets[index]);
+  return snap->data + snap->offsets[index];
+}
+
+size_t snap_lower_bound(snapshot *snap, void *key) {
+  size_t lo = 0;
+  size_t n = snap->count;
+  while (n > 0) {
+    size_t half = n / 2;
+    void *record = (void *)snap_record(snap, lo + half, NULL);
+    if (snap->function_compare(key, record) > 0) {
+      lo += half + 1;
+      n -= half + 1;
+    } else {
+      n = half;
+    }
+  }
+  return lo;
+}
+
+const void *snap_search(snapshot *snap, void *key, size_t *size) {
+  size_t index = snap_lower_bound(snap, key);
+  const void *record = snap_record(snap, index, size);
+  if (record != NULL && snap->function_compare(key, (void *)record) == 0)
+    return record;
+  return NULL;
+}
+
+size_t snap_range(snapshot *snap, void *lo, void *hi,
+                  snap_function_visit visit, void *ctx) {
+  size_t count = 0;
+  size_t index = (lo != NULL) ? snap_lower_bound(snap, lo) : 0;
+  for (; index < snap->count; index++) {
+    size_t size;
+    const void *record = snap_record(snap, index, &size);
+    if (hi != NULL && snap->function_compare(hi, (void *)record) <= 0)
+      break;
+    count++;
+    if (visit(record, size, ctx) == 0)
+      break; // O visitante pediu para parar.
+  }
+  return count;
+}
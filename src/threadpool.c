@@ -0,0 +1,183 @@
+#include <threadpool.h>
+
+#include <stdlib.h>
+#include <unistd.h>
+
+// ======================================== //
+//         Implementações privadas.         //
+// ======================================== //
+
+// Conta o fim de uma tarefa (com o lock do pool).
+static void tp_finish(thread_pool *pool, tp_group *group) {
+  if (group != NULL && --group->pending == 0)
+    pthread_cond_broadcast(&pool->group_done);
+  if (--pool->pending == 0)
+    pthread_cond_broadcast(&pool->idle);
+}
+
+// Laço de cada thread: retira tarefas da fila até o pool ser destruído.
+static void *tp_worker(void *arg) {
+  thread_pool *pool = (thread_pool *)arg;
+
+  pthread_mutex_lock(&pool->lock);
+  for (;;) {
+    while (pool->head == NULL && !pool->stop)
+      pthread_cond_wait(&pool->has_task, &pool->lock);
+    if (pool->head == NULL) // Fila vazia e pool parando.
+      break;
+
+    tp_task *task = pool->head;
+    pool->head = task->next;
+    if (pool->head == NULL)
+      pool->tail = NULL;
+
+    // A tarefa roda sem o lock, para que as outras threads sigam pegando
+    // tarefas da fila.
+    tp_group *group = task->group;
+    pthread_mutex_unlock(&pool->lock);
+    task->function(task->arg);
+    free(task);
+    pthread_mutex_lock(&pool->lock);
+
+    tp_finish(pool, group);
+  }
+  pthread_mutex_unlock(&pool->lock);
+  return NULL;
+}
+
+// ======================================== //
+//         Implementações publicas.         //
+// ======================================== //
+
+thread_pool *tp_create(unsigned int threads) {
+  if (threads == 0) {
+    long online = sysconf(_SC_NPROCESSORS_ONLN);
+    threads = (online > 0) ? (unsigned int)online : 1;
+  }
+
+  thread_pool *pool = (thread_pool *)malloc(sizeof(thread_pool));
+  if (pool == NULL)
+    return NULL;
+
+  pool->threads = (pthread_t *)malloc(threads * sizeof(pthread_t));
+  if (pool->threads == NULL) {
+    free(pool);
+    return NULL;
+  }
+
+  pool->head = NULL;
+  pool->tail = NULL;
+  pool->pending = 0;
+  pool->stop = 0;
+  pthread_mutex_init(&pool->lock, NULL);
+  pthread_cond_init(&pool->has_task, NULL);
+  pthread_cond_init(&pool->idle, NULL);
+  pthread_cond_init(&pool->group_done, NULL);
+
+  // Se alguma thread não puder ser criada, o pool segue com as já criadas.
+  pool->thread_count = 0;
+  for (unsigned int i = 0; i < threads; i++) {
+    if (pthread_create(&pool->threads[pool->thread_count], NULL, tp_worker,
+                       pool) == 0)
+      pool->thread_count++;
+  }
+  if (pool->thread_count == 0) {
+    tp_destroy(pool);
+    return NULL;
+  }
+
+  return pool;
+}
+
+int tp_submit(thread_pool *pool, tp_function_task function, void *arg) {
+  return tp_submit_group(pool, NULL, function, arg);
+}
+
+int tp_submit_group(thread_pool *pool, tp_group *group,
+                    tp_function_task function, void *arg) {
+  tp_task *task = (tp_task *)malloc(sizeof(tp_task));
+  if (task == NULL)
+    return 0;
+  task->function = function;
+  task->arg = arg;
+  task->group = group;
+  task->next = NULL;
+
+  pthread_mutex_lock(&pool->lock);
+  if (group != NULL)
+    group->pending++;
+  if (pool->tail == NULL)
+    pool->head = task;
+  else
+    pool->tail->next = task;
+  pool->tail = task;
+  pool->pending++;
+  pthread_cond_signal(&pool->has_task);
+  pthread_mutex_unlock(&pool->lock);
+  return 1;
+}
+
+void tp_wait(thread_pool *pool) {
+  pthread_mutex_lock(&pool->lock);
+  while (pool->pending > 0)
+    pthread_cond_wait(&pool->idle, &pool->lock);
+  pthread_mutex_unlock(&pool->lock);
+}
+
+void tp_group_init(tp_group *group) { group->pending = 0; }
+
+void tp_wait_group(thread_pool *pool, tp_group *group) {
+  pthread_mutex_lock(&pool->lock);
+  while (group->pending > 0) {
+    // Procura uma tarefa do grupo que ainda esteja na fila.
+    tp_task *prev = NULL, *task = pool->head;
+    while (task != NULL && task->group != group) {
+      prev = task;
+      task = task->next;
+    }
+
+    // As restantes já estão rodando em outras threads.
+    if (task == NULL) {
+      pthread_cond_wait(&pool->group_done, &pool->lock);
+      continue;
+    }
+
+    if (prev == NULL)
+      pool->head = task->next;
+    else
+      prev->next = task->next;
+    if (pool->tail == task)
+      pool->tail = prev;
+
+    pthread_mutex_unlock(&pool->lock);
+    task->function(task->arg);
+    free(task);
+    pthread_mutex_lock(&pool->lock);
+
+    tp_finish(pool, group);
+  }
+  pthread_mutex_unlock(&pool->lock);
+}
+
+unsigned int tp_threads(thread_pool *pool) { return pool->thread_count; }
+
+void tp_destroy(thread_pool *pool) {
+  if (pool == NULL)
+    return;
+
+  // As threads terminam as tarefas restantes antes de sair.
+  pthread_mutex_lock(&pool->lock);
+  pool->stop = 1;
+  pthread_cond_broadcast(&pool->has_task);
+  pthread_mutex_unlock(&pool->lock);
+
+  for (unsigned int i = 0; i < pool->thread_count; i++)
+    pthread_join(pool->threads[i], NULL);
+
+  pthread_mutex_destroy(&pool->lock);
+  pthread_cond_destroy(&pool->has_task);
+  pthread_cond_destroy(&pool->idle);
+  pthread_cond_destroy(&pool->group_done);
+  free(pool->threads);
+  free(pool);
+}
@@ -0,0 +1,158 @@
+#include <pavltree.h>
+
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// Teste de estresse da árvore AVL persistente: um escritor insere e remove
+// chaves enquanto vários leitores tiram snapshots, percorrem um intervalo
+// duas vezes (o snapshot não pode mudar entre as duas) e os liberam. Exercita
+// a contagem de snapshots em andamento guardada em `current` e a passagem
+// dela para a versão anterior. Feito para rodar também com -fsanitize=thread
+// e -fsanitize=address.
+
+#define READERS 6
+#define KEYS 1000
+#define OPERATIONS 50000
+
+static pavl_tree *tree;
+static atomic_int stop;
+static atomic_int failures;
+
+// Verificações que continuam valendo com NDEBUG (o teste roda em Release).
+#define CHECK(cond)                                                            \
+  do {                                                                         \
+    if (!(cond)) {                                                             \
+      fprintf(stderr, "%s:%d: falhou: %s\n", __FILE__, __LINE__, #cond);       \
+      atomic_fetch_add(&failures, 1);                                          \
+    }                                                                          \
+  } while (0)
+
+static int compare_int(void *a, void *b) {
+  int x = *(int *)a, y = *(int *)b;
+  return (x > y) - (x < y);
+}
+
+static void *copy_int(void *a) {
+  int *copy = (int *)malloc(sizeof(int));
+  *copy = *(int *)a;
+  return copy;
+}
+
+// Elementos visitados por um percurso, em ordem.
+typedef struct collected {
+  int values[KEYS];
+  unsigned int count;
+} collected;
+
+static int visit_collect(void *value, void *ctx) {
+  collected *c = (collected *)ctx;
+  if (c->count < KEYS)
+    c->values[c->count] = *(int *)value;
+  c->count++;
+  return 1;
+}
+
+static void *reader(void *arg) {
+  (void)arg;
+  collected *first = (collected *)malloc(sizeof(collected));
+  collected *second = (collected *)malloc(sizeof(collected));
+  unsigned long snapshots = 0;
+
+  // Ao menos um snapshot, mesmo se o escritor terminar antes.
+  do {
+    pavl_snapshot *snap = pavl_snapshot_take(tree);
+
+    // A árvore inteira: ordem estritamente crescente e tamanho do snapshot.
+    first->count = 0;
+    unsigned int visited =
+        pavl_snapshot_range(snap, NULL, NULL, visit_collect, first);
+    CHECK(visited == first->count);
+    CHECK(visited == pavl_snapshot_size(snap));
+    for (unsigned int i = 1; i < first->count && i < KEYS; i++)
+      CHECK(first->values[i - 1] < first->values[i]);
+
+    // O escritor seguiu alterando a árvore, mas o snapshot não muda.
+    second->count = 0;
+    pavl_snapshot_range(snap, NULL, NULL, visit_collect, second);
+    CHECK(second->count == first->count);
+    CHECK(memcmp(first->values, second->values,
+                 first->count * sizeof(int)) == 0);
+
+    // Intervalo [lo, hi) e buscas dos elementos encontrados.
+    int lo = (int)(snapshots % KEYS), hi = lo + 100;
+    second->count = 0;
+    pavl_snapshot_range(snap, &lo, &hi, visit_collect, second);
+    for (unsigned int i = 0; i < second->count; i++) {
+      CHECK(second->values[i] >= lo && second->values[i] < hi);
+      int *found = (int *)pavl_snapshot_search(snap, &second->values[i]);
+      CHECK(found != NULL && *found == second->values[i]);
+    }
+
+    pavl_snapshot_release(snap);
+    snapshots++;
+  } while (!atomic_load(&stop));
+
+  free(first);
+  free(second);
+  return (void *)snapshots;
+}
+
+// Roda o escritor na thread atual com os leitores em paralelo e confere o
+// resultado final contra uma referência.
+static void run(pavl_tree *t) {
+  tree = t;
+  atomic_store(&stop, 0);
+
+  pthread_t threads[READERS];
+  for (int i = 0; i < READERS; i++)
+    pthread_create(&threads[i], NULL, reader, NULL);
+
+  char present[KEYS] = {0};
+  unsigned int seed = 12345;
+  for (int i = 0; i < OPERATIONS; i++) {
+    seed = seed * 1103515245 + 12345;
+    int key = (int)((seed >> 8) % KEYS);
+    if ((seed >> 4) % 2) {
+      CHECK(pavl_insert(t, &key) == !present[key]);
+      present[key] = 1;
+    } else {
+      CHECK(pavl_remove(t, &key) == present[key]);
+      present[key] = 0;
+    }
+  }
+
+  atomic_store(&stop, 1);
+  unsigned long snapshots = 0;
+  for (int i = 0; i < READERS; i++) {
+    void *count;
+    pthread_join(threads[i], &count);
+    snapshots += (unsigned long)count;
+  }
+  CHECK(snapshots > 0);
+
+  unsigned int expected = 0;
+  for (int key = 0; key < KEYS; key++) {
+    expected += present[key];
+    CHECK((pavl_search(t, &key) != NULL) == present[key]);
+  }
+  CHECK(pavl_size(t) == expected);
+}
+
+int main(void) {
+  // Cópias compartilhadas pelas versões (modo padrão) e valores inline.
+  pavl_tree *t = pavl_create_tree(compare_int, copy_int, free);
+  run(t);
+  pavl_destroy_tree(t);
+
+  t = pavl_create_tree_inline(compare_int, sizeof(int));
+  run(t);
+  pavl_destroy_tree(t);
+
+  if (atomic_load(&failures) != 0)
+    return EXIT_FAILURE;
+  puts("ok");
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,312 @@
+#include <rbtree.h>
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+// Teste da árvore de intervalos contra uma referência por força bruta. Depois
+// de cada tipo de alteração (inserção, remoção, upsert, dicas, construção em
+// lote e operações de conjunto, que usam split/join) confere em todos os nós o
+// maior fim da sub-árvore e compara as buscas por sobreposição com a
+// referência. Compilado com e sem COLLECTIONS_COMPACT_NODES.
+
+#define MAX_INTERVALS 4000
+#define KEY_RANGE 1000
+
+// Intervalo [start, end). A árvore ordena por (start, id): `end` pode mudar
+// com um upsert.
+typedef struct interval {
+  int64_t start, end;
+  int id;
+} interval;
+
+static int failures;
+
+// Verificações que continuam valendo com NDEBUG (o teste roda em Release).
+#define CHECK(cond)                                                            \
+  do {                                                                         \
+    if (!(cond)) {                                                             \
+      fprintf(stderr, "%s:%d: falhou: %s\n", __FILE__, __LINE__, #cond);       \
+      failures++;                                                              \
+    }                                                                          \
+  } while (0)
+
+static int compare_interval(void *a, void *b) {
+  interval *x = (interval *)a, *y = (interval *)b;
+  if (x->start != y->start)
+    return (x->start < y->start) ? -1 : 1;
+  return (x->id > y->id) - (x->id < y->id);
+}
+
+static void extract_interval(void *value, int64_t *start, int64_t *end) {
+  *start = ((interval *)value)->start;
+  *end = ((interval *)value)->end;
+}
+
+static void *copy_interval(void *a) {
+  interval *copy = (interval *)malloc(sizeof(interval));
+  *copy = *(interval *)a;
+  return copy;
+}
+
+static int sort_compare(const void *a, const void *b) {
+  return compare_interval((void *)a, (void *)b);
+}
+
+// Gerador determinístico (o resultado não depende da libc).
+static unsigned int seed = 2024;
+static unsigned int next_random(void) {
+  seed = seed * 1103515245 + 12345;
+  return seed >> 8;
+}
+
+// Intervalo novo, quase sempre curto e às vezes longo.
+static interval random_interval(int id) {
+  interval v;
+  v.start = next_random() % KEY_RANGE;
+  v.end = v.start + 1 + next_random() % ((next_random() % 10) ? 20 : 300);
+  v.id = id;
+  return v;
+}
+
+// ======================================== //
+//         Referência.                      //
+// ======================================== //
+
+static interval reference[MAX_INTERVALS];
+static int reference_count;
+
+static int reference_find(interval *v) {
+  for (int i = 0; i < reference_count; i++) {
+    if (compare_interval(&reference[i], v) == 0)
+      return i;
+  }
+  return -1;
+}
+
+static void reference_remove(int i) {
+  reference[i] = reference[--reference_count];
+}
+
+// ======================================== //
+//         Verificações.                    //
+// ======================================== //
+
+// Maior fim guardado no nó: logo após o nó, depois do tamanho da sub-árvore
+// quando ele também fica fora do nó (layout compacto com RB_OPT_ORDER_STAT).
+static int64_t stored_max_end(rb_tree *tree, rb_node *node) {
+  size_t skip = 0;
+#ifdef COLLECTIONS_COMPACT_NODES
+  if (tree->options & RB_OPT_ORDER_STAT)
+    skip = sizeof(uint64_t);
+#else
+  (void)tree;
+#endif
+  return *(int64_t *)((char *)(node + 1) + skip);
+}
+
+// Confere o maior fim de cada sub-árvore e retorna o da raiz.
+static int64_t check_max_end(rb_tree *tree, rb_node *node) {
+  if (node == tree->NIL)
+    return INT64_MIN;
+
+  int64_t max = ((interval *)node->value)->end;
+  int64_t left = check_max_end(tree, node->left);
+  int64_t right = check_max_end(tree, node->right);
+  if (left > max)
+    max = left;
+  if (right > max)
+    max = right;
+  CHECK(stored_max_end(tree, node) == max);
+  return max;
+}
+
+typedef struct collected {
+  int ids[MAX_INTERVALS];
+  int count;
+} collected;
+
+static int visit_collect(void *value, void *ctx) {
+  collected *c = (collected *)ctx;
+  if (c->count < MAX_INTERVALS)
+    c->ids[c->count] = ((interval *)value)->id;
+  c->count++;
+  return 1;
+}
+
+// Confere a árvore inteira contra a referência.
+static void check_tree(rb_tree *tree) {
+  check_max_end(tree, tree->root);
+  CHECK(rb_size(tree) == (unsigned int)reference_count);
+
+  for (int q = 0; q < 60; q++) {
+    int64_t lo = (int64_t)(next_random() % (KEY_RANGE + 100)) - 50;
+    int64_t hi = (q % 5 == 0) ? lo + 1 : lo + next_random() % 60;
+
+    int expected = 0;
+    for (int i = 0; i < reference_count; i++) {
+      if (reference[i].start < hi && lo < reference[i].end && lo < hi)
+        expected++;
+    }
+
+    static collected found;
+    found.count = 0;
+    unsigned int visited =
+        rb_overlap_all(tree, lo, hi, visit_collect, &found);
+    CHECK((int)visited == expected && found.count == expected);
+    for (int i = 0; i < found.count && i < MAX_INTERVALS; i++) {
+      int j = -1;
+      for (int k = 0; k < reference_count && j < 0; k++) {
+        if (reference[k].id == found.ids[i])
+          j = k;
+      }
+      CHECK(j >= 0 && reference[j].start < hi && lo < reference[j].end);
+    }
+
+    rb_node *any = rb_overlap_any(tree, lo, hi);
+    if (expected == 0) {
+      CHECK(any == NULL);
+    } else {
+      interval *v = (interval *)(any != NULL ? any->value : NULL);
+      CHECK(v != NULL && v->start < hi && lo < v->end);
+    }
+  }
+}
+
+// ======================================== //
+//         Cenários.                        //
+// ======================================== //
+
+// Árvore auxiliar do mesmo tipo que `tree`.
+static rb_tree *create_like(rb_tree *tree) {
+  unsigned int options = tree->options & (RB_OPT_POOL | RB_OPT_ORDER_STAT);
+  if (tree->value_size > 0)
+    return rb_create_interval_inline(compare_interval, extract_interval,
+                                     sizeof(interval), options);
+  return rb_create_interval(compare_interval, copy_interval, free,
+                            extract_interval, options);
+}
+
+static void run(rb_tree *tree) {
+  reference_count = 0;
+  int id = 0;
+
+  // Inserções, remoções e upserts (rb_update_path e as rotações).
+  for (int step = 0; step < 6000; step++) {
+    unsigned int op = next_random() % 12;
+    if (op < 5 && reference_count < MAX_INTERVALS / 2) {
+      interval v = random_interval(id++);
+      CHECK(rb_insert(tree, &v) == 1);
+      reference[reference_count++] = v;
+    } else if (op < 7 && reference_count > 0) {
+      int i = next_random() % reference_count;
+      CHECK(rb_remove(tree, &reference[i]) == 1);
+      reference_remove(i);
+    } else if (op < 9 && reference_count > 0) {
+      // Mesma chave com outro fim: o maior fim do caminho muda.
+      int i = next_random() % reference_count;
+      reference[i].end =
+          reference[i].start + 1 + next_random() % ((step % 3) ? 10 : 500);
+      CHECK(rb_upsert(tree, &reference[i]) == 0);
+    } else if (op < 10 && reference_count > 0) {
+      // `out` recebe os bytes (inline) ou o ponteiro da cópia.
+      interval out, *copy = NULL;
+      void *target = (tree->value_size > 0) ? (void *)&out : (void *)&copy;
+      int popped = (step % 2) ? rb_pop_min(tree, target)
+                              : rb_pop_max(tree, target);
+      if (copy != NULL) {
+        out = *copy;
+        free(copy);
+      }
+      int i = reference_find(&out);
+      CHECK(popped == 1 && i >= 0);
+      if (i >= 0)
+        reference_remove(i);
+    } else if (reference_count < MAX_INTERVALS / 2) {
+      // Inserção com dica: o vizinho de um elemento já existente.
+      interval v = random_interval(id++);
+      rb_node *hint = rb_lower_bound(tree, &v);
+      int inserted = 0;
+      rb_insert_hint(tree, hint, &v, &inserted);
+      CHECK(inserted == 1);
+      reference[reference_count++] = v;
+    }
+
+    if (step % 500 == 0)
+      check_tree(tree);
+  }
+  check_tree(tree);
+
+  // Construção em lote e acréscimo em ordem.
+  static interval batch[MAX_INTERVALS / 4];
+  int batch_count = MAX_INTERVALS / 4;
+  for (int i = 0; i < batch_count; i++)
+    batch[i] = random_interval(100000 + i);
+  qsort(batch, batch_count, sizeof(interval), sort_compare);
+
+  rb_tree *other = create_like(tree);
+  CHECK(rb_build_sorted(other, batch, batch_count / 2, sizeof(interval)));
+  CHECK(rb_append_sorted(other, batch + batch_count / 2,
+                         batch_count - batch_count / 2, sizeof(interval)));
+  check_max_end(other, other->root);
+
+  // Operações de conjunto (split/join).
+  rb_union(tree, other);
+  for (int i = 0; i < batch_count; i++)
+    reference[reference_count++] = batch[i];
+  check_tree(tree);
+
+  rb_tree *half = create_like(tree);
+  for (int i = 0; i < batch_count; i += 2)
+    rb_insert(half, &batch[i]);
+  rb_difference(tree, half);
+  for (int i = 0; i < batch_count; i += 2)
+    reference_remove(reference_find(&batch[i]));
+  check_tree(tree);
+
+  rb_intersection(tree, other);
+  reference_count = 0;
+  for (int i = 1; i < batch_count; i += 2)
+    reference[reference_count++] = batch[i];
+  check_tree(tree);
+
+  interval lo = {300, 0, 0}, hi = {600, 0, 0};
+  rb_erase_range(tree, &lo, &hi);
+  for (int i = 0; i < reference_count;) {
+    if (reference[i].start >= 300 && reference[i].start < 600)
+      reference_remove(i);
+    else
+      i++;
+  }
+  check_tree(tree);
+
+  // A árvore separada leva os nós; a original recomeça vazia.
+  rb_tree *detached = rb_detach(tree);
+  reference_count = 0;
+  interval v = {10, 9500, 1};
+  rb_insert(tree, &v);
+  reference[reference_count++] = v;
+  check_tree(tree);
+
+  rb_destroy_tree(detached);
+  rb_destroy_tree(half);
+  rb_destroy_tree(other);
+  rb_destroy_tree(tree);
+}
+
+int main(void) {
+  run(rb_create_interval(compare_interval, copy_interval, free,
+                         extract_interval, 0));
+  run(rb_create_interval(compare_interval, copy_interval, free,
+                         extract_interval, RB_OPT_ORDER_STAT));
+  run(rb_create_interval_inline(compare_interval, extract_interval,
+                                sizeof(interval), 0));
+  run(rb_create_interval_inline(compare_interval, extract_interval,
+                                sizeof(interval),
+                                RB_OPT_POOL | RB_OPT_ORDER_STAT));
+
+  if (failures != 0)
+    return EXIT_FAILURE;
+  puts("ok");
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,378 @@
+#include <avltree.h>
+#include <rbtree.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// Teste das operações de conjunto (união, interseção, diferença e remoção de
+// intervalo, feitas com split/join) das árvores AVL e rubro-negra contra uma
+// referência por força bruta, nos modos com cópia, inline e com pool. Depois
+// de cada operação confere os elementos em ordem, os extremos e, nas árvores
+// com estatísticas de ordem, `select`, `rank` e `count_range`.
+
+#define KEYS 3000
+#define ROUNDS 40
+
+static int failures;
+
+// Verificações que continuam valendo com NDEBUG (o teste roda em Release).
+#define CHECK(cond)                                                            \
+  do {                                                                         \
+    if (!(cond)) {                                                             \
+      fprintf(stderr, "%s:%d: falhou: %s\n", __FILE__, __LINE__, #cond);       \
+      failures++;                                                              \
+    }                                                                          \
+  } while (0)
+
+static int compare_long(void *a, void *b) {
+  long x = *(long *)a, y = *(long *)b;
+  return (x > y) - (x < y);
+}
+
+static void *copy_long(void *a) {
+  long *copy = (long *)malloc(sizeof(long));
+  *copy = *(long *)a;
+  return copy;
+}
+
+// Gerador determinístico (o resultado não depende da libc).
+static unsigned int seed = 777;
+static unsigned int next_random(void) {
+  seed = seed * 1103515245 + 12345;
+  return seed >> 8;
+}
+
+// ======================================== //
+//         As duas árvores.                 //
+// ======================================== //
+
+// Operações usadas pelo teste, para rodar o mesmo cenário nas duas árvores.
+typedef struct tree_ops {
+  const char *name;
+  void *(*create)(unsigned int mode);
+  void (*destroy)(void *);
+  int (*insert)(void *, void *);
+  unsigned int (*set_union)(void *, void *);
+  unsigned int (*set_intersection)(void *, void *);
+  unsigned int (*set_difference)(void *, void *);
+  unsigned int (*erase_range)(void *, void *, void *);
+  unsigned int (*size)(void *);
+  void *(*first)(void *);
+  void *(*next)(void *, void *);
+  void *(*value)(void *);
+  void *(*min)(void *);
+  void *(*max)(void *);
+  void *(*select)(void *, unsigned int);
+  unsigned int (*rank)(void *, void *);
+  unsigned int (*count_range)(void *, void *, void *);
+  void (*check)(void *); // Invariantes próprias da árvore.
+} tree_ops;
+
+// Modos de criação: bits de `mode`.
+#define MODE_INLINE 0x1
+#define MODE_POOL 0x2
+#define MODE_ORDER_STAT 0x4
+
+static void *rb_create(unsigned int mode) {
+  unsigned int options = ((mode & MODE_POOL) ? RB_OPT_POOL : 0) |
+                         ((mode & MODE_ORDER_STAT) ? RB_OPT_ORDER_STAT : 0);
+  if (mode & MODE_INLINE)
+    return rb_create_tree_inline(compare_long, sizeof(long), options);
+  return rb_create_tree_ex(compare_long, copy_long, free, options);
+}
+
+static void *avl_create(unsigned int mode) {
+  unsigned int options = ((mode & MODE_POOL) ? AVL_OPT_POOL : 0) |
+                         ((mode & MODE_ORDER_STAT) ? AVL_OPT_ORDER_STAT : 0);
+  if (mode & MODE_INLINE)
+    return avl_create_tree_inline(compare_long, sizeof(long), options);
+  return avl_create_tree_ex(compare_long, copy_long, free, options);
+}
+
+static void rb_destroy(void *t) { rb_destroy_tree((rb_tree *)t); }
+static int rb_ins(void *t, void *v) { return rb_insert((rb_tree *)t, v); }
+static unsigned int rb_un(void *d, void *s) {
+  return rb_union((rb_tree *)d, (rb_tree *)s);
+}
+static unsigned int rb_inter(void *d, void *s) {
+  return rb_intersection((rb_tree *)d, (rb_tree *)s);
+}
+static unsigned int rb_diff(void *d, void *s) {
+  return rb_difference((rb_tree *)d, (rb_tree *)s);
+}
+static unsigned int rb_erase(void *t, void *lo, void *hi) {
+  return rb_erase_range((rb_tree *)t, lo, hi);
+}
+static unsigned int rb_sz(void *t) { return rb_size((rb_tree *)t); }
+static void *rb_fst(void *t) { return rb_first((rb_tree *)t); }
+static void *rb_nxt(void *t, void *n) {
+  return rb_next((rb_tree *)t, (rb_node *)n);
+}
+static void *rb_val(void *n) { return ((rb_node *)n)->value; }
+static void *rb_mn(void *t) { return rb_min((rb_tree *)t); }
+static void *rb_mx(void *t) { return rb_max((rb_tree *)t); }
+static void *rb_sel(void *t, unsigned int i) {
+  return rb_select((rb_tree *)t, i);
+}
+static unsigned int rb_rk(void *t, void *v) { return rb_rank((rb_tree *)t, v); }
+static unsigned int rb_cnt(void *t, void *lo, void *hi) {
+  return rb_count_range((rb_tree *)t, lo, hi);
+}
+
+// Árvore rubro-negra: nenhum vermelho com filho vermelho e a mesma
+// quantidade de pretos em todos os caminhos (só no layout com a cor no nó).
+#ifndef COLLECTIONS_COMPACT_NODES
+static int rb_black_height(rb_tree *tree, rb_node *node) {
+  if (node == tree->NIL)
+    return 1;
+  if (node->color == RB_RED)
+    CHECK(node->left->color != RB_RED && node->right->color != RB_RED);
+  int left = rb_black_height(tree, node->left);
+  int right = rb_black_height(tree, node->right);
+  CHECK(left == right);
+  return left + (node->color == RB_BLACK);
+}
+#endif
+
+static void rb_check(void *t) {
+#ifndef COLLECTIONS_COMPACT_NODES
+  rb_tree *tree = (rb_tree *)t;
+  CHECK(tree->root->color == RB_BLACK);
+  rb_black_height(tree, tree->root);
+#else
+  (void)t;
+#endif
+}
+
+static void avl_destroy(void *t) { avl_destroy_tree((avl_tree *)t); }
+static int avl_ins(void *t, void *v) { return avl_insert((avl_tree *)t, v); }
+static unsigned int avl_un(void *d, void *s) {
+  return avl_union((avl_tree *)d, (avl_tree *)s);
+}
+static unsigned int avl_inter(void *d, void *s) {
+  return avl_intersection((avl_tree *)d, (avl_tree *)s);
+}
+static unsigned int avl_diff(void *d, void *s) {
+  return avl_difference((avl_tree *)d, (avl_tree *)s);
+}
+static unsigned int avl_erase(void *t, void *lo, void *hi) {
+  return avl_erase_range((avl_tree *)t, lo, hi);
+}
+static unsigned int avl_sz(void *t) { return avl_size((avl_tree *)t); }
+static void *avl_fst(void *t) { return avl_first((avl_tree *)t); }
+static void *avl_nxt(void *t, void *n) {
+  (void)t;
+  return avl_next((avl_node *)n);
+}
+static void *avl_val(void *n) { return ((avl_node *)n)->value; }
+static void *avl_mn(void *t) { return avl_min((avl_tree *)t); }
+static void *avl_mx(void *t) { return avl_max((avl_tree *)t); }
+static void *avl_sel(void *t, unsigned int i) {
+  return avl_select((avl_tree *)t, i);
+}
+static unsigned int avl_rk(void *t, void *v) {
+  return avl_rank((avl_tree *)t, v);
+}
+static unsigned int avl_cnt(void *t, void *lo, void *hi) {
+  return avl_count_range((avl_tree *)t, lo, hi);
+}
+
+// Árvore AVL: alturas corretas, fator de balanceamento entre -1 e 1 e
+// ponteiros para o pai consistentes.
+static int avl_height_of(avl_node *node, avl_node *parent) {
+  if (node == NULL)
+    return 0;
+  CHECK(node->parent == parent);
+  int left = avl_height_of(node->left, node);
+  int right = avl_height_of(node->right, node);
+  CHECK(left - right <= 1 && right - left <= 1);
+  int height = 1 + ((left > right) ? left : right);
+  CHECK(node->height == height);
+  return height;
+}
+
+static void avl_check(void *t) { avl_height_of(((avl_tree *)t)->root, NULL); }
+
+static const tree_ops trees[] = {
+    {"rb", rb_create, rb_destroy, rb_ins, rb_un, rb_inter, rb_diff, rb_erase,
+     rb_sz, rb_fst, rb_nxt, rb_val, rb_mn, rb_mx, rb_sel, rb_rk, rb_cnt,
+     rb_check},
+    {"avl", avl_create, avl_destroy, avl_ins, avl_un, avl_inter, avl_diff,
+     avl_erase, avl_sz, avl_fst, avl_nxt, avl_val, avl_mn, avl_mx, avl_sel,
+     avl_rk, avl_cnt, avl_check},
+};
+
+// ======================================== //
+//         Verificações.                    //
+// ======================================== //
+
+// Confere a árvore contra o conjunto de referência `present`.
+static void check_tree(const tree_ops *ops, void *tree, unsigned int mode,
+                       const char *present) {
+  ops->check(tree);
+
+  unsigned int expected = 0;
+  long first = -1, last = -1;
+  for (long key = 0; key < KEYS; key++) {
+    if (present[key]) {
+      if (first < 0)
+        first = key;
+      last = key;
+      expected++;
+    }
+  }
+  CHECK(ops->size(tree) == expected);
+
+  // Elementos em ordem.
+  long key = 0;
+  unsigned int count = 0;
+  for (void *node = ops->first(tree); node != NULL;
+       node = ops->next(tree, node)) {
+    while (key < KEYS && !present[key])
+      key++;
+    CHECK(key < KEYS && *(long *)ops->value(node) == key);
+    key++;
+    count++;
+  }
+  CHECK(count == expected);
+
+  if (expected == 0) {
+    CHECK(ops->min(tree) == NULL && ops->max(tree) == NULL);
+    return;
+  }
+  CHECK(*(long *)ops->min(tree) == first && *(long *)ops->max(tree) == last);
+
+  if (!(mode & MODE_ORDER_STAT))
+    return;
+
+  // Estatísticas de ordem em posições e intervalos aleatórios.
+  for (int q = 0; q < 40; q++) {
+    long probe = next_random() % KEYS;
+    unsigned int smaller = 0;
+    for (long k = 0; k < probe; k++)
+      smaller += present[k];
+    CHECK(ops->rank(tree, &probe) == smaller);
+
+    unsigned int index = next_random() % expected;
+    void *node = ops->select(tree, index);
+    CHECK(node != NULL);
+    if (node != NULL) {
+      long value = *(long *)ops->value(node);
+      CHECK(ops->rank(tree, &value) == index);
+    }
+
+    long lo = next_random() % KEYS, hi = lo + next_random() % 300;
+    unsigned int inside = 0;
+    for (long k = lo; k < hi && k < KEYS; k++)
+      inside += present[k];
+    CHECK(ops->count_range(tree, &lo, &hi) == inside);
+  }
+}
+
+// ======================================== //
+//         Cenário.                         //
+// ======================================== //
+
+// Preenche a árvore com uma fração aleatória das chaves (`fill` em 100).
+static void *random_tree(const tree_ops *ops, unsigned int mode,
+                         char *present, unsigned int fill) {
+  void *tree = ops->create(mode);
+  memset(present, 0, KEYS);
+  for (long key = 0; key < KEYS; key++) {
+    if (next_random() % 100 < fill) {
+      CHECK(ops->insert(tree, &key) == 1);
+      present[key] = 1;
+    }
+  }
+  return tree;
+}
+
+static void run(const tree_ops *ops, unsigned int mode) {
+  static char a[KEYS], b[KEYS];
+  int failures_before = failures;
+
+  for (int round = 0; round < ROUNDS; round++) {
+    // Densidades variadas: árvores de tamanhos bem diferentes exercitam o
+    // caminho O(m log(n/m + 1)).
+    unsigned int fill_a = 1 + next_random() % 90;
+    unsigned int fill_b = (round % 4 == 0) ? 1 : 1 + next_random() % 90;
+    void *dst = random_tree(ops, mode, a, fill_a);
+    void *src = random_tree(ops, mode, b, fill_b);
+    unsigned int expected = 0;
+
+    switch (round % 4) {
+    case 0: // União.
+      for (long k = 0; k < KEYS; k++) {
+        expected += b[k] && !a[k];
+        a[k] |= b[k];
+      }
+      CHECK(ops->set_union(dst, src) == expected);
+      break;
+    case 1: // Interseção.
+      for (long k = 0; k < KEYS; k++) {
+        expected += a[k] && !b[k];
+        a[k] &= b[k];
+      }
+      CHECK(ops->set_intersection(dst, src) == expected);
+      break;
+    case 2: // Diferença.
+      for (long k = 0; k < KEYS; k++) {
+        expected += a[k] && b[k];
+        a[k] &= !b[k];
+      }
+      CHECK(ops->set_difference(dst, src) == expected);
+      break;
+    default: { // Remoção de intervalo (às vezes aberto de um lado).
+      long lo = next_random() % KEYS, hi = lo + next_random() % (KEYS / 2);
+      void *plo = (round % 8 == 3) ? NULL : &lo;
+      void *phi = (round % 16 == 7) ? NULL : &hi;
+      for (long k = 0; k < KEYS; k++) {
+        if ((plo == NULL || k >= lo) && (phi == NULL || k < hi)) {
+          expected += a[k];
+          a[k] = 0;
+        }
+      }
+      CHECK(ops->erase_range(dst, plo, phi) == expected);
+      break;
+    }
+    }
+
+    check_tree(ops, dst, mode, a);
+    check_tree(ops, src, mode, b); // `src` não muda.
+
+    // A árvore resultante continua aceitando inserções.
+    for (long key = 0; key < KEYS; key += 97) {
+      CHECK(ops->insert(dst, &key) == !a[key]);
+      a[key] = 1;
+    }
+    check_tree(ops, dst, mode, a);
+
+    ops->destroy(dst);
+    ops->destroy(src);
+  }
+
+  if (failures != failures_before)
+    fprintf(stderr, "falhas na árvore %s, modo %#x\n", ops->name, mode);
+}
+
+int main(void) {
+  static const unsigned int modes[] = {
+      0,
+      MODE_ORDER_STAT,
+      MODE_INLINE | MODE_ORDER_STAT,
+      MODE_POOL | MODE_ORDER_STAT,
+      MODE_INLINE | MODE_POOL,
+      MODE_INLINE | MODE_POOL | MODE_ORDER_STAT,
+  };
+
+  for (size_t t = 0; t < sizeof(trees) / sizeof(trees[0]); t++) {
+    for (size_t m = 0; m < sizeof(modes) / sizeof(modes[0]); m++)
+      run(&trees[t], modes[m]);
+  }
+
+  if (failures != 0)
+    return EXIT_FAILURE;
+  puts("ok");
+  return EXIT_SUCCESS;
+}
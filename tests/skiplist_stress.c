@@ -0,0 +1,132 @@
+#include <skiplist.h>
+
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+// Teste de estresse da lista de saltos: 8 threads inserem, removem, buscam e
+// percorrem intervalos de um conjunto pequeno de chaves ao mesmo tempo. Feito
+// para rodar também com -fsanitize=thread e -fsanitize=address.
+
+#define THREADS 8
+#define KEYS 2000
+#define OPERATIONS 100000
+#define ROUNDS 3
+
+static sl_list *list;
+
+// Inserções menos remoções bem sucedidas de cada chave (0 ou 1 ao final).
+static atomic_long present[KEYS];
+static atomic_int failures;
+
+// Verificações que continuam valendo com NDEBUG (o teste roda em Release).
+#define CHECK(cond)                                                            \
+  do {                                                                         \
+    if (!(cond)) {                                                             \
+      fprintf(stderr, "%s:%d: falhou: %s\n", __FILE__, __LINE__, #cond);       \
+      atomic_fetch_add(&failures, 1);                                          \
+    }                                                                          \
+  } while (0)
+
+static int compare_long(void *a, void *b) {
+  long x = *(long *)a, y = *(long *)b;
+  return (x > y) - (x < y);
+}
+
+static void *copy_long(void *a) {
+  long *copy = (long *)malloc(sizeof(long));
+  *copy = *(long *)a;
+  return copy;
+}
+
+// Confere que a visita está em ordem estritamente crescente.
+static int visit_sorted(void *value, void *ctx) {
+  long *previous = (long *)ctx;
+  CHECK(*(long *)value > *previous);
+  *previous = *(long *)value;
+  return 1;
+}
+
+static void *worker(void *arg) {
+  unsigned int seed = (unsigned int)(uintptr_t)arg * 7919 + 1;
+
+  for (int i = 0; i < OPERATIONS; i++) {
+    seed = seed * 1103515245 + 12345;
+    long key = (seed >> 8) % KEYS;
+    int op = (seed >> 4) % 10;
+
+    if (op < 3) {
+      if (sl_insert(list, &key))
+        atomic_fetch_add(&present[key], 1);
+    } else if (op < 6) {
+      if (sl_remove(list, &key))
+        atomic_fetch_sub(&present[key], 1);
+    } else if (op < 9) {
+      // O elemento só pode ser lido dentro da seção.
+      sl_pin(list);
+      long *value = (long *)sl_search(list, &key);
+      CHECK(value == NULL || *value == key);
+      sl_unpin(list);
+    } else {
+      long previous = -1, lo = key, hi = key + 100;
+      sl_range(list, &lo, &hi, visit_sorted, &previous);
+    }
+  }
+  return NULL;
+}
+
+int main(void) {
+  list = sl_create_list(compare_long, copy_long, free);
+
+  // Uma thread: duplicatas, remoções, cursores e contagem.
+  for (long i = 0; i < 100; i++)
+    CHECK(sl_insert(list, &i));
+  for (long i = 0; i < 100; i++)
+    CHECK(!sl_insert(list, &i) && sl_contains(list, &i));
+  for (long i = 0; i < 100; i += 2)
+    CHECK(sl_remove(list, &i));
+  CHECK(sl_size(list) == 50);
+
+  unsigned int count = 0;
+  for (sl_node *node = sl_first(list); node != NULL;
+       node = sl_next(list, node)) {
+    CHECK(*(long *)node->value % 2 == 1);
+    count++;
+  }
+  CHECK(count == 50);
+
+  for (long i = 1; i < 100; i += 2)
+    CHECK(sl_remove(list, &i));
+  CHECK(sl_size(list) == 0 && sl_first(list) == NULL);
+
+  // Várias threads, em rodadas (as threads novas reaproveitam os registros).
+  pthread_t threads[THREADS];
+  for (int round = 0; round < ROUNDS; round++) {
+    for (int t = 0; t < THREADS; t++)
+      pthread_create(&threads[t], NULL, worker,
+                     (void *)(uintptr_t)(t + round * THREADS));
+    for (int t = 0; t < THREADS; t++)
+      pthread_join(threads[t], NULL);
+
+    long total = 0;
+    for (long key = 0; key < KEYS; key++) {
+      long expected = atomic_load(&present[key]);
+      CHECK(expected == 0 || expected == 1);
+      CHECK(sl_contains(list, &key) == expected);
+      total += expected;
+    }
+    CHECK(sl_size(list) == (unsigned int)total);
+
+    long previous = -1;
+    CHECK(sl_range(list, NULL, NULL, visit_sorted, &previous) ==
+          (unsigned int)total);
+  }
+
+  sl_destroy_list(list);
+
+  if (atomic_load(&failures) != 0)
+    return EXIT_FAILURE;
+  puts("ok");
+  return EXIT_SUCCESS;
+}